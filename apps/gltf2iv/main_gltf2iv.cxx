@@ -8,6 +8,8 @@
 
 #include <iostream>
 #include <optional>
+#include <string>
+#include <vector>
 
 int main(int argc, char * argv[])
 {
@@ -17,6 +19,14 @@ int main(int argc, char * argv[])
         ("i,gltf", "input gltf file", cxxopts::value<std::string>())
         ("o,iv", "output open inventor file", cxxopts::value<std::string>())
         ("b,binary", "write binary", cxxopts::value<bool>()->default_value("false"))
+        ("scene-graph", "write ascii files through a coin scene graph instead of streaming them", cxxopts::value<bool>()->default_value("false"))
+        ("no-compact", "keep every transformation and binding node instead of compacting the scene graph", cxxopts::value<bool>()->default_value("false"))
+        ("precision", "significant digits of floats in streamed ascii files (0 = shortest round trip)", cxxopts::value<int>()->default_value("0"))
+        ("scene", "index of the only scene to convert (-1 = all scenes)", cxxopts::value<int>()->default_value("-1"))
+        ("node", "nodes to convert with their subtrees instead of whole scenes, by index or by name with * and ? wildcards", cxxopts::value<std::vector<std::string>>())
+        ("region", "convert only nodes and primitives intersecting the box minx,miny,minz,maxx,maxy,maxz in world space", cxxopts::value<std::vector<double>>())
+        ("images", "decode, defer or skip the images while reading", cxxopts::value<std::string>()->default_value("defer"))
+        ("t,threads", "threads preparing the meshes (0 = all cores, 1 = serial)", cxxopts::value<unsigned>()->default_value("0"))
         ("v,verbose", "Verbose output", cxxopts::value<bool>()->default_value("false"))
         ("h,help", "print usage")
         ;
@@ -63,13 +73,55 @@ int main(int argc, char * argv[])
     const std::string outputFilename{ result["o"].as<std::string>() };
     const bool writeBinary{ result["b"].as<bool>() };
 
+    GltfIvImageLoading imageLoading{ GltfIvImageLoading::DEFER };
+    const std::string images{ result["images"].as<std::string>() };
+    if (images == "decode") {
+        imageLoading = GltfIvImageLoading::DECODE;
+    }
+    else if (images == "skip") {
+        imageLoading = GltfIvImageLoading::SKIP;
+    }
+    else if (images != "defer") {
+        spdlog::error("unknown image loading '{}', expected decode, defer or skip", images);
+        return EXIT_FAILURE;
+    }
+
+    std::optional<GltfIvWriter::box_t> region;
+    if (result.count("region")) {
+        const std::vector<double> bounds{ result["region"].as<std::vector<double>>() };
+        if (bounds.size() != 6U) {
+            spdlog::error("expected six values for the region, got {}", bounds.size());
+            return EXIT_FAILURE;
+        }
+        region = GltfIvWriter::box_t{};
+        for (size_t i = 0; i < 3U; ++i) {
+            region.value().min[i] = bounds[i];
+            region.value().max[i] = bounds[i + 3U];
+            if (region.value().min[i] > region.value().max[i]) {
+                spdlog::error("the minimum of the region is above its maximum");
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
     spdlog::info("converting {} to {} as {} ", inputFilename, outputFilename, (writeBinary ? "binary" : "ascii"));
 
-    std::optional<tinygltf::Model> maybeGltfModel{ GltfIv::read(inputFilename) };
+    std::optional<GltfIvModel> maybeGltfModel{ GltfIv::read(inputFilename, imageLoading) };
     
     if (maybeGltfModel.has_value()) {
         
         GltfIvWriter writer{std::move(maybeGltfModel.value())};
+        writer.setThreadCount(result["threads"].as<unsigned>());
+        writer.setDirectOutput(!result["scene-graph"].as<bool>());
+        writer.setCompact(!result["no-compact"].as<bool>());
+        writer.setPrecision(result["precision"].as<int>());
+        if (result["scene"].as<int>() >= 0) {
+            writer.setScene(static_cast<size_t>(result["scene"].as<int>()));
+        }
+        if (result.count("node")) {
+            writer.setNodes(result["node"].as<std::vector<std::string>>());
+        }
+        writer.setRegion(region);
         
         if (writer.write(outputFilename, writeBinary)) {
             spdlog::info("successfully converted {} to {} ({} seconds)", inputFilename, outputFilename, stopwatch);
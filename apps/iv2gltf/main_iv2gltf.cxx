@@ -1,8 +1,57 @@
 #include <Inventor/SoDB.h>
+#include <Inventor/nodes/SoShape.h>
+#include <algorithm>
 #include <iostream>
+#include <sstream>
 #include <cxxopts.hpp>
 #include "IvGltfWriter.h"
 
+// parses either a single value for all shapes or a list like "Sphere=0.3,Text3=0.1"
+static bool parseComplexityRules(const std::string& text, std::vector<std::pair<SoType, float>>& rules)
+{
+	std::istringstream in(text);
+	std::string rule;
+	while (std::getline(in, rule, ',')) {
+		SoType shapeType = SoShape::getClassTypeId();
+		std::string value = rule;
+		const size_t separator = rule.find('=');
+		if (separator != std::string::npos) {
+			shapeType = SoType::fromName(SbName(rule.substr(0, separator).c_str()));
+			value = rule.substr(separator + 1);
+			if (shapeType.isBad() || !shapeType.isDerivedFrom(SoShape::getClassTypeId())) {
+				std::cerr << "error: unknown shape type in complexity rule '" << rule << "'\n";
+				return false;
+			}
+		}
+		try {
+			rules.push_back({ shapeType, std::stof(value) });
+		}
+		catch (const std::exception&) {
+			std::cerr << "error: invalid complexity in rule '" << rule << "'\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+// parses "minx,miny,minz,maxx,maxy,maxz"
+static bool parseBox(const std::string& text, SbBox3f& box)
+{
+	float v[6];
+	char separator;
+	std::istringstream in(text);
+	in >> v[0];
+	for (int i = 1; i < 6; ++i) {
+		in >> separator >> v[i];
+	}
+	if (!in || separator != ',') {
+		std::cerr << "error: invalid box '" << text << "', expected minx,miny,minz,maxx,maxy,maxz\n";
+		return false;
+	}
+	box.setBounds(v[0], v[1], v[2], v[3], v[4], v[5]);
+	return true;
+}
+
 int main(int argc, char* argv[])
 {
 	cxxopts::Options options("iv2gltf", "a converter for open inventor to gltf");
@@ -12,7 +61,24 @@ int main(int argc, char* argv[])
 		("o,gltf", "gltf file", cxxopts::value<std::string>()->default_value(""))
 		("i,iv", "inventor file", cxxopts::value<std::string>())		
 		("b,binary", "write binary", cxxopts::value<bool>()->default_value("false"))
+		("pretty", "pretty print the json", cxxopts::value<bool>()->default_value("false"))
 		("v,verbose", "Verbose output", cxxopts::value<bool>()->default_value("false"))
+		("complexity", "complexity override for procedural shapes, a value or a list like Sphere=0.3,Text3=0.1", cxxopts::value<std::string>())
+		("max-complexity", "complexity limit for procedural shapes, a value or a list like Sphere=0.3,Text3=0.1", cxxopts::value<std::string>())
+		("triangle-budget", "maximum number of triangles for all procedural shapes (0 = unlimited)", cxxopts::value<uint32_t>()->default_value("0"))
+		("atlas", "pack textures up to this size into texture atlases (0 = no atlas)", cxxopts::value<int>()->default_value("0"))
+		("atlas-size", "maximum size of a texture atlas", cxxopts::value<int>()->default_value("2048"))
+		("max-texture-size", "scale textures down to this size (0 = keep size)", cxxopts::value<int>()->default_value("0"))
+		("max-mip-levels", "scale textures down so their mip chain has at most this many levels (0 = keep size)", cxxopts::value<int>()->default_value("0"))
+		("pot-textures", "round texture sizes to powers of two", cxxopts::value<bool>()->default_value("false"))
+		("texture-filter", "filter for scaling textures, box or lanczos", cxxopts::value<std::string>()->default_value("box"))
+		("image-format", "texture encoding, png, jpeg or auto", cxxopts::value<std::string>()->default_value("png"))
+		("jpeg-quality", "jpeg quality from 1 to 100", cxxopts::value<int>()->default_value("90"))
+		("external-files", "write files referenced by SoFile or SoWWWInline once to their own .glb", cxxopts::value<bool>()->default_value("false"))
+		("external-dir", "directory of the external .glb files, relative to the output file", cxxopts::value<std::string>()->default_value(""))
+		("cull-invisible", "skip shapes with draw style INVISIBLE", cxxopts::value<bool>()->default_value("false"))
+		("min-size", "skip shapes whose bounding box diagonal is smaller than this", cxxopts::value<float>()->default_value("0"))
+		("crop", "only export shapes intersecting the box minx,miny,minz,maxx,maxy,maxz", cxxopts::value<std::string>())
 		("h,help", "Print usage")
 		;
 	
@@ -36,9 +102,69 @@ int main(int argc, char* argv[])
 		if (SoSeparator* s = IvGltf::readFile(result["i"].as<std::string>())) {
 			IvGltfWriter w(s);
 			w.setWriteBinary(result["b"].as<bool>());
+			w.setPrettyPrint(result["pretty"].as<bool>());
+			std::vector<std::pair<SoType, float>> rules;
+			if (result.count("complexity")) {
+				if (!parseComplexityRules(result["complexity"].as<std::string>(), rules)) {
+					return EXIT_FAILURE;
+				}
+				for (const auto& [shapeType, complexity] : rules) {
+					w.setComplexityOverride(shapeType, complexity);
+				}
+			}
+			rules.clear();
+			if (result.count("max-complexity")) {
+				if (!parseComplexityRules(result["max-complexity"].as<std::string>(), rules)) {
+					return EXIT_FAILURE;
+				}
+				for (const auto& [shapeType, complexity] : rules) {
+					w.setMaxComplexity(shapeType, complexity);
+				}
+			}
+			w.setTriangleBudget(result["triangle-budget"].as<uint32_t>());
+			w.setTextureAtlas(result["atlas"].as<int>(), result["atlas-size"].as<int>());
+			w.setMaxTextureSize(result["max-texture-size"].as<int>());
+			w.setMaxMipLevels(result["max-mip-levels"].as<int>());
+			w.setPowerOfTwoTextures(result["pot-textures"].as<bool>());
+			const std::string textureFilter = result["texture-filter"].as<std::string>();
+			if (textureFilter == "lanczos") {
+				w.setTextureFilter(IvGltfResampleFilter::LANCZOS);
+			}
+			else if (textureFilter != "box") {
+				std::cerr << "error: unknown texture filter '" << textureFilter << "'\n";
+				return EXIT_FAILURE;
+			}
+			const std::string imageFormat = result["image-format"].as<std::string>();
+			const int jpegQuality = std::clamp(result["jpeg-quality"].as<int>(), 1, 100);
+			if (imageFormat == "jpeg") {
+				w.setImageEncoding(IvGltfImageEncoding::JPEG, jpegQuality);
+			}
+			else if (imageFormat == "auto") {
+				w.setImageEncoding(IvGltfImageEncoding::AUTO, jpegQuality);
+			}
+			else if (imageFormat != "png") {
+				std::cerr << "error: unknown image format '" << imageFormat << "'\n";
+				return EXIT_FAILURE;
+			}
+			w.setExternalFiles(result["external-files"].as<bool>(), result["external-dir"].as<std::string>());
+			w.setCullInvisible(result["cull-invisible"].as<bool>());
+			w.setMinimumShapeSize(result["min-size"].as<float>());
+			if (result.count("crop")) {
+				SbBox3f cropBox;
+				if (!parseBox(result["crop"].as<std::string>(), cropBox)) {
+					return EXIT_FAILURE;
+				}
+				w.setCropBox(cropBox);
+			}
 			if (!w.write(result["o"].as<std::string>().c_str())) {
 				return EXIT_FAILURE;
 			}
+			if (result["v"].as<bool>()) {
+				const IvGltfBufferStatistics& stats = w.bufferStatistics();
+				std::cout << "buffer: " << stats.chunks << " chunks, " << stats.copies << " copies, "
+					<< stats.bytesCopied << " bytes copied, peak staged " << stats.peakStagedBytes
+					<< " bytes, peak " << stats.peakBytes << " bytes\n";
+			}
 		}
 		else {
 			return EXIT_FAILURE;
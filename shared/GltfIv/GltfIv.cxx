@@ -1,29 +1,521 @@
 #include "GltfIv.h"
+#include "GltfIvMeshoptDecoder.h"
 
 #include <spdlog/stopwatch.h>
 
 #include <Inventor/actions/SoWriteAction.h>
 #include <Inventor/SoOutput.h>
 
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <numeric>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+    // a one byte buffer that stands in for buffers whose data tinygltf must not load
+    constexpr const char * placeholder_uri{ "data:application/octet-stream;base64,AA==" };
+
+    const std::string meshopt_extension{ "EXT_meshopt_compression" };
+
+    // images in a buffer view stay where they are, the encoded bytes of all other images are
+    // kept in the image. as_is marks both as not yet decoded.
+    bool deferImageData(tinygltf::Image * image, const int, std::string *, std::string *, int, int, const unsigned char * bytes, int size, void *)
+    {
+        if (image->bufferView < 0) {
+            image->image.assign(bytes, bytes + size);
+        }
+        image->as_is = true;
+        return true;
+    }
+
+    bool skipImageData(tinygltf::Image *, const int, std::string *, std::string *, int, int, const unsigned char *, int, void *)
+    {
+        return true;
+    }
+
+    constexpr uint32_t glb_magic{ 0x46546C67U };
+    constexpr uint32_t json_chunk_type{ 0x4E4F534AU };
+    constexpr uint32_t binary_chunk_type{ 0x004E4942U };
+    constexpr size_t header_size{ 12U };
+    constexpr size_t chunk_header_size{ 8U };
+
+    struct glb_chunks_t {
+        std::span<const unsigned char> json;
+        std::span<const unsigned char> binary;
+    };
+
+    uint32_t readUint32(std::span<const unsigned char> bytes, size_t offset)
+    {
+        uint32_t value;
+        std::memcpy(&value, bytes.data() + offset, sizeof(value));
+        return value;
+    }
+
+    // splits a glb into its json and optional binary chunk
+    std::optional<glb_chunks_t> glbChunks(std::span<const unsigned char> bytes)
+    {
+        if (bytes.size() < header_size + chunk_header_size || readUint32(bytes, 0U) != glb_magic) {
+            spdlog::error("not a glb file");
+            return std::nullopt;
+        }
+        if (readUint32(bytes, 4U) != 2U) {
+            spdlog::error("unsupported glb version {}", readUint32(bytes, 4U));
+            return std::nullopt;
+        }
+        const size_t length{ std::min<size_t>(readUint32(bytes, 8U), bytes.size()) };
+
+        glb_chunks_t chunks;
+        size_t offset{ header_size };
+        while (offset + chunk_header_size <= length) {
+            const size_t chunkLength{ readUint32(bytes, offset) };
+            const uint32_t chunkType{ readUint32(bytes, offset + 4U) };
+            offset += chunk_header_size;
+            if (chunkLength > length - offset) {
+                spdlog::error("glb chunk of {} bytes exceeds the file", chunkLength);
+                return std::nullopt;
+            }
+            if (chunkType == json_chunk_type && chunks.json.empty()) {
+                chunks.json = bytes.subspan(offset, chunkLength);
+            }
+            else if (chunkType == binary_chunk_type && chunks.binary.empty()) {
+                chunks.binary = bytes.subspan(offset, chunkLength);
+            }
+            offset += (chunkLength + 3U) & ~size_t{ 3U };
+        }
+
+        if (chunks.json.empty()) {
+            spdlog::error("glb file without json chunk");
+            return std::nullopt;
+        }
+        return chunks;
+    }
+
+    void appendUint32(std::vector<unsigned char> & bytes, uint32_t value)
+    {
+        const size_t offset{ bytes.size() };
+        bytes.resize(offset + sizeof(value));
+        std::memcpy(bytes.data() + offset, &value, sizeof(value));
+    }
+
+    // a glb of the json and the binary chunk, both padded to 4 bytes
+    std::vector<unsigned char> assembleGlb(const std::string & json, std::span<const unsigned char> binary)
+    {
+        const size_t jsonLength{ (json.size() + 3U) & ~size_t{ 3U } };
+        const size_t binaryLength{ (binary.size() + 3U) & ~size_t{ 3U } };
+
+        std::vector<unsigned char> bytes;
+        bytes.reserve(header_size + chunk_header_size + jsonLength + chunk_header_size + binaryLength);
+        appendUint32(bytes, glb_magic);
+        appendUint32(bytes, 2U);
+        appendUint32(bytes, static_cast<uint32_t>(header_size + chunk_header_size + jsonLength + (binary.empty() ? 0U : chunk_header_size + binaryLength)));
+        appendUint32(bytes, static_cast<uint32_t>(jsonLength));
+        appendUint32(bytes, json_chunk_type);
+        bytes.insert(bytes.end(), json.cbegin(), json.cend());
+        bytes.resize(bytes.size() + jsonLength - json.size(), ' ');
+        if (!binary.empty()) {
+            appendUint32(bytes, static_cast<uint32_t>(binaryLength));
+            appendUint32(bytes, binary_chunk_type);
+            bytes.insert(bytes.end(), binary.begin(), binary.end());
+            bytes.resize(bytes.size() + binaryLength - binary.size(), 0U);
+        }
+        return bytes;
+    }
+
+    // an image in a buffer view of the binary chunk, replaced while tinygltf parses the json
+    struct binary_image_t {
+        size_t image;
+        int bufferView;
+        std::string mimeType;
+    };
+
+    std::optional<nlohmann::json> parseJson(std::span<const unsigned char> bytes)
+    {
+        nlohmann::json json = nlohmann::json::parse(bytes.begin(), bytes.end(), nullptr, false);
+        if (json.is_discarded() || !json.is_object()) {
+            return std::nullopt;
+        }
+        return json;
+    }
+
+    // tinygltf copies the binary chunk of a glb into the first buffer. parsing the json as ascii
+    // gltf instead with a one byte placeholder for the first buffer and for the images in it
+    // leaves the chunk where it is. leaves the json unchanged if the first buffer is external.
+    bool replaceBinaryChunk(nlohmann::json & json, std::span<const unsigned char> binaryChunk, std::vector<binary_image_t> & binaryImages, bool & replaced)
+    {
+        const std::string placeholder{ placeholder_uri };
+
+        replaced = false;
+        const auto buffersIt{ json.find("buffers") };
+        if (buffersIt == json.end() || !buffersIt->is_array() || buffersIt->empty() || !(*buffersIt)[0].is_object() || (*buffersIt)[0].contains("uri")) {
+            return true;
+        }
+        nlohmann::json & buffers{ *buffersIt };
+
+        const size_t byteLength{ buffers[0].value("byteLength", size_t{ 0U }) };
+        if (byteLength > binaryChunk.size()) {
+            spdlog::error("glb buffer of {} bytes exceeds the binary chunk of {} bytes", byteLength, binaryChunk.size());
+            return false;
+        }
+        buffers[0]["uri"] = placeholder;
+        buffers[0]["byteLength"] = 1;
+
+        const nlohmann::json bufferViews = json.value("bufferViews", nlohmann::json::array());
+        const auto imagesIt{ json.find("images") };
+        for (size_t i = 0; imagesIt != json.end() && imagesIt->is_array() && i < imagesIt->size(); ++i) {
+            nlohmann::json & image{ (*imagesIt)[i] };
+            if (!image.is_object() || !image.contains("bufferView") || !image["bufferView"].is_number_integer()) {
+                continue;
+            }
+            const int bufferView{ image["bufferView"].get<int>() };
+            if (bufferView < 0 || !bufferViews.is_array() || static_cast<size_t>(bufferView) >= bufferViews.size() || bufferViews[static_cast<size_t>(bufferView)].value("buffer", -1) != 0) {
+                continue;
+            }
+            binaryImages.push_back(binary_image_t{ i, bufferView, image.value("mimeType", std::string{}) });
+            image.erase("bufferView");
+            image["uri"] = placeholder;
+        }
+
+        replaced = true;
+        return true;
+    }
+
+    // puts the binary chunk of the mapped file in place of the placeholders. the images in it are
+    // deferred as they would have been in their buffer view.
+    void restoreBinaryChunk(GltfIvModel & model, const std::vector<binary_image_t> & binaryImages, GltfIvImageLoading imageLoading)
+    {
+        if (!model.buffers.empty()) {
+            model.buffers[0].data = std::vector<unsigned char>{};
+            model.buffers[0].uri.clear();
+        }
+        for (const binary_image_t & binaryImage : binaryImages) {
+            tinygltf::Image & image{ model.images.at(binaryImage.image) };
+            image.image = std::vector<unsigned char>{};
+            image.uri.clear();
+            image.bufferView = binaryImage.bufferView;
+            image.mimeType = binaryImage.mimeType;
+            image.as_is = imageLoading != GltfIvImageLoading::SKIP;
+        }
+    }
+
+    // a fallback buffer of meshopt compressed buffer views, which need not have any data
+    struct fallback_buffer_t {
+        size_t buffer;
+        size_t byteLength;
+    };
+
+    // tinygltf rejects buffers without uri outside of the binary chunk of a glb. the fallback
+    // buffers of meshopt compression get a placeholder instead and are allocated after parsing.
+    void replaceMeshoptFallbacks(nlohmann::json & json, std::vector<fallback_buffer_t> & fallbacks)
+    {
+        const std::string placeholder{ placeholder_uri };
+
+        const auto buffersIt{ json.find("buffers") };
+        for (size_t i = 0; buffersIt != json.end() && buffersIt->is_array() && i < buffersIt->size(); ++i) {
+            nlohmann::json & buffer{ (*buffersIt)[i] };
+            if (!buffer.is_object() || buffer.contains("uri")) {
+                continue;
+            }
+            const auto extensionsIt{ buffer.find("extensions") };
+            if (extensionsIt == buffer.end() || !extensionsIt->is_object() || !extensionsIt->contains(meshopt_extension)) {
+                continue;
+            }
+            fallbacks.push_back(fallback_buffer_t{ i, buffer.value("byteLength", size_t{ 0U }) });
+            buffer["uri"] = placeholder;
+            buffer["byteLength"] = 1;
+        }
+    }
+
+    void restoreMeshoptFallbacks(GltfIvModel & model, const std::vector<fallback_buffer_t> & fallbacks)
+    {
+        for (const fallback_buffer_t & fallback : fallbacks) {
+            tinygltf::Buffer & buffer{ model.buffers.at(fallback.buffer) };
+            buffer.uri.clear();
+            buffer.data = std::vector<unsigned char>(fallback.byteLength);
+        }
+    }
+
+    std::optional<std::string> readText(const std::string & filename)
+    {
+        std::ifstream file{ filename, std::ios::binary };
+        if (!file) {
+            return std::nullopt;
+        }
+        return std::string{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+    }
+
+    size_t extensionNumber(const tinygltf::Value & extension, const std::string & key, size_t fallback)
+    {
+        if (!extension.Has(key) || !extension.Get(key).IsNumber()) {
+            return fallback;
+        }
+        return static_cast<size_t>(extension.Get(key).GetNumberAsDouble());
+    }
+
+    std::string extensionString(const tinygltf::Value & extension, const std::string & key, const std::string & fallback)
+    {
+        if (!extension.Has(key) || !extension.Get(key).IsString()) {
+            return fallback;
+        }
+        return extension.Get(key).Get<std::string>();
+    }
+
+    // decodes the compressed data of a buffer view into the buffer view itself
+    bool decodeMeshoptBufferView(GltfIvModel & model, size_t bufferViewIndex)
+    {
+        const tinygltf::BufferView & bufferView{ model.bufferViews[bufferViewIndex] };
+        const tinygltf::Value & extension{ bufferView.extensions.at(meshopt_extension) };
+        const size_t sourceBuffer{ extensionNumber(extension, "buffer", model.buffers.size()) };
+        const size_t byteOffset{ extensionNumber(extension, "byteOffset", 0U) };
+        const size_t byteLength{ extensionNumber(extension, "byteLength", 0U) };
+        const size_t byteStride{ extensionNumber(extension, "byteStride", 0U) };
+        const size_t count{ extensionNumber(extension, "count", 0U) };
+        const std::string mode{ extensionString(extension, "mode", "") };
+        const std::string filter{ extensionString(extension, "filter", "NONE") };
+        spdlog::trace("decoding {} elements of meshopt compressed buffer view {} in mode {} with filter {}", count, bufferViewIndex, mode, filter);
+
+        if (sourceBuffer >= model.buffers.size() || bufferView.buffer < 0 || static_cast<size_t>(bufferView.buffer) >= model.buffers.size()) {
+            spdlog::error("buffer of meshopt compressed buffer view {} not found", bufferViewIndex);
+            return false;
+        }
+        const std::span<const unsigned char> source{ model.bufferData(sourceBuffer) };
+        if (byteLength > source.size() || byteOffset > source.size() - byteLength) {
+            spdlog::error("compressed data of buffer view {} is outside of buffer {}", bufferViewIndex, sourceBuffer);
+            return false;
+        }
+        if (bufferView.buffer == 0 && model.mapping) {
+            spdlog::error("cannot decode buffer view {} into the binary chunk of the glb", bufferViewIndex);
+            return false;
+        }
+        std::vector<unsigned char> & target{ model.buffers[static_cast<size_t>(bufferView.buffer)].data };
+        if (byteStride == 0U || count > bufferView.byteLength / byteStride || bufferView.byteLength > target.size() || bufferView.byteOffset > target.size() - bufferView.byteLength) {
+            spdlog::error("decoded data of buffer view {} does not fit into buffer {}", bufferViewIndex, bufferView.buffer);
+            return false;
+        }
+
+        const std::span<const unsigned char> compressed{ source.subspan(byteOffset, byteLength) };
+        const std::span<unsigned char> destination{ target.data() + bufferView.byteOffset, count * byteStride };
+        bool success{ false };
+        if (mode == "ATTRIBUTES") {
+            success = GltfIvMeshoptDecoder::decodeVertexBuffer(destination, count, byteStride, compressed);
+            if (success && filter == "OCTAHEDRAL") {
+                success = GltfIvMeshoptDecoder::decodeOctahedralFilter(destination, count, byteStride);
+            }
+            else if (success && filter == "QUATERNION") {
+                success = GltfIvMeshoptDecoder::decodeQuaternionFilter(destination, count, byteStride);
+            }
+            else if (success && filter == "EXPONENTIAL") {
+                success = GltfIvMeshoptDecoder::decodeExponentialFilter(destination, count, byteStride);
+            }
+            else if (filter != "NONE") {
+                success = false;
+            }
+        }
+        else if (mode == "TRIANGLES") {
+            success = GltfIvMeshoptDecoder::decodeIndexBuffer(destination, count, byteStride, compressed);
+        }
+        else if (mode == "INDICES") {
+            success = GltfIvMeshoptDecoder::decodeIndexSequence(destination, count, byteStride, compressed);
+        }
 
-std::optional<tinygltf::Model> GltfIv::read(std::string filename) 
+        if (!success) {
+            spdlog::error("failed to decode meshopt compressed buffer view {} in mode '{}' with filter '{}'", bufferViewIndex, mode, filter);
+        }
+        return success;
+    }
+
+}
+
+std::span<const unsigned char> GltfIvModel::bufferData(size_t bufferIndex) const
+{
+    if (bufferIndex == 0U && mapping) {
+        return binaryChunk;
+    }
+    const tinygltf::Buffer & buffer{ buffers.at(bufferIndex) };
+    return { buffer.data.data(), buffer.data.size() };
+}
+
+std::shared_ptr<const GltfIvFileMapping> GltfIvFileMapping::map(const std::string & filename)
+{
+    std::shared_ptr<GltfIvFileMapping> mapping{ new GltfIvFileMapping };
+
+#ifdef _WIN32
+    HANDLE file{ CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+    if (file == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+    mapping->m_file = file;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        return nullptr;
+    }
+    mapping->m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping->m_mapping == nullptr) {
+        return nullptr;
+    }
+    mapping->m_data = static_cast<const unsigned char *>(MapViewOfFile(mapping->m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (mapping->m_data == nullptr) {
+        return nullptr;
+    }
+    mapping->m_size = static_cast<size_t>(size.QuadPart);
+#else
+    const int file{ open(filename.c_str(), O_RDONLY) };
+    if (file < 0) {
+        return nullptr;
+    }
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size <= 0) {
+        close(file);
+        return nullptr;
+    }
+    void * data{ mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0) };
+    close(file);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+    mapping->m_data = static_cast<const unsigned char *>(data);
+    mapping->m_size = static_cast<size_t>(status.st_size);
+#endif
+
+    spdlog::trace("mapped {} bytes of file {}", mapping->m_size, filename);
+    return mapping;
+}
+
+GltfIvFileMapping::~GltfIvFileMapping()
+{
+#ifdef _WIN32
+    if (m_data != nullptr) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping != nullptr) {
+        CloseHandle(m_mapping);
+    }
+    if (m_file != nullptr) {
+        CloseHandle(m_file);
+    }
+#else
+    if (m_data != nullptr) {
+        munmap(const_cast<unsigned char *>(m_data), m_size);
+    }
+#endif
+}
+
+std::optional<GltfIvModel> GltfIv::read(std::string filename, GltfIvImageLoading imageLoading) 
 {
     spdlog::stopwatch stopwatch;
     spdlog::trace("reading gltf model from file {}", filename);
-    tinygltf::Model model;
+    GltfIvModel model;
     tinygltf::TinyGLTF loader;
     std::string error_message;
     std::string warning_message;
     bool success{ false };
 
+    std::shared_ptr<const GltfIvFileMapping> mapping;
+    if (filename.ends_with(".glb")) {
+        mapping = GltfIvFileMapping::map(filename);
+        if (!mapping) {
+            spdlog::debug("failed to map gltf file {}, reading it instead", filename);
+        }
+    }
+
+    // the images of a mapped glb are deferred while parsing and decoded in parallel afterwards
+    if (mapping && imageLoading == GltfIvImageLoading::DECODE) {
+        loader.SetImageLoader(deferImageData, nullptr);
+    }
+
+    switch (imageLoading) {
+    case GltfIvImageLoading::DEFER:
+        spdlog::debug("deferring decoding of gltf images");
+        loader.SetImageLoader(deferImageData, nullptr);
+        break;
+    case GltfIvImageLoading::SKIP:
+        spdlog::debug("skipping gltf images");
+        loader.SetImageLoader(skipImageData, nullptr);
+        break;
+    default:
+        break;
+    }
+
+    std::vector<fallback_buffer_t> fallbacks;
     if (filename.ends_with(".gltf")) {
         spdlog::debug("reading gltf file {} as ascii", filename);
-        success = loader.LoadASCIIFromFile(&model, &error_message, &warning_message, filename);
+        std::optional<std::string> text{ readText(filename) };
+        if (!text.has_value()) {
+            spdlog::error("failed to open file {}", filename);
+            return std::nullopt;
+        }
+        // only files with meshopt compression are patched before tinygltf parses them
+        if (text.value().find(meshopt_extension) != std::string::npos) {
+            std::optional<nlohmann::json> json{ parseJson({ reinterpret_cast<const unsigned char *>(text.value().data()), text.value().size() }) };
+            if (json.has_value()) {
+                replaceMeshoptFallbacks(json.value(), fallbacks);
+                text = json.value().dump();
+            }
+        }
+        success = loader.LoadASCIIFromString(&model, &error_message, &warning_message, text.value().c_str(), static_cast<unsigned int>(text.value().size()), tinygltf::GetBaseDir(filename));
+    }
+    else if (filename.ends_with(".glb") && mapping) {
+        spdlog::debug("reading gltf file {} as mapped binary", filename);
+        const std::optional<glb_chunks_t> chunks{ glbChunks(mapping->bytes()) };
+        std::optional<nlohmann::json> json{ chunks.has_value() ? parseJson(chunks.value().json) : std::nullopt };
+        if (chunks.has_value() && !json.has_value()) {
+            spdlog::error("failed to parse the json chunk of the glb file");
+        }
+        std::vector<binary_image_t> binaryImages;
+        bool replaced{ false };
+        if (json.has_value() && replaceBinaryChunk(json.value(), chunks.value().binary, binaryImages, replaced)) {
+            replaceMeshoptFallbacks(json.value(), fallbacks);
+            const std::string text{ json.value().dump() };
+            success = loader.LoadASCIIFromString(&model, &error_message, &warning_message, text.c_str(), static_cast<unsigned int>(text.size()), tinygltf::GetBaseDir(filename));
+        }
+        if (success && replaced) {
+            restoreBinaryChunk(model, binaryImages, imageLoading);
+            model.mapping = mapping;
+            model.binaryChunk = chunks.value().binary;
+        }
+        if (success && imageLoading == GltfIvImageLoading::DECODE) {
+            std::vector<size_t> imageIndices(model.images.size());
+            std::iota(imageIndices.begin(), imageIndices.end(), size_t{ 0U });
+            decodeImages(model, imageIndices);
+        }
     }
     else if (filename.ends_with(".glb")) {
         spdlog::debug("reading gltf file {} as binary", filename);
-        success = loader.LoadBinaryFromFile(&model, &error_message, &warning_message, filename);
+        const std::optional<std::string> bytes{ readText(filename) };
+        if (!bytes.has_value()) {
+            spdlog::error("failed to open file {}", filename);
+            return std::nullopt;
+        }
+        const std::span<const unsigned char> glb{ reinterpret_cast<const unsigned char *>(bytes.value().data()), bytes.value().size() };
+        // the json of files with meshopt compression is patched as for the mapped file
+        std::vector<unsigned char> patched;
+        if (bytes.value().find(meshopt_extension) != std::string::npos) {
+            const std::optional<glb_chunks_t> chunks{ glbChunks(glb) };
+            std::optional<nlohmann::json> json{ chunks.has_value() ? parseJson(chunks.value().json) : std::nullopt };
+            if (json.has_value()) {
+                replaceMeshoptFallbacks(json.value(), fallbacks);
+                patched = assembleGlb(json.value().dump(), chunks.value().binary);
+            }
+        }
+        const std::span<const unsigned char> data{ patched.empty() ? glb : std::span<const unsigned char>{ patched } };
+        success = loader.LoadBinaryFromMemory(&model, &error_message, &warning_message, data.data(), static_cast<unsigned int>(data.size()), tinygltf::GetBaseDir(filename));
     }
     else {
         spdlog::error("unknown gltf file type. supported types are .gltf and .glb");
@@ -42,6 +534,12 @@ std::optional<tinygltf::Model> GltfIv::read(std::string filename)
         spdlog::error("failed to read gltf file");
         return std::nullopt;
     }
+
+    restoreMeshoptFallbacks(model, fallbacks);
+    if (std::find(model.extensionsUsed.cbegin(), model.extensionsUsed.cend(), meshopt_extension) != model.extensionsUsed.cend() && !decodeMeshopt(model)) {
+        spdlog::error("failed to decode the meshopt compressed data of the gltf file");
+        return std::nullopt;
+    }
     spdlog::debug("successfully read gltf model from file {} ({} seconds)", filename, stopwatch);
     return model;
 }
@@ -64,3 +562,123 @@ bool GltfIv::write(std::string filename, SoSeparator * root, bool isBinary)
     spdlog::debug("successfully wrote open inventor model to file {} as {} ({} seconds)", filename, (isBinary ? "binary" : "ascii"), stopwatch);
     return true;
 }
+
+bool GltfIv::decodeImage(const GltfIvModel & model, tinygltf::Image & image)
+{
+    if (!image.as_is) {
+        return !image.image.empty();
+    }
+
+    std::vector<unsigned char> encoded;
+    const unsigned char * bytes{ nullptr };
+    size_t size{ 0U };
+
+    if (!image.image.empty()) {
+        encoded.swap(image.image);
+        bytes = encoded.data();
+        size = encoded.size();
+    }
+    else if (image.bufferView >= 0 && static_cast<size_t>(image.bufferView) < model.bufferViews.size()) {
+        const tinygltf::BufferView & bufferView{ model.bufferViews[static_cast<size_t>(image.bufferView)] };
+        if (bufferView.buffer < 0 || static_cast<size_t>(bufferView.buffer) >= model.buffers.size()) {
+            spdlog::error("buffer of gltf image '{}' not found at index {}", image.name, bufferView.buffer);
+            return false;
+        }
+        const std::span<const unsigned char> buffer{ model.bufferData(static_cast<size_t>(bufferView.buffer)) };
+        if (bufferView.byteLength > buffer.size() || bufferView.byteOffset > buffer.size() - bufferView.byteLength) {
+            spdlog::error("buffer view of gltf image '{}' is outside of its buffer", image.name);
+            return false;
+        }
+        bytes = buffer.data() + bufferView.byteOffset;
+        size = bufferView.byteLength;
+    }
+    else {
+        spdlog::error("no encoded data for gltf image '{}'", image.name);
+        return false;
+    }
+
+    spdlog::trace("decoding gltf image '{}' from {} bytes", image.name, size);
+
+    std::string error_message;
+    std::string warning_message;
+    image.as_is = false;
+    const bool success{ tinygltf::LoadImageData(&image, -1, &error_message, &warning_message, 0, 0, bytes, static_cast<int>(size), nullptr) };
+
+    if (!warning_message.empty()) {
+        spdlog::warn("decoding gltf image '{}': {}", image.name, warning_message);
+    }
+    if (!success) {
+        spdlog::error("failed to decode gltf image '{}': {}", image.name, error_message);
+        image.image.clear();
+        return false;
+    }
+    return true;
+}
+
+void GltfIv::decodeImages(GltfIvModel & model, const std::vector<size_t> & imageIndices, unsigned threadCount)
+{
+    spdlog::stopwatch stopwatch;
+    if (threadCount == 0U) {
+        threadCount = std::max(1U, std::thread::hardware_concurrency());
+    }
+    const size_t workerCount{ std::min<size_t>(threadCount, imageIndices.size()) };
+    spdlog::trace("decoding {} gltf images on {} threads", imageIndices.size(), workerCount);
+
+    std::atomic<size_t> nextImage{ 0U };
+    auto decodeNextImages = [&model, &imageIndices, &nextImage] ()
+    {
+        for (size_t i = nextImage++; i < imageIndices.size(); i = nextImage++) {
+            if (imageIndices[i] < model.images.size()) {
+                decodeImage(model, model.images[imageIndices[i]]);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1U; i < workerCount; ++i) {
+        threads.emplace_back(decodeNextImages);
+    }
+    decodeNextImages();
+    std::for_each(threads.begin(), threads.end(), [] (std::thread & thread) { thread.join(); });
+
+    spdlog::debug("decoded {} gltf images ({:.3} seconds)", imageIndices.size(), stopwatch);
+}
+
+bool GltfIv::decodeMeshopt(GltfIvModel & model, unsigned threadCount)
+{
+    spdlog::stopwatch stopwatch;
+    std::vector<size_t> bufferViewIndices;
+    for (size_t i = 0; i < model.bufferViews.size(); ++i) {
+        if (model.bufferViews[i].extensions.contains(meshopt_extension)) {
+            bufferViewIndices.push_back(i);
+        }
+    }
+
+    if (threadCount == 0U) {
+        threadCount = std::max(1U, std::thread::hardware_concurrency());
+    }
+    const size_t workerCount{ std::min<size_t>(threadCount, bufferViewIndices.size()) };
+    spdlog::trace("decoding {} meshopt compressed buffer views on {} threads", bufferViewIndices.size(), workerCount);
+
+    // the buffer views are decoded into separate ranges of their buffers
+    std::atomic<size_t> nextBufferView{ 0U };
+    std::atomic<bool> success{ true };
+    auto decodeNextBufferViews = [&model, &bufferViewIndices, &nextBufferView, &success] ()
+    {
+        for (size_t i = nextBufferView++; i < bufferViewIndices.size(); i = nextBufferView++) {
+            if (!decodeMeshoptBufferView(model, bufferViewIndices[i])) {
+                success = false;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1U; i < workerCount; ++i) {
+        threads.emplace_back(decodeNextBufferViews);
+    }
+    decodeNextBufferViews();
+    std::for_each(threads.begin(), threads.end(), [] (std::thread & thread) { thread.join(); });
+
+    spdlog::debug("decoded {} meshopt compressed buffer views ({:.3} seconds)", bufferViewIndices.size(), stopwatch);
+    return success;
+}
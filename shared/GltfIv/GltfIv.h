@@ -10,12 +10,77 @@
 
 #include <Inventor/nodes/SoSeparator.h>
 
+#include <memory>
 #include <string>
 #include <optional>
+#include <span>
+#include <vector>
+
+// what happens to the images of a gltf file while reading it
+enum class GltfIvImageLoading {
+    DECODE, // decode all images to rgba, tinygltf's default
+    DEFER,  // keep the encoded images and decode them with GltfIv::decodeImages when needed
+    SKIP    // do not load any image data
+};
+
+// read-only memory mapping of a whole file
+class GltfIvFileMapping
+{
+public:
+    // returns nullptr if the file cannot be mapped
+    static std::shared_ptr<const GltfIvFileMapping> map(const std::string & filename);
+
+    GltfIvFileMapping(const GltfIvFileMapping &) = delete;
+    GltfIvFileMapping & operator=(const GltfIvFileMapping &) = delete;
+    ~GltfIvFileMapping();
+
+    std::span<const unsigned char> bytes() const
+    {
+        return { m_data, m_size };
+    }
+
+private:
+    GltfIvFileMapping() = default;
+
+    const unsigned char * m_data{ nullptr };
+    size_t m_size{ 0U };
+#ifdef _WIN32
+    void * m_file{ nullptr };
+    void * m_mapping{ nullptr };
+#endif
+};
+
+// a gltf model that can keep the binary chunk of a glb in a mapping of the file instead of
+// copying it into its first buffer
+struct GltfIvModel : tinygltf::Model
+{
+    GltfIvModel() = default;
+    GltfIvModel(tinygltf::Model && model)
+        : tinygltf::Model{ std::move(model) }
+    {
+    }
+
+    // the bytes of a buffer, for the first buffer of a mapped glb the binary chunk in the file
+    std::span<const unsigned char> bufferData(size_t bufferIndex) const;
+
+    std::shared_ptr<const GltfIvFileMapping> mapping; // null if all buffers hold their data
+    std::span<const unsigned char> binaryChunk;
+};
 
 class GltfIv
 {
 public:
-    static std::optional<tinygltf::Model> read(std::string filename);
+    // a glb is mapped into memory and its binary chunk is read in place, without a copy
+    static std::optional<GltfIvModel> read(std::string filename, GltfIvImageLoading imageLoading = GltfIvImageLoading::DECODE);
     static bool write(std::string filename, SoSeparator * root, bool isBinary);
+
+    // decodes a deferred image in place, images embedded in a buffer view are decoded straight
+    // from the buffer. returns whether the image holds decoded pixels afterwards.
+    static bool decodeImage(const GltfIvModel & model, tinygltf::Image & image);
+    // decodes the given deferred images on up to threadCount threads, 0 uses all cores
+    static void decodeImages(GltfIvModel & model, const std::vector<size_t> & imageIndices, unsigned threadCount = 0U);
+
+    // decodes the buffer views compressed with EXT_meshopt_compression into their buffers on
+    // up to threadCount threads, 0 uses all cores. returns false if any of them fails.
+    static bool decodeMeshopt(GltfIvModel & model, unsigned threadCount = 0U);
 };
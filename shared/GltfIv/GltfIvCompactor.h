@@ -0,0 +1,253 @@
+#pragma once
+
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoMultipleCopy.h>
+#include <Inventor/nodes/SoShape.h>
+#include <Inventor/nodes/SoTransform.h>
+#include <Inventor/nodes/SoTranslation.h>
+#include <Inventor/nodes/SoRotation.h>
+#include <Inventor/nodes/SoScale.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
+#include <Inventor/nodes/SoNormalBinding.h>
+#include <Inventor/nodes/SoTextureCoordinateBinding.h>
+
+#include <spdlog/spdlog.h>
+
+#include <cmath>
+#include <optional>
+#include <unordered_map>
+
+// simplifies a converted scene graph without changing what it shows. a translation, rotation
+// and scale in this order become one transform, identity transformations are removed,
+// bindings repeating the value bound before them in the same group are removed and unnamed
+// separators holding a single separator or shape are replaced by it. nodes used more than
+// once are compacted once and replaced in every parent.
+class GltfIvCompactor {
+public:
+    // compacts everything below the root, the root itself stays. returns the number of nodes
+    // that were removed or merged.
+    static size_t compact(SoGroup * root)
+    {
+        compaction_t compaction;
+        compactChildren(root, compaction);
+        for (const auto & replacement : compaction.replacements) {
+            replacement.first->unref();
+        }
+        spdlog::debug("compacted the scene graph by {} nodes", compaction.removed);
+        return compaction.removed;
+    }
+
+    // q and -q are the same rotation, so w may be 1 or -1. the streamed writer uses the same
+    // test for the rotations it leaves out.
+    template <typename T>
+    static bool isIdentityRotation(T x, T y, T z, T w)
+    {
+        return x == T(0) && y == T(0) && z == T(0) && std::abs(w) == T(1);
+    }
+
+private:
+    struct compaction_t {
+        // the compacted form of every group visited, nullptr for groups left out. the groups
+        // are referenced until the end, so that their addresses stay unique.
+        std::unordered_map<SoNode *, SoNode *> replacements;
+        size_t removed{ 0U };
+    };
+
+    // returns the node to use instead of the group, or nullptr if it has no effect
+    static SoNode * compactGroup(SoGroup * group, compaction_t & compaction)
+    {
+        const auto replacement{ compaction.replacements.find(group) };
+        if (replacement != compaction.replacements.cend()) {
+            return replacement->second;
+        }
+        group->ref();
+
+        compactChildren(group, compaction);
+
+        SoNode * result{ group };
+        if (group->getTypeId() == SoSeparator::getClassTypeId() && isUnnamed(group)) {
+            if (group->getNumChildren() == 0) {
+                result = nullptr;
+            }
+            else if (group->getNumChildren() == 1 && (group->getChild(0)->getTypeId() == SoSeparator::getClassTypeId() || group->getChild(0)->isOfType(SoShape::getClassTypeId()))) {
+                result = group->getChild(0);
+            }
+        }
+        compaction.replacements.insert(std::make_pair(group, result));
+        return result;
+    }
+
+    static void compactChildren(SoGroup * group, compaction_t & compaction)
+    {
+        for (int i = 0; i < group->getNumChildren(); ++i) {
+            SoNode * child{ group->getChild(i) };
+            if (!child->isOfType(SoGroup::getClassTypeId())) {
+                continue;
+            }
+            SoNode * replacement{ compactGroup(static_cast<SoGroup *>(child), compaction) };
+            if (replacement == nullptr) {
+                group->removeChild(i--);
+                ++compaction.removed;
+            }
+            else if (replacement != child) {
+                group->replaceChild(i, replacement);
+                ++compaction.removed;
+            }
+        }
+
+        removeIdentities(group, compaction);
+        mergeTransformations(group, compaction);
+        removeRepeatedBindings(group, compaction);
+    }
+
+    static bool isUnnamed(const SoNode * node)
+    {
+        return node->getName().getLength() == 0;
+    }
+
+    static bool isZero(const SbVec3f & vector)
+    {
+        return vector[0] == 0.0f && vector[1] == 0.0f && vector[2] == 0.0f;
+    }
+
+    static bool isOne(const SbVec3f & vector)
+    {
+        return vector[0] == 1.0f && vector[1] == 1.0f && vector[2] == 1.0f;
+    }
+
+    static bool isIdentity(const SbRotation & rotation)
+    {
+        const float * quaternion{ rotation.getValue() };
+        return isIdentityRotation(quaternion[0], quaternion[1], quaternion[2], quaternion[3]);
+    }
+
+    static bool isIdentity(const SoNode * node)
+    {
+        if (node->getTypeId() == SoTranslation::getClassTypeId()) {
+            return isZero(static_cast<const SoTranslation *>(node)->translation.getValue());
+        }
+        if (node->getTypeId() == SoRotation::getClassTypeId()) {
+            return isIdentity(static_cast<const SoRotation *>(node)->rotation.getValue());
+        }
+        if (node->getTypeId() == SoScale::getClassTypeId()) {
+            return isOne(static_cast<const SoScale *>(node)->scaleFactor.getValue());
+        }
+        if (node->getTypeId() == SoTransform::getClassTypeId()) {
+            const SoTransform * transform{ static_cast<const SoTransform *>(node) };
+            return isZero(transform->translation.getValue())
+                && isIdentity(transform->rotation.getValue())
+                && isOne(transform->scaleFactor.getValue());
+        }
+        return false;
+    }
+
+    static void removeIdentities(SoGroup * group, compaction_t & compaction)
+    {
+        for (int i = 0; i < group->getNumChildren(); ++i) {
+            if (isIdentity(group->getChild(i))) {
+                group->removeChild(i--);
+                ++compaction.removed;
+            }
+        }
+    }
+
+    // the position of a transformation in translation * rotation * scale, nullopt for others
+    static std::optional<int> transformationOrder(const SoNode * node)
+    {
+        if (node->getTypeId() == SoTranslation::getClassTypeId()) {
+            return 0;
+        }
+        if (node->getTypeId() == SoRotation::getClassTypeId()) {
+            return 1;
+        }
+        if (node->getTypeId() == SoScale::getClassTypeId()) {
+            return 2;
+        }
+        return std::nullopt;
+    }
+
+    static void mergeTransformations(SoGroup * group, compaction_t & compaction)
+    {
+        for (int i = 0; i < group->getNumChildren(); ++i) {
+            std::optional<int> order{ transformationOrder(group->getChild(i)) };
+            if (!order.has_value()) {
+                continue;
+            }
+
+            int end{ i + 1 };
+            for (; end < group->getNumChildren(); ++end) {
+                const std::optional<int> nextOrder{ transformationOrder(group->getChild(end)) };
+                if (!nextOrder.has_value() || nextOrder.value() <= order.value()) {
+                    break;
+                }
+                order = nextOrder;
+            }
+            if (end - i < 2) {
+                continue;
+            }
+
+            SoTransform * transform{ new SoTransform };
+            for (int j = i; j < end; ++j) {
+                const SoNode * child{ group->getChild(j) };
+                if (child->getTypeId() == SoTranslation::getClassTypeId()) {
+                    transform->translation = static_cast<const SoTranslation *>(child)->translation.getValue();
+                }
+                else if (child->getTypeId() == SoRotation::getClassTypeId()) {
+                    transform->rotation = static_cast<const SoRotation *>(child)->rotation.getValue();
+                }
+                else {
+                    transform->scaleFactor = static_cast<const SoScale *>(child)->scaleFactor.getValue();
+                }
+            }
+            group->replaceChild(i, transform);
+            for (int j = i + 1; j < end; ++j) {
+                group->removeChild(i + 1);
+                ++compaction.removed;
+            }
+        }
+    }
+
+    // a binding is repeated when the last binding of its type in the group has the same value.
+    // groups without their own state, other than multiple copies, may change the bindings.
+    static void removeRepeatedBindings(SoGroup * group, compaction_t & compaction)
+    {
+        std::optional<int> materialBinding;
+        std::optional<int> normalBinding;
+        std::optional<int> textureCoordinateBinding;
+
+        for (int i = 0; i < group->getNumChildren(); ++i) {
+            SoNode * child{ group->getChild(i) };
+            std::optional<int> * bound{ nullptr };
+            int value{ 0 };
+            if (child->getTypeId() == SoMaterialBinding::getClassTypeId()) {
+                bound = &materialBinding;
+                value = static_cast<SoMaterialBinding *>(child)->value.getValue();
+            }
+            else if (child->getTypeId() == SoNormalBinding::getClassTypeId()) {
+                bound = &normalBinding;
+                value = static_cast<SoNormalBinding *>(child)->value.getValue();
+            }
+            else if (child->getTypeId() == SoTextureCoordinateBinding::getClassTypeId()) {
+                bound = &textureCoordinateBinding;
+                value = static_cast<SoTextureCoordinateBinding *>(child)->value.getValue();
+            }
+            else if (child->isOfType(SoGroup::getClassTypeId()) && !child->isOfType(SoSeparator::getClassTypeId()) && !child->isOfType(SoMultipleCopy::getClassTypeId())) {
+                materialBinding.reset();
+                normalBinding.reset();
+                textureCoordinateBinding.reset();
+                continue;
+            }
+            else {
+                continue;
+            }
+
+            if (*bound == value) {
+                group->removeChild(i--);
+                ++compaction.removed;
+            }
+            else {
+                *bound = value;
+            }
+        }
+    }
+};
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#define GLTFIV_DEQUANTIZE_AVX2
+#define GLTFIV_DEQUANTIZE_SSE2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GLTFIV_DEQUANTIZE_SSE2
+#include <emmintrin.h>
+#endif
+
+// converts integer vertex attributes, as written with KHR_mesh_quantization, to floats. the
+// kernels are instantiated per component type, component count and normalization. packed
+// components are converted eight (avx2) or four (sse2) at a time, interleaved or padded
+// elements are packed in small chunks first. normalized values follow the glTF rules, so
+// signed values are divided by their maximum and clamped to -1.
+class GltfIvDequantizer {
+public:
+    // reads count elements of N components of type C, byteStride bytes apart, and writes
+    // count * N tightly packed floats
+    template<class C, size_t N, bool Normalized>
+    static void dequantize(const unsigned char * data, size_t count, size_t byteStride, float * out)
+    {
+        static_assert(std::is_integral_v<C> && sizeof(C) <= sizeof(uint32_t));
+        constexpr size_t elementSize{ N * sizeof(C) };
+
+        if (byteStride == elementSize) {
+            convert<C, Normalized>(data, count * N, out);
+            return;
+        }
+
+        std::array<unsigned char, chunk_size * elementSize> packed;
+        for (size_t first = 0; first < count; first += chunk_size) {
+            const size_t chunk{ std::min(chunk_size, count - first) };
+            for (size_t i = 0; i < chunk; ++i) {
+                std::memcpy(packed.data() + i * elementSize, data + (first + i) * byteStride, elementSize);
+            }
+            convert<C, Normalized>(packed.data(), chunk * N, out + first * N);
+        }
+    }
+
+    // converts a single component, the vector kernels give the same results
+    template<class C, bool Normalized>
+    static float convert(C value)
+    {
+        if constexpr (!Normalized) {
+            return static_cast<float>(value);
+        }
+        else if constexpr (std::is_signed_v<C>) {
+            return std::max(static_cast<float>(value) * scale<C>(), -1.0f);
+        }
+        else {
+            return static_cast<float>(value) * scale<C>();
+        }
+    }
+
+private:
+    static constexpr size_t chunk_size{ 256U };
+
+    template<class C>
+    static constexpr float scale()
+    {
+        return 1.0f / static_cast<float>(std::numeric_limits<C>::max());
+    }
+
+    // converts count packed components
+    template<class C, bool Normalized>
+    static void convert(const unsigned char * data, size_t count, float * out)
+    {
+        size_t i{ 0U };
+
+#if defined(GLTFIV_DEQUANTIZE_AVX2)
+        if constexpr (sizeof(C) <= sizeof(uint16_t)) {
+            for (; i + 8U <= count; i += 8U) {
+                _mm256_storeu_ps(out + i, finish<C, Normalized>(_mm256_cvtepi32_ps(load8<C>(data + i * sizeof(C)))));
+            }
+        }
+#endif
+
+#if defined(GLTFIV_DEQUANTIZE_SSE2)
+        if constexpr (sizeof(C) <= sizeof(uint16_t)) {
+            for (; i + 4U <= count; i += 4U) {
+                _mm_storeu_ps(out + i, finish<C, Normalized>(_mm_cvtepi32_ps(load4<C>(data + i * sizeof(C)))));
+            }
+        }
+#endif
+
+        for (; i < count; ++i) {
+            C value;
+            std::memcpy(&value, data + i * sizeof(C), sizeof(C));
+            out[i] = convert<C, Normalized>(value);
+        }
+    }
+
+#if defined(GLTFIV_DEQUANTIZE_AVX2)
+    // widens eight components to 32 bit integers
+    template<class C>
+    static __m256i load8(const unsigned char * data)
+    {
+        if constexpr (sizeof(C) == sizeof(uint8_t)) {
+            const __m128i bytes{ _mm_loadl_epi64(reinterpret_cast<const __m128i *>(data)) };
+            return std::is_signed_v<C> ? _mm256_cvtepi8_epi32(bytes) : _mm256_cvtepu8_epi32(bytes);
+        }
+        else {
+            const __m128i shorts{ _mm_loadu_si128(reinterpret_cast<const __m128i *>(data)) };
+            return std::is_signed_v<C> ? _mm256_cvtepi16_epi32(shorts) : _mm256_cvtepu16_epi32(shorts);
+        }
+    }
+
+    template<class C, bool Normalized>
+    static __m256 finish(__m256 values)
+    {
+        if constexpr (!Normalized) {
+            return values;
+        }
+        else if constexpr (std::is_signed_v<C>) {
+            return _mm256_max_ps(_mm256_mul_ps(values, _mm256_set1_ps(scale<C>())), _mm256_set1_ps(-1.0f));
+        }
+        else {
+            return _mm256_mul_ps(values, _mm256_set1_ps(scale<C>()));
+        }
+    }
+#endif
+
+#if defined(GLTFIV_DEQUANTIZE_SSE2)
+    // widens four components to 32 bit integers. sse2 has no sign extension, so signed values
+    // are unpacked into the upper bits and shifted back down arithmetically.
+    template<class C>
+    static __m128i load4(const unsigned char * data)
+    {
+        if constexpr (sizeof(C) == sizeof(uint8_t)) {
+            int32_t word;
+            std::memcpy(&word, data, sizeof(word));
+            const __m128i bytes{ _mm_cvtsi32_si128(word) };
+            if constexpr (std::is_signed_v<C>) {
+                const __m128i shorts{ _mm_unpacklo_epi8(bytes, bytes) };
+                return _mm_srai_epi32(_mm_unpacklo_epi16(shorts, shorts), 24);
+            }
+            else {
+                const __m128i zero{ _mm_setzero_si128() };
+                return _mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero);
+            }
+        }
+        else {
+            const __m128i shorts{ _mm_loadl_epi64(reinterpret_cast<const __m128i *>(data)) };
+            if constexpr (std::is_signed_v<C>) {
+                return _mm_srai_epi32(_mm_unpacklo_epi16(shorts, shorts), 16);
+            }
+            else {
+                return _mm_unpacklo_epi16(shorts, _mm_setzero_si128());
+            }
+        }
+    }
+
+    template<class C, bool Normalized>
+    static __m128 finish(__m128 values)
+    {
+        if constexpr (!Normalized) {
+            return values;
+        }
+        else if constexpr (std::is_signed_v<C>) {
+            return _mm_max_ps(_mm_mul_ps(values, _mm_set1_ps(scale<C>())), _mm_set1_ps(-1.0f));
+        }
+        else {
+            return _mm_mul_ps(values, _mm_set1_ps(scale<C>()));
+        }
+    }
+#endif
+};
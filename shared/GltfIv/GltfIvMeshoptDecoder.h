@@ -0,0 +1,419 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+// decodes buffer views compressed with EXT_meshopt_compression: the vertex codec for
+// attributes, the index codec for triangles and the index sequence codec, plus the filters
+// that are applied to decoded attributes. every function returns false for malformed data
+// and never reads outside of the source or writes outside of the destination.
+class GltfIvMeshoptDecoder {
+public:
+    // count vertices of byteStride bytes, byteStride is a multiple of 4 up to 256
+    static bool decodeVertexBuffer(std::span<unsigned char> destination, size_t count, size_t byteStride, std::span<const unsigned char> source)
+    {
+        if (byteStride == 0U || byteStride > max_vertex_size || byteStride % 4U != 0U || count > destination.size() / byteStride) {
+            return false;
+        }
+        if (source.size() < 1U + byteStride || (source[0] & 0xf0U) != vertex_header || (source[0] & 0x0fU) > 0U) {
+            return false;
+        }
+
+        // the tail holds the vertex the first one is predicted from
+        std::array<unsigned char, max_vertex_size> lastVertex;
+        std::memcpy(lastVertex.data(), source.data() + source.size() - byteStride, byteStride);
+
+        const size_t blockSize{ vertexBlockSize(byteStride) };
+        size_t offset{ 1U };
+        for (size_t first = 0; first < count; first += blockSize) {
+            const size_t blockCount{ std::min(blockSize, count - first) };
+            if (!decodeVertexBlock(source, offset, destination.data() + first * byteStride, blockCount, byteStride, lastVertex)) {
+                return false;
+            }
+        }
+
+        return source.size() - offset == std::max(byteStride, tail_max_size);
+    }
+
+    // count indices of indexSize bytes, three per triangle
+    static bool decodeIndexBuffer(std::span<unsigned char> destination, size_t count, size_t indexSize, std::span<const unsigned char> source)
+    {
+        if (count % 3U != 0U || (indexSize != 2U && indexSize != 4U) || count > destination.size() / indexSize) {
+            return false;
+        }
+        // at least the header, a code per triangle and the table of auxiliary codes
+        if (source.size() < 1U + count / 3U + codeaux_table_size || (source[0] & 0xf0U) != index_header || (source[0] & 0x0fU) > 1U) {
+            return false;
+        }
+
+        std::array<std::array<uint32_t, 2>, fifo_size> edgeFifo;
+        std::array<uint32_t, fifo_size> vertexFifo;
+        edgeFifo.fill({ ~0U, ~0U });
+        vertexFifo.fill(~0U);
+        size_t edgeFifoOffset{ 0U };
+        size_t vertexFifoOffset{ 0U };
+
+        auto pushEdge = [&edgeFifo, &edgeFifoOffset] (uint32_t a, uint32_t b)
+        {
+            edgeFifo[edgeFifoOffset] = { a, b };
+            edgeFifoOffset = (edgeFifoOffset + 1U) & fifo_mask;
+        };
+        auto pushVertex = [&vertexFifo, &vertexFifoOffset] (uint32_t v, bool advance = true)
+        {
+            vertexFifo[vertexFifoOffset] = v;
+            vertexFifoOffset = (vertexFifoOffset + (advance ? 1U : 0U)) & fifo_mask;
+        };
+
+        uint32_t next{ 0U };
+        uint32_t last{ 0U };
+        // version 1 encodes the previous free index plus or minus one in the code
+        const uint32_t fecMax{ (source[0] & 0x0fU) >= 1U ? 13U : 15U };
+
+        const unsigned char * code{ source.data() + 1U };
+        const unsigned char * data{ code + count / 3U };
+        const unsigned char * dataSafeEnd{ source.data() + source.size() - codeaux_table_size };
+        const unsigned char * codeauxTable{ dataSafeEnd };
+
+        for (size_t i = 0; i < count; i += 3U) {
+            // a triangle reads at most 16 bytes, which the codeaux table guarantees
+            if (data > dataSafeEnd) {
+                return false;
+            }
+
+            const uint32_t codeTri{ *code++ };
+            if (codeTri < 0xf0U) {
+                // the first two vertices are an edge of an earlier triangle
+                const std::array<uint32_t, 2> & edge{ edgeFifo[(edgeFifoOffset - 1U - (codeTri >> 4)) & fifo_mask] };
+                const uint32_t a{ edge[0] };
+                const uint32_t b{ edge[1] };
+                const uint32_t fec{ codeTri & 0x0fU };
+
+                if (fec < fecMax) {
+                    const uint32_t c{ fec == 0U ? next++ : vertexFifo[(vertexFifoOffset - 1U - fec) & fifo_mask] };
+                    writeTriangle(destination, i, indexSize, a, b, c);
+                    pushVertex(c, fec == 0U);
+                    pushEdge(c, b);
+                    pushEdge(a, c);
+                }
+                else {
+                    // 13 and 14 are the previous free index minus and plus one
+                    const uint32_t c{ fec != 15U ? last + (fec == 13U ? ~0U : 1U) : decodeIndex(data, last) };
+                    last = c;
+                    writeTriangle(destination, i, indexSize, a, b, c);
+                    pushVertex(c);
+                    pushEdge(c, b);
+                    pushEdge(a, c);
+                }
+            }
+            else {
+                // a table entry or the following byte holds the codes of b and c
+                const uint32_t codeaux{ codeTri < 0xfeU ? codeauxTable[codeTri & 0x0fU] : *data++ };
+                const uint32_t fea{ codeTri == 0xffU ? 15U : 0U };
+                const uint32_t feb{ codeaux >> 4 };
+                const uint32_t fec{ codeaux & 0x0fU };
+
+                // a zero read from the data instead of the table restarts the new vertices
+                if (codeTri >= 0xfeU && codeaux == 0U) {
+                    next = 0U;
+                }
+
+                uint32_t a{ fea == 0U ? next++ : 0U };
+                uint32_t b{ feb == 0U ? next++ : vertexFifo[(vertexFifoOffset - feb) & fifo_mask] };
+                uint32_t c{ fec == 0U ? next++ : vertexFifo[(vertexFifoOffset - fec) & fifo_mask] };
+                // only codes read from the data can stand for free indices
+                const bool freeB{ feb == 15U && codeTri >= 0xfeU };
+                const bool freeC{ fec == 15U && codeTri >= 0xfeU };
+                if (fea == 15U) {
+                    last = a = decodeIndex(data, last);
+                }
+                if (freeB) {
+                    last = b = decodeIndex(data, last);
+                }
+                if (freeC) {
+                    last = c = decodeIndex(data, last);
+                }
+
+                writeTriangle(destination, i, indexSize, a, b, c);
+                pushVertex(a);
+                pushVertex(b, feb == 0U || freeB);
+                pushVertex(c, fec == 0U || freeC);
+                pushEdge(b, a);
+                pushEdge(c, b);
+                pushEdge(a, c);
+            }
+        }
+
+        return data == dataSafeEnd;
+    }
+
+    // count indices of indexSize bytes in any order, delta coded against one of two baselines
+    static bool decodeIndexSequence(std::span<unsigned char> destination, size_t count, size_t indexSize, std::span<const unsigned char> source)
+    {
+        if ((indexSize != 2U && indexSize != 4U) || count > destination.size() / indexSize) {
+            return false;
+        }
+        // at least the header, a byte per index and the tail
+        if (source.size() < 1U + count + sequence_tail_size || (source[0] & 0xf0U) != sequence_header || (source[0] & 0x0fU) > 1U) {
+            return false;
+        }
+
+        const unsigned char * data{ source.data() + 1U };
+        const unsigned char * dataSafeEnd{ source.data() + source.size() - sequence_tail_size };
+        std::array<uint32_t, 2> last{};
+
+        for (size_t i = 0; i < count; ++i) {
+            // an index reads at most 5 bytes, which the tail guarantees
+            if (data >= dataSafeEnd) {
+                return false;
+            }
+            const uint32_t value{ decodeVByte(data) };
+            const uint32_t baseline{ value & 1U };
+            const uint32_t delta{ value >> 1 };
+            last[baseline] += unzigzag(delta);
+            writeIndex(destination, i, indexSize, last[baseline]);
+        }
+
+        return data == dataSafeEnd;
+    }
+
+    // normals or tangents as signed 8 or 16 bit octahedral x and y, z holds the length
+    static bool decodeOctahedralFilter(std::span<unsigned char> data, size_t count, size_t byteStride)
+    {
+        if (count > data.size() / std::max<size_t>(byteStride, 1U)) {
+            return false;
+        }
+        switch (byteStride) {
+        case 4U: decodeOctahedral<int8_t>(data, count); return true;
+        case 8U: decodeOctahedral<int16_t>(data, count); return true;
+        default: return false;
+        }
+    }
+
+    // unit quaternions as the three smallest components in 16 bit, the largest one is
+    // reconstructed and its position is in the lowest two bits of the fourth value
+    static bool decodeQuaternionFilter(std::span<unsigned char> data, size_t count, size_t byteStride)
+    {
+        if (byteStride != 8U || count > data.size() / byteStride) {
+            return false;
+        }
+
+        const float scale{ 1.0f / std::sqrt(2.0f) };
+        for (size_t i = 0; i < count; ++i) {
+            std::array<int16_t, 4> quaternion;
+            std::memcpy(quaternion.data(), data.data() + i * byteStride, sizeof(quaternion));
+
+            const float componentScale{ scale / static_cast<float>(quaternion[3] | 3) };
+            const float x{ static_cast<float>(quaternion[0]) * componentScale };
+            const float y{ static_cast<float>(quaternion[1]) * componentScale };
+            const float z{ static_cast<float>(quaternion[2]) * componentScale };
+            const float ww{ 1.0f - x * x - y * y - z * z };
+            const float w{ std::sqrt(std::max(ww, 0.0f)) };
+
+            const size_t largest{ static_cast<size_t>(quaternion[3] & 3) };
+            quaternion[(largest + 1U) & 3U] = static_cast<int16_t>(roundToInt(x * 32767.0f));
+            quaternion[(largest + 2U) & 3U] = static_cast<int16_t>(roundToInt(y * 32767.0f));
+            quaternion[(largest + 3U) & 3U] = static_cast<int16_t>(roundToInt(z * 32767.0f));
+            quaternion[largest] = static_cast<int16_t>(roundToInt(w * 32767.0f));
+            std::memcpy(data.data() + i * byteStride, quaternion.data(), sizeof(quaternion));
+        }
+        return true;
+    }
+
+    // floats as a signed 24 bit mantissa and a signed 8 bit exponent
+    static bool decodeExponentialFilter(std::span<unsigned char> data, size_t count, size_t byteStride)
+    {
+        if (byteStride == 0U || byteStride % 4U != 0U || count > data.size() / byteStride) {
+            return false;
+        }
+
+        for (size_t i = 0; i < count * byteStride; i += sizeof(uint32_t)) {
+            uint32_t value;
+            std::memcpy(&value, data.data() + i, sizeof(value));
+            const int32_t mantissa{ static_cast<int32_t>(value << 8) >> 8 };
+            const int32_t exponent{ static_cast<int32_t>(value) >> 24 };
+            const float result{ std::bit_cast<float>(static_cast<uint32_t>(exponent + 127) << 23) * static_cast<float>(mantissa) };
+            std::memcpy(data.data() + i, &result, sizeof(result));
+        }
+        return true;
+    }
+
+private:
+    static constexpr unsigned vertex_header{ 0xa0U };
+    static constexpr unsigned index_header{ 0xe0U };
+    static constexpr unsigned sequence_header{ 0xd0U };
+
+    static constexpr size_t max_vertex_size{ 256U };
+    static constexpr size_t vertex_block_size_bytes{ 8192U };
+    static constexpr size_t vertex_block_max_size{ 256U };
+    static constexpr size_t byte_group_size{ 16U };
+    static constexpr size_t byte_group_decode_limit{ 24U };
+    static constexpr size_t tail_max_size{ 32U };
+
+    static constexpr size_t fifo_size{ 16U };
+    static constexpr size_t fifo_mask{ fifo_size - 1U };
+    static constexpr size_t codeaux_table_size{ 16U };
+    static constexpr size_t sequence_tail_size{ 4U };
+
+    // the number of vertices per block, so that a block fits in 8 kB, in whole byte groups
+    static size_t vertexBlockSize(size_t byteStride)
+    {
+        const size_t blockSize{ (vertex_block_size_bytes / byteStride) & ~(byte_group_size - 1U) };
+        return std::min(blockSize, vertex_block_max_size);
+    }
+
+    static unsigned char unzigzag(unsigned char value)
+    {
+        return static_cast<unsigned char>((0U - (value & 1U)) ^ (value >> 1));
+    }
+
+    static uint32_t unzigzag(uint32_t value)
+    {
+        return (value >> 1) ^ (0U - (value & 1U));
+    }
+
+    // a block stores every byte of the vertices in turn, as deltas to the same byte of the
+    // previous vertex, in groups of 16
+    static bool decodeVertexBlock(std::span<const unsigned char> source, size_t & offset, unsigned char * vertices, size_t count, size_t byteStride, std::array<unsigned char, max_vertex_size> & lastVertex)
+    {
+        std::array<unsigned char, vertex_block_max_size> deltas;
+        const size_t alignedCount{ (count + byte_group_size - 1U) & ~(byte_group_size - 1U) };
+
+        for (size_t k = 0; k < byteStride; ++k) {
+            if (!decodeBytes(source, offset, deltas.data(), alignedCount)) {
+                return false;
+            }
+            unsigned char previous{ lastVertex[k] };
+            for (size_t i = 0; i < count; ++i) {
+                previous = static_cast<unsigned char>(unzigzag(deltas[i]) + previous);
+                vertices[i * byteStride + k] = previous;
+            }
+        }
+
+        std::memcpy(lastVertex.data(), vertices + (count - 1U) * byteStride, byteStride);
+        return true;
+    }
+
+    // two header bits per group select 0, 2, 4 or 8 bits per byte
+    static bool decodeBytes(std::span<const unsigned char> source, size_t & offset, unsigned char * bytes, size_t size)
+    {
+        const size_t headerSize{ (size / byte_group_size + 3U) / 4U };
+        if (source.size() - offset < headerSize) {
+            return false;
+        }
+        const unsigned char * header{ source.data() + offset };
+        offset += headerSize;
+
+        for (size_t i = 0; i < size; i += byte_group_size) {
+            if (source.size() - offset < byte_group_decode_limit) {
+                return false;
+            }
+            const size_t group{ i / byte_group_size };
+            const unsigned bitsLog2{ (header[group / 4U] >> ((group % 4U) * 2U)) & 3U };
+            offset = decodeBytesGroup(source.data(), offset, bytes + i, bitsLog2);
+        }
+        return true;
+    }
+
+    // packed values of 2 or 4 bits, most significant first, where the largest value means
+    // that the byte follows the packed values
+    static size_t decodeBytesGroup(const unsigned char * data, size_t offset, unsigned char * bytes, unsigned bitsLog2)
+    {
+        switch (bitsLog2) {
+        case 0U:
+            std::fill_n(bytes, byte_group_size, static_cast<unsigned char>(0U));
+            return offset;
+        case 3U:
+            std::memcpy(bytes, data + offset, byte_group_size);
+            return offset + byte_group_size;
+        default: {
+            const size_t bits{ size_t{ 1U } << bitsLog2 };
+            const unsigned mask{ (1U << bits) - 1U };
+            const unsigned char * packed{ data + offset };
+            size_t extra{ offset + bits * byte_group_size / 8U };
+            for (size_t k = 0; k < byte_group_size; ++k) {
+                const size_t bit{ k * bits };
+                const unsigned value{ (packed[bit / 8U] >> (8U - bits - bit % 8U)) & mask };
+                bytes[k] = value == mask ? data[extra++] : static_cast<unsigned char>(value);
+            }
+            return extra;
+        }
+        }
+    }
+
+    // 7 bits per byte, least significant first, at most 5 bytes
+    static uint32_t decodeVByte(const unsigned char *& data)
+    {
+        const unsigned char lead{ *data++ };
+        if (lead < 0x80U) {
+            return lead;
+        }
+        uint32_t result{ lead & 0x7fU };
+        uint32_t shift{ 7U };
+        for (int i = 0; i < 4; ++i) {
+            const unsigned char group{ *data++ };
+            result |= static_cast<uint32_t>(group & 0x7fU) << shift;
+            shift += 7U;
+            if (group < 0x80U) {
+                break;
+            }
+        }
+        return result;
+    }
+
+    static uint32_t decodeIndex(const unsigned char *& data, uint32_t last)
+    {
+        return last + unzigzag(decodeVByte(data));
+    }
+
+    static void writeIndex(std::span<unsigned char> destination, size_t position, size_t indexSize, uint32_t index)
+    {
+        if (indexSize == 2U) {
+            const uint16_t shortIndex{ static_cast<uint16_t>(index) };
+            std::memcpy(destination.data() + position * indexSize, &shortIndex, sizeof(shortIndex));
+        }
+        else {
+            std::memcpy(destination.data() + position * indexSize, &index, sizeof(index));
+        }
+    }
+
+    static void writeTriangle(std::span<unsigned char> destination, size_t position, size_t indexSize, uint32_t a, uint32_t b, uint32_t c)
+    {
+        writeIndex(destination, position, indexSize, a);
+        writeIndex(destination, position + 1U, indexSize, b);
+        writeIndex(destination, position + 2U, indexSize, c);
+    }
+
+    static int roundToInt(float value)
+    {
+        return static_cast<int>(value + (value >= 0.0f ? 0.5f : -0.5f));
+    }
+
+    template<class T>
+    static void decodeOctahedral(std::span<unsigned char> data, size_t count)
+    {
+        const float max{ static_cast<float>((1 << (sizeof(T) * 8U - 1U)) - 1) };
+        for (size_t i = 0; i < count; ++i) {
+            std::array<T, 4> vector;
+            std::memcpy(vector.data(), data.data() + i * sizeof(vector), sizeof(vector));
+
+            float x{ static_cast<float>(vector[0]) };
+            float y{ static_cast<float>(vector[1]) };
+            const float z{ static_cast<float>(vector[2]) - std::fabs(x) - std::fabs(y) };
+            // folds the lower hemisphere back
+            const float t{ std::min(z, 0.0f) };
+            x += x >= 0.0f ? t : -t;
+            y += y >= 0.0f ? t : -t;
+
+            const float scale{ max / std::sqrt(x * x + y * y + z * z) };
+            vector[0] = static_cast<T>(roundToInt(x * scale));
+            vector[1] = static_cast<T>(roundToInt(y * scale));
+            vector[2] = static_cast<T>(roundToInt(z * scale));
+            std::memcpy(data.data() + i * sizeof(vector), vector.data(), sizeof(vector));
+        }
+    }
+};
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// writes ascii open inventor syntax straight to a stream, one node and field at a time, so
+// that a file can be written without building a coin scene graph first. the text is
+// collected in large blocks and numbers are formatted with std::to_chars.
+class GltfIvStreamWriter {
+public:
+    // precision is the number of significant digits of floats, 0 writes the shortest text
+    // that reads back to the same float. more than 9 digits never change a float.
+    explicit GltfIvStreamWriter(std::ostream & out, int precision = 0)
+        : m_out{ out }
+        , m_block(block_size)
+        , m_precision{ std::clamp(precision, 0, 9) }
+    {
+    }
+
+    GltfIvStreamWriter(const GltfIvStreamWriter &) = delete;
+    GltfIvStreamWriter & operator=(const GltfIvStreamWriter &) = delete;
+
+    ~GltfIvStreamWriter()
+    {
+        flush();
+    }
+
+    void writeHeader()
+    {
+        write("#Inventor V2.1 ascii\n\n");
+    }
+
+    // a node with a def name can be used again later by that name
+    void beginNode(std::string_view type, std::string_view defName = {})
+    {
+        indent();
+        if (!defName.empty()) {
+            write("DEF ");
+            write(defName);
+            write(" ");
+        }
+        write(type);
+        write(" {\n");
+        ++m_level;
+    }
+
+    void endNode()
+    {
+        --m_level;
+        indent();
+        write("}\n");
+    }
+
+    void useNode(std::string_view defName)
+    {
+        indent();
+        write("USE ");
+        write(defName);
+        write("\n");
+    }
+
+    void field(std::string_view name, std::string_view value)
+    {
+        beginField(name);
+        write(" ");
+        write(value);
+        write("\n");
+    }
+
+    void field(std::string_view name, int32_t value)
+    {
+        beginField(name);
+        write(" ");
+        writeNumber(value);
+        write("\n");
+    }
+
+    void field(std::string_view name, float value)
+    {
+        beginField(name);
+        write(" ");
+        writeNumber(value);
+        write("\n");
+    }
+
+    template<size_t N>
+    void field(std::string_view name, const std::array<float, N> & value)
+    {
+        beginField(name);
+        for (const float component : value) {
+            write(" ");
+            writeNumber(component);
+        }
+        write("\n");
+    }
+
+    // vectors are written one per line, separated by commas
+    template<size_t N>
+    void field(std::string_view name, std::span<const std::array<float, N>> values)
+    {
+        beginField(name);
+        write(" [");
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (i > 0) {
+                write(",\n");
+                indent(1);
+            }
+            for (size_t j = 0; j < N; ++j) {
+                write(" ");
+                writeNumber(values[i][j]);
+            }
+        }
+        write(" ]\n");
+    }
+
+    // indices are written a few per line, separated by commas
+    void field(std::string_view name, std::span<const int32_t> values)
+    {
+        constexpr size_t values_per_line{ 16U };
+
+        beginField(name);
+        write(" [");
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (i > 0) {
+                write(",");
+                if (i % values_per_line == 0) {
+                    write("\n");
+                    indent(1);
+                }
+            }
+            write(" ");
+            writeNumber(values[i]);
+        }
+        write(" ]\n");
+    }
+
+    // an SoSFImage: the size, the number of components and every pixel as one hex number
+    void imageField(std::string_view name, int width, int height, int components, std::span<const unsigned char> pixels)
+    {
+        constexpr size_t pixels_per_line{ 8U };
+        constexpr std::string_view digits{ "0123456789abcdef" };
+
+        beginField(name);
+        for (const int32_t value : { width, height, components }) {
+            write(" ");
+            writeNumber(value);
+        }
+
+        const size_t pixelCount{ static_cast<size_t>(width) * static_cast<size_t>(height) };
+        const size_t pixelSize{ static_cast<size_t>(std::clamp(components, 1, 4)) };
+        std::array<char, 10> hex{ '0', 'x' };
+        for (size_t i = 0; i < pixelCount && (i + 1U) * pixelSize <= pixels.size(); ++i) {
+            if (i % pixels_per_line == 0) {
+                write("\n");
+                indent(1);
+            }
+            else {
+                write(" ");
+            }
+            for (size_t c = 0; c < pixelSize; ++c) {
+                const unsigned char channel{ pixels[i * pixelSize + c] };
+                hex[2U + 2U * c] = digits[channel >> 4];
+                hex[3U + 2U * c] = digits[channel & 0x0fU];
+            }
+            write(std::string_view{ hex.data(), 2U + 2U * pixelSize });
+        }
+        write("\n");
+    }
+
+    // writes the collected text to the stream
+    void flush()
+    {
+        if (m_used > 0U) {
+            m_out.write(m_block.data(), static_cast<std::streamsize>(m_used));
+            m_used = 0U;
+        }
+    }
+
+    // def names may only contain letters, digits and underscores and not start with a digit
+    static std::string defName(std::string_view name)
+    {
+        std::string result{ name };
+        for (size_t i = 0; i < result.size(); ++i) {
+            const unsigned char c{ static_cast<unsigned char>(result[i]) };
+            const bool valid{ c < 0x80 && (std::isalpha(c) || c == '_' || (i > 0 && std::isdigit(c))) };
+            if (!valid) {
+                result[i] = '_';
+            }
+        }
+        return result;
+    }
+
+private:
+    static constexpr size_t block_size{ 1U << 20 };
+    static constexpr size_t max_number_size{ 32U };
+
+    void beginField(std::string_view name)
+    {
+        indent();
+        write(name);
+    }
+
+    void write(std::string_view text)
+    {
+        if (text.size() > m_block.size() - m_used) {
+            flush();
+            if (text.size() > m_block.size()) {
+                m_out.write(text.data(), static_cast<std::streamsize>(text.size()));
+                return;
+            }
+        }
+        std::copy(text.begin(), text.end(), m_block.begin() + static_cast<std::ptrdiff_t>(m_used));
+        m_used += text.size();
+    }
+
+    // numbers are formatted in place at the end of the block
+    char * numberSpace()
+    {
+        if (m_block.size() - m_used < max_number_size) {
+            flush();
+        }
+        return m_block.data() + m_used;
+    }
+
+    void writeNumber(int32_t value)
+    {
+        char * first{ numberSpace() };
+        m_used = static_cast<size_t>(std::to_chars(first, first + max_number_size, value).ptr - m_block.data());
+    }
+
+    void writeNumber(float value)
+    {
+        char * first{ numberSpace() };
+        const std::to_chars_result result{
+            m_precision > 0
+                ? std::to_chars(first, first + max_number_size, value, std::chars_format::general, m_precision)
+                : std::to_chars(first, first + max_number_size, value)
+        };
+        m_used = static_cast<size_t>(result.ptr - m_block.data());
+    }
+
+    void indent(int extra = 0)
+    {
+        for (int i = 0; i < m_level + extra; ++i) {
+            write("  ");
+        }
+    }
+
+    std::ostream & m_out;
+    std::vector<char> m_block;
+    size_t m_used{ 0U };
+    int m_precision{ 0 };
+    int m_level{ 0 };
+};
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// turns a triangle list into triangle strips for SoIndexedTriangleStripSet. strips are grown
+// greedily over the edge adjacency, keeping the winding of every triangle. the next strip
+// starts next to the end of the previous one when possible, so consecutive strips share
+// vertices while they are still in the vertex cache.
+class GltfIvStripifier {
+public:
+    using index_t = int32_t;
+    using indices_t = std::vector<index_t>;
+
+    // takes three vertex ids per triangle and returns the strips, each terminated by -1
+    static indices_t stripify(const indices_t & vertices)
+    {
+        GltfIvStripifier stripifier{ vertices };
+        return stripifier.strips();
+    }
+
+private:
+    struct edge_t {
+        uint64_t key;
+        uint32_t triangle;
+
+        bool operator<(const edge_t & other) const
+        {
+            return key < other.key || (key == other.key && triangle < other.triangle);
+        }
+    };
+
+    explicit GltfIvStripifier(const indices_t & vertices)
+        : m_vertices{ vertices }
+        , m_triangleCount{ vertices.size() / 3U }
+        , m_used(m_triangleCount, false)
+    {
+        m_edges.reserve(m_triangleCount * 3U);
+        for (uint32_t triangle = 0; triangle < m_triangleCount; ++triangle) {
+            if (isDegenerate(triangle)) {
+                continue;
+            }
+            for (size_t corner = 0; corner < 3U; ++corner) {
+                m_edges.push_back({ edgeKey(vertex(triangle, corner), vertex(triangle, (corner + 1U) % 3U)), triangle });
+            }
+        }
+        std::sort(m_edges.begin(), m_edges.end());
+    }
+
+    static uint64_t edgeKey(index_t from, index_t to)
+    {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(from)) << 32) | static_cast<uint32_t>(to);
+    }
+
+    index_t vertex(size_t triangle, size_t corner) const
+    {
+        return m_vertices[triangle * 3U + corner];
+    }
+
+    bool isDegenerate(size_t triangle) const
+    {
+        return vertex(triangle, 0) == vertex(triangle, 1) || vertex(triangle, 1) == vertex(triangle, 2) || vertex(triangle, 2) == vertex(triangle, 0);
+    }
+
+    // an unused triangle containing the directed edge from -> to, or -1
+    int64_t unusedTriangle(index_t from, index_t to) const
+    {
+        const uint64_t key{ edgeKey(from, to) };
+        for (auto it = std::lower_bound(m_edges.begin(), m_edges.end(), edge_t{ key, 0U }); it != m_edges.end() && it->key == key; ++it) {
+            if (!m_used[it->triangle]) {
+                return it->triangle;
+            }
+        }
+        return -1;
+    }
+
+    // the vertex following the directed edge from -> to in the triangle
+    index_t thirdVertex(size_t triangle, index_t from, index_t to) const
+    {
+        for (size_t corner = 0; corner < 3U; ++corner) {
+            if (vertex(triangle, corner) == from && vertex(triangle, (corner + 1U) % 3U) == to) {
+                return vertex(triangle, (corner + 2U) % 3U);
+            }
+        }
+        return vertex(triangle, 0);
+    }
+
+    // grows a strip starting with the given rotation of the triangle. triangle k of a strip is
+    // (v[k], v[k+1], v[k+2]) for even and (v[k+1], v[k], v[k+2]) for odd k, so the next
+    // triangle has to contain the last edge in forward or backward direction alternately.
+    void growStrip(size_t triangle, size_t rotation, indices_t & strip, std::vector<uint32_t> & triangles)
+    {
+        strip.clear();
+        triangles.clear();
+        for (size_t corner = 0; corner < 3U; ++corner) {
+            strip.push_back(vertex(triangle, (corner + rotation) % 3U));
+        }
+        triangles.push_back(static_cast<uint32_t>(triangle));
+        m_used[triangle] = true;
+
+        while (true) {
+            const bool even{ (strip.size() - 2U) % 2U == 0U };
+            const index_t from{ even ? strip[strip.size() - 2U] : strip.back() };
+            const index_t to{ even ? strip.back() : strip[strip.size() - 2U] };
+            const int64_t next{ unusedTriangle(from, to) };
+            if (next < 0) {
+                break;
+            }
+            strip.push_back(thirdVertex(static_cast<size_t>(next), from, to));
+            triangles.push_back(static_cast<uint32_t>(next));
+            m_used[static_cast<size_t>(next)] = true;
+        }
+    }
+
+    // the longest strip of the three rotations of the start triangle
+    void bestStrip(size_t triangle, indices_t & strip, std::vector<uint32_t> & triangles)
+    {
+        indices_t candidate;
+        std::vector<uint32_t> candidateTriangles;
+        strip.clear();
+        triangles.clear();
+        for (size_t rotation = 0; rotation < 3U; ++rotation) {
+            growStrip(triangle, rotation, candidate, candidateTriangles);
+            for (uint32_t used : candidateTriangles) {
+                m_used[used] = false;
+            }
+            if (candidateTriangles.size() > triangles.size()) {
+                std::swap(strip, candidate);
+                std::swap(triangles, candidateTriangles);
+            }
+        }
+        for (uint32_t used : triangles) {
+            m_used[used] = true;
+        }
+    }
+
+    // an unused neighbour of the triangle, or -1
+    int64_t unusedNeighbour(size_t triangle) const
+    {
+        for (size_t corner = 0; corner < 3U; ++corner) {
+            const int64_t neighbour{ unusedTriangle(vertex(triangle, (corner + 1U) % 3U), vertex(triangle, corner)) };
+            if (neighbour >= 0) {
+                return neighbour;
+            }
+        }
+        return -1;
+    }
+
+    indices_t strips()
+    {
+        indices_t result;
+        result.reserve(m_vertices.size() + m_triangleCount);
+
+        indices_t strip;
+        std::vector<uint32_t> triangles;
+        size_t nextUnused{ 0U };
+        int64_t start{ -1 };
+        while (true) {
+            if (start < 0) {
+                while (nextUnused < m_triangleCount && m_used[nextUnused]) {
+                    ++nextUnused;
+                }
+                if (nextUnused == m_triangleCount) {
+                    break;
+                }
+                start = static_cast<int64_t>(nextUnused);
+            }
+
+            const size_t triangle{ static_cast<size_t>(start) };
+            if (isDegenerate(triangle)) {
+                m_used[triangle] = true;
+                result.insert(result.end(), m_vertices.begin() + static_cast<std::ptrdiff_t>(triangle * 3U), m_vertices.begin() + static_cast<std::ptrdiff_t>(triangle * 3U + 3U));
+                result.push_back(-1);
+                start = -1;
+                continue;
+            }
+
+            bestStrip(triangle, strip, triangles);
+            result.insert(result.end(), strip.begin(), strip.end());
+            result.push_back(-1);
+            start = unusedNeighbour(triangles.back());
+        }
+        return result;
+    }
+
+    const indices_t & m_vertices;
+    size_t m_triangleCount;
+    std::vector<bool> m_used;
+    std::vector<edge_t> m_edges;
+};
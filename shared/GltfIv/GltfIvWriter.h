@@ -1,32 +1,134 @@
 #pragma once
 
 #include "GltfIv.h"
+#include "GltfIvCompactor.h"
+#include "GltfIvDequantizer.h"
+#include "GltfIvStreamWriter.h"
+#include "GltfIvStripifier.h"
 
 
 #include <Inventor/nodes/SoScale.h>
 #include <Inventor/nodes/SoRotation.h>
 #include <Inventor/nodes/SoTranslation.h>
 #include <Inventor/nodes/SoTransform.h>
+#include <Inventor/nodes/SoMatrixTransform.h>
+#include <Inventor/nodes/SoMultipleCopy.h>
 
 #include <Inventor/nodes/SoCoordinate3.h>
 #include <Inventor/nodes/SoNormal.h>
 #include <Inventor/nodes/SoIndexedTriangleStripSet.h>
+#include <Inventor/nodes/SoIndexedLineSet.h>
+#include <Inventor/nodes/SoPointSet.h>
 #include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoTexture2.h>
+#include <Inventor/nodes/SoTextureCoordinate2.h>
+#include <Inventor/nodes/SoTextureCoordinateBinding.h>
 
 #include <gsl/gsl>
 #include <spdlog/stopwatch.h>
 
-#include <map>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <variant>
 
 class GltfIvWriter {
 public:
-    GltfIvWriter(tinygltf::Model && gltfModel)
+    // an axis aligned box, empty as long as its minimum is above its maximum
+    struct box_t {
+        std::array<double, 3> min{ std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity() };
+        std::array<double, 3> max{ -std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity() };
+
+        void extend(const box_t & other)
+        {
+            for (size_t i = 0; i < 3U; ++i) {
+                min[i] = std::min(min[i], other.min[i]);
+                max[i] = std::max(max[i], other.max[i]);
+            }
+        }
+
+        bool intersects(const box_t & other) const
+        {
+            for (size_t i = 0; i < 3U; ++i) {
+                if (max[i] < other.min[i] || min[i] > other.max[i]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    GltfIvWriter(GltfIvModel && gltfModel)
         : m_gltfModel{ std::move(gltfModel) }
         , m_nodes{}
         , m_meshes{}
         , m_materials{}
+        , m_textures{}
+    {
+    }
+
+    // ascii files are streamed straight from the gltf model unless a coin scene graph is wanted,
+    // binary files are always written from a coin scene graph
+    void setDirectOutput(bool directOutput)
+    {
+        m_directOutput = directOutput;
+    }
+
+    // merges transformations, removes identity transformations and repeated bindings and
+    // replaces separators holding a single separator or shape by it, in the scene graph and in
+    // streamed ascii files
+    void setCompact(bool compact)
+    {
+        m_compact = compact;
+    }
+
+    // significant digits of the floats in streamed ascii files, 0 writes the shortest text
+    // that reads back to the same value
+    void setPrecision(int precision)
     {
+        m_precision = precision;
+    }
+
+    // converts only the scene with this index instead of all scenes
+    void setScene(std::optional<size_t> sceneIndex)
+    {
+        m_sceneIndex = sceneIndex;
+    }
+
+    // converts only the nodes matching one of the patterns, with everything below them, instead
+    // of whole scenes. a pattern is a node index or a node name with * and ? as wildcards. the
+    // transformations of the nodes above a selected node are merged into a matrix transform
+    // above it, so that it stays where it is in the whole scene.
+    void setNodes(std::vector<std::string> nodePatterns)
+    {
+        m_nodePatterns = std::move(nodePatterns);
+    }
+
+    // converts only the nodes and primitives whose world space bounds intersect the region.
+    // the bounds come from the min and max of the position accessors, so nothing outside of
+    // the region is decoded. primitives crossing the boundary are kept whole.
+    void setRegion(std::optional<box_t> region)
+    {
+        m_region = region;
+    }
+
+    // number of threads preparing the mesh data, 0 uses all cores and 1 converts serially
+    void setThreadCount(unsigned threadCount)
+    {
+        m_threadCount = threadCount;
     }
 
     bool write(std::string filename, bool writeBinary)
@@ -36,11 +138,19 @@ public:
             m_nodes.clear();
             m_meshes.clear();
             m_materials.clear();
+            m_textures.clear();
+
+            if (m_directOutput && !writeBinary) {
+                return streamModel(filename);
+            }
 
             iv_root_t root{ new SoSeparator };
             root->ref();
 
             convertModel(root);
+            if (m_compact) {
+                GltfIvCompactor::compact(root);
+            }
             const bool success{ GltfIv::write(filename, root, writeBinary) };
 
             root->unref();
@@ -57,231 +167,965 @@ private:
     using iv_index_t = int32_t;
     using iv_indices_t = std::vector<iv_index_t>;
 
-    using gltf_index_t = size_t;
-    using gltf_indices_t = std::vector<gltf_index_t>;
+    // typed read access to the elements of an accessor where they are in the buffer, tightly
+    // packed or interleaved. elements are read with memcpy as they need not be aligned.
+    // elements of a sparse accessor are looked up among its sorted sparse indices first and
+    // read from the base data otherwise, which is zero without data, so nothing is copied.
+    // a view can also own the elements, when they had to be converted from another type.
+    template<class T>
+    class accessor_view_t {
+    public:
+        accessor_view_t() = default;
+        accessor_view_t(const unsigned char * data, size_t count, size_t byteStride)
+            : m_data{ data }
+            , m_count{ count }
+            , m_byteStride{ byteStride }
+        {
+        }
+
+        explicit accessor_view_t(std::shared_ptr<const std::vector<T>> items)
+            : m_data{ reinterpret_cast<const unsigned char *>(items->data()) }
+            , m_count{ items->size() }
+            , m_byteStride{ sizeof(T) }
+            , m_items{ std::move(items) }
+        {
+        }
+
+        void setSparse(std::shared_ptr<const std::vector<uint32_t>> sparseIndices, const unsigned char * sparseValues)
+        {
+            m_sparseIndices = std::move(sparseIndices);
+            m_sparseValues = sparseValues;
+        }
+
+        size_t size() const
+        {
+            return m_count;
+        }
+
+        bool empty() const
+        {
+            return m_count == 0;
+        }
+
+        T operator[](size_t index) const
+        {
+            T item{};
+            if (m_sparseIndices && !m_sparseIndices->empty() && index >= m_sparseIndices->front() && index <= m_sparseIndices->back()) {
+                const auto sparse{ std::lower_bound(m_sparseIndices->cbegin(), m_sparseIndices->cend(), index) };
+                if (*sparse == index) {
+                    const size_t sparseIndex{ static_cast<size_t>(sparse - m_sparseIndices->cbegin()) };
+                    std::memcpy(&item, m_sparseValues + sparseIndex * sizeof(T), sizeof(T));
+                    return item;
+                }
+            }
+            if (m_data != nullptr) {
+                std::memcpy(&item, m_data + index * m_byteStride, sizeof(T));
+            }
+            return item;
+        }
+
+        T at(size_t index) const
+        {
+            if (index >= m_count) {
+                throw std::out_of_range(fmt::format("index {} is outside of the range of an accessor with {} elements", index, m_count));
+            }
+            return (*this)[index];
+        }
+
+    private:
+        const unsigned char * m_data{ nullptr };
+        size_t m_count{ 0U };
+        size_t m_byteStride{ sizeof(T) };
+        std::shared_ptr<const std::vector<T>> m_items;
+        std::shared_ptr<const std::vector<uint32_t>> m_sparseIndices;
+        const unsigned char * m_sparseValues{ nullptr };
+    };
+
+    // indices keep the component type of their accessor
+    using gltf_indices_t = std::variant<accessor_view_t<uint8_t>, accessor_view_t<uint16_t>, accessor_view_t<uint32_t>>;
 
     using position_t = std::array<float, 3>;
     using positions_t = std::vector<position_t>;
-    using position_map_t = std::map<position_t, iv_index_t>;
+    using positions_view_t = accessor_view_t<position_t>;
 
     using normal_t = std::array<float, 3>;
     using normals_t = std::vector<normal_t>;
-    using normal_map_t = std::map<normal_t, iv_index_t>;
+    using normals_view_t = accessor_view_t<normal_t>;
+
+    using texcoord_t = std::array<float, 2>;
+    using texcoords_t = std::vector<texcoord_t>;
+    using texcoords_view_t = accessor_view_t<texcoord_t>;
+
+    template<class T>
+    struct unique_items_t {
+        std::vector<T> items;
+        iv_indices_t indices; // index into items for every source item
+    };
+
+    // the coin shape a primitive becomes: strips for all triangle modes, polylines for all line
+    // modes and a point set for points
+    enum class primitive_shape_t {
+        TRIANGLE_STRIPS,
+        LINES,
+        POINTS
+    };
+
+    // the unique positions and normals of a primitive and the strips or polylines indexing them,
+    // prepared without touching coin so that it can run on a worker thread. points keep their
+    // positions in drawing order as a point set is not indexed.
+    struct primitive_data_t {
+        primitive_shape_t shape{ primitive_shape_t::TRIANGLE_STRIPS };
+        positions_t positions;
+        normals_t normals; // empty if the primitive has no normals
+        texcoords_t texCoords; // empty if the primitive has no texture
+        iv_indices_t coordIndex;
+        iv_indices_t normalIndex;
+        iv_indices_t textureCoordIndex;
+    };
+
+    // the index of every vertex of a primitive among the unique positions, normals and texture
+    // coordinates, the latter two are empty if the primitive has none
+    struct vertex_indices_t {
+        iv_indices_t positions;
+        iv_indices_t normals;
+        iv_indices_t texCoords;
+    };
+
+    using vertex_key_t = std::array<iv_index_t, 3>;
+
+    struct vertex_key_hash_t {
+        size_t operator()(const vertex_key_t & key) const
+        {
+            return hashBits(std::bit_cast<std::array<uint32_t, 3>>(key));
+        }
+    };
+
+    struct prepared_mesh_t {
+        bool prepared{ false };
+        std::vector<std::optional<primitive_data_t>> primitives; // empty for unsupported modes
+        std::exception_ptr error;
+    };
 
     using iv_root_t = gsl::not_null<SoSeparator *>;
+    using iv_group_t = gsl::not_null<SoGroup *>;
     using iv_base_t = gsl::not_null<SoBase *>;
     using iv_material_t = gsl::not_null<SoMaterial *>;
+    using iv_texture_t = gsl::not_null<SoTexture2 *>;
 
     void convertModel(iv_root_t root)
     {
         spdlog::stopwatch stopwatch;
         spdlog::trace("convert gltf model to open inventor model");
 
+        const std::vector<tinygltf::Scene> scenes{ selectedScenes() };
+        cullRegion(scenes);
+        const std::vector<size_t> meshIndices{ usedMeshes(scenes) };
+        decodeTextureImages(meshIndices);
+        prepareMeshes(meshIndices);
+
         std::for_each(
-            m_gltfModel.scenes.cbegin(),
-            m_gltfModel.scenes.cend(),
+            scenes.cbegin(),
+            scenes.cend(),
             [this, root] (const tinygltf::Scene & scene)
             {
                 convertScene(root, scene);
             }
         );
+        m_preparedMeshes.clear();
         spdlog::debug("finished converting gltf model to open inventor model ({:.3} seconds)", stopwatch);
     }
 
-    void convertScene(iv_root_t root, const tinygltf::Scene & scene)
+    // the numeric work of all meshes used by the scenes runs on a pool of threads that take
+    // the next unprepared mesh until none is left. the coin nodes are created afterwards on
+    // this thread from the prepared data, exactly as in the serial conversion.
+    void prepareMeshes(const std::vector<size_t> & meshIndices)
     {
-        spdlog::trace("converting gltf scene with name '{}'", scene.name);
+        const unsigned threadCount{ m_threadCount > 0U ? m_threadCount : std::max(1U, std::thread::hardware_concurrency()) };
+        if (threadCount == 1U) {
+            return;
+        }
 
-        SoSeparator * sceneRoot{ new SoSeparator };
+        spdlog::debug("preparing {} gltf meshes on {} threads", meshIndices.size(), std::min<size_t>(threadCount, meshIndices.size()));
 
-        addName(sceneRoot, scene.name);
-        convertNodes(sceneRoot, scene.nodes);
+        m_preparedMeshes.clear();
+        m_preparedMeshes.resize(m_gltfModel.meshes.size());
 
-        root->addChild(sceneRoot);
-    }
+        std::atomic<size_t> nextMesh{ 0U };
+        auto prepareNextMeshes = [this, &meshIndices, &nextMesh] ()
+        {
+            for (size_t i = nextMesh++; i < meshIndices.size(); i = nextMesh++) {
+                prepared_mesh_t & preparedMesh{ m_preparedMeshes[meshIndices[i]] };
+                try {
+                    preparedMesh.primitives = prepareMesh(meshIndices[i]);
+                }
+                catch (...) {
+                    preparedMesh.error = std::current_exception();
+                }
+                preparedMesh.prepared = true;
+            }
+        };
 
-    void addName(iv_base_t root, std::string name)
-    {
-        if (!name.empty()) {
-            SbString nameString{ name.c_str() };
-            root->setName(SbName{ nameString });
+        std::vector<std::thread> threads;
+        for (size_t i = 1U; i < std::min<size_t>(threadCount, meshIndices.size()); ++i) {
+            threads.emplace_back(prepareNextMeshes);
         }
+        prepareNextMeshes();
+        std::for_each(threads.begin(), threads.end(), [] (std::thread & thread) { thread.join(); });
     }
 
-    void convertNodes(iv_root_t root, const std::vector<int> & nodeIndices)
+    // the images of the base color textures of the given meshes are decoded up front in parallel,
+    // each once no matter how many materials and textures share it. they stay in the model and
+    // the texture nodes refer to them without copying.
+    void decodeTextureImages(const std::vector<size_t> & meshIndices)
     {
-        spdlog::trace("converting {} gltf nodes", nodeIndices.size());
-
-        std::for_each(
-            nodeIndices.cbegin(),
-            nodeIndices.cend(),
-            [this, root] (int nodeIndex)
-            {
-                convertNode(root, static_cast<size_t>(nodeIndex));
+        std::vector<size_t> imageIndices;
+        std::vector<bool> usedImages(m_gltfModel.images.size(), false);
+
+        for (const size_t meshIndex : meshIndices) {
+            const std::vector<tinygltf::Primitive> & primitives{ m_gltfModel.meshes[meshIndex].primitives };
+            for (size_t i = 0; i < primitives.size(); ++i) {
+                const std::optional<size_t> textureIndex{ baseColorTexture(primitives[i]) };
+                if (!textureIndex.has_value() || !isPrimitiveInRegion(meshIndex, i)) {
+                    continue;
+                }
+                const int imageIndex{ m_gltfModel.textures[textureIndex.value()].source };
+                if (imageIndex >= 0 && static_cast<size_t>(imageIndex) < usedImages.size() && !usedImages[static_cast<size_t>(imageIndex)]) {
+                    usedImages[static_cast<size_t>(imageIndex)] = true;
+                    imageIndices.push_back(static_cast<size_t>(imageIndex));
+                }
             }
-        );
+        }
+
+        if (!imageIndices.empty()) {
+            GltfIv::decodeImages(m_gltfModel, imageIndices, m_threadCount);
+        }
     }
 
-    void convertNode(iv_root_t root, size_t nodeIndex)
+    // the scenes to convert. with selected nodes, the nodes of each scene are the first
+    // selected nodes on every path down from its nodes, so only their subtrees are converted.
+    std::vector<tinygltf::Scene> selectedScenes()
     {
-        spdlog::trace("converting gltf node with index {}", nodeIndex);
-
-        if (m_nodes.contains(nodeIndex)) {
-            spdlog::debug("re-using already converted gltf node with index {}", nodeIndex);
-            root->addChild(m_nodes.at(nodeIndex));
+        m_selectedParentMatrices.clear();
+        std::vector<tinygltf::Scene> scenes;
+        if (m_sceneIndex.has_value()) {
+            if (m_sceneIndex.value() >= m_gltfModel.scenes.size()) {
+                throw std::out_of_range(fmt::format("scene {} not found among {} scenes", m_sceneIndex.value(), m_gltfModel.scenes.size()));
+            }
+            scenes.push_back(m_gltfModel.scenes[m_sceneIndex.value()]);
         }
         else {
-            const tinygltf::Node node{ m_gltfModel.nodes.at(nodeIndex) };
-            spdlog::debug("converting gltf node with name '{}'", node.name);
+            scenes = m_gltfModel.scenes;
+        }
 
-            if (hasZeroScale(node)) {
-                spdlog::debug("skipping gltf node with zero scale");
-                return;
+        if (!m_nodePatterns.empty()) {
+            size_t selectedCount{ 0U };
+            for (tinygltf::Scene & scene : scenes) {
+                scene.nodes = selectedNodes(scene.nodes);
+                selectedCount += scene.nodes.size();
             }
-
-            SoSeparator * nodeRoot{ new SoSeparator };
-
-            addName(nodeRoot, node.name);
-
-            convertTransform(nodeRoot, node);
-            convertScale(nodeRoot, node);
-            convertRotation(nodeRoot, node);
-            convertTranslation(nodeRoot, node);
-
-            if (hasMesh(node)) {
-                convertMesh(nodeRoot, static_cast<size_t>(node.mesh));
+            if (selectedCount == 0U) {
+                spdlog::warn("no gltf node matches the selected nodes");
             }
+            spdlog::debug("selected {} gltf nodes in {} scenes", selectedCount, scenes.size());
+        }
+        return scenes;
+    }
 
-            if (!node.children.empty()) {
-                convertNodes(nodeRoot, node.children);
+    // the matrix of the nodes above each selected node is carried down along with it and kept
+    // for the selected nodes that are below a transformed node
+    std::vector<int> selectedNodes(const std::vector<int> & rootIndices)
+    {
+        std::vector<int> nodeIndices;
+        std::vector<bool> visitedNodes(m_gltfModel.nodes.size(), false);
+        std::vector<std::pair<int, matrix_t>> pendingNodes;
+        std::transform(rootIndices.rbegin(), rootIndices.rend(), std::back_inserter(pendingNodes), [] (int nodeIndex) { return std::make_pair(nodeIndex, identity_matrix); });
+
+        while (!pendingNodes.empty()) {
+            const auto [nodeIndex, parentMatrix] { pendingNodes.back() };
+            pendingNodes.pop_back();
+            if (nodeIndex < 0 || static_cast<size_t>(nodeIndex) >= visitedNodes.size() || visitedNodes[static_cast<size_t>(nodeIndex)]) {
+                continue;
             }
+            visitedNodes[static_cast<size_t>(nodeIndex)] = true;
 
-            root->addChild(nodeRoot);
-            m_nodes.insert(std::make_pair(nodeIndex, nodeRoot));
+            if (isSelected(static_cast<size_t>(nodeIndex))) {
+                nodeIndices.push_back(nodeIndex);
+                if (parentMatrix != identity_matrix) {
+                    m_selectedParentMatrices.insert(std::make_pair(static_cast<size_t>(nodeIndex), parentMatrix));
+                }
+            }
+            else {
+                const tinygltf::Node & node{ m_gltfModel.nodes[static_cast<size_t>(nodeIndex)] };
+                const matrix_t matrix{ multiply(parentMatrix, localMatrix(node)) };
+                std::transform(node.children.rbegin(), node.children.rend(), std::back_inserter(pendingNodes), [&matrix] (int childIndex) { return std::make_pair(childIndex, matrix); });
+            }
         }
+        return nodeIndices;
     }
 
-    static inline bool hasMesh(const tinygltf::Node & node) {
-        return node.mesh >= 0;
+    bool isSelected(size_t nodeIndex) const
+    {
+        const std::string & name{ m_gltfModel.nodes[nodeIndex].name };
+        return std::any_of(
+            m_nodePatterns.cbegin(),
+            m_nodePatterns.cend(),
+            [nodeIndex, &name] (const std::string & pattern)
+            {
+                const bool isIndex{ !pattern.empty() && std::all_of(pattern.cbegin(), pattern.cend(), [] (char c) { return c >= '0' && c <= '9'; }) };
+                return (isIndex && pattern == std::to_string(nodeIndex)) || matchesGlob(pattern, name);
+            }
+        );
     }
 
-    static inline bool hasZeroScale(const tinygltf::Node & node)
+    // * matches any number of characters and ? any single character. the last * is retried
+    // one character further on every mismatch, which is enough as * matches anything.
+    static bool matchesGlob(std::string_view pattern, std::string_view name)
     {
-        return hasScale(node) && node.scale[0] == 0.0 && node.scale[1] == 0.0 && node.scale[2] == 0.0;
+        size_t p{ 0U };
+        size_t n{ 0U };
+        size_t starPattern{ std::string_view::npos };
+        size_t starName{ 0U };
+
+        while (n < name.size()) {
+            if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+                ++p;
+                ++n;
+            }
+            else if (p < pattern.size() && pattern[p] == '*') {
+                starPattern = p++;
+                starName = n;
+            }
+            else if (starPattern != std::string_view::npos) {
+                p = starPattern + 1U;
+                n = ++starName;
+            }
+            else {
+                return false;
+            }
+        }
+        while (p < pattern.size() && pattern[p] == '*') {
+            ++p;
+        }
+        return p == pattern.size();
     }
 
-    static void convertTransform(iv_root_t root, const tinygltf::Node & node)
-    {
-        if (hasTransform(node)) {
-            spdlog::trace("converting transform [{:.4}, {:.4}, {:.4}, {:.4}; {:.4}, {:.4}, {:.4}, {:.4}; {:.4}, {:.4}, {:.4}, {:.4}; {:.4}, {:.4}, {:.4}, {:.4};] for gltf node",
-                node.matrix[0], node.matrix[1], node.matrix[2], node.matrix[3],
-                node.matrix[4], node.matrix[5], node.matrix[6], node.matrix[7],
-                node.matrix[8], node.matrix[9], node.matrix[10], node.matrix[11],
-                node.matrix[12], node.matrix[13], node.matrix[14], node.matrix[15]
-            );
+    // column major like the matrices of gltf nodes
+    using matrix_t = std::array<double, 16>;
 
-            SoTransform * transformNode{ new SoTransform };
+    static constexpr const char * instancing_extension{ "EXT_mesh_gpu_instancing" };
 
-            transformNode->setMatrix(
-                SbMatrix{
-                    static_cast<float>(node.matrix[0]), static_cast<float>(node.matrix[1]), static_cast<float>(node.matrix[2]), static_cast<float>(node.matrix[3]),
-                    static_cast<float>(node.matrix[4]), static_cast<float>(node.matrix[5]), static_cast<float>(node.matrix[6]), static_cast<float>(node.matrix[7]),
-                    static_cast<float>(node.matrix[8]), static_cast<float>(node.matrix[9]), static_cast<float>(node.matrix[10]), static_cast<float>(node.matrix[11]),
-                    static_cast<float>(node.matrix[12]), static_cast<float>(node.matrix[13]), static_cast<float>(node.matrix[14]), static_cast<float>(node.matrix[15])
-                }
-            );
+    static constexpr matrix_t identity_matrix{ 1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0 };
 
-            root->addChild(transformNode);
+    // the matrix of a node, or translation * rotation * scale as gltf defines them
+    static matrix_t localMatrix(const tinygltf::Node & node)
+    {
+        if (hasTransform(node)) {
+            matrix_t matrix;
+            std::copy(node.matrix.cbegin(), node.matrix.cend(), matrix.begin());
+            return matrix;
         }
+        return trsMatrix(
+            hasTranslation(node) ? std::span<const double>{ node.translation } : std::span<const double>{},
+            hasRotation(node) ? std::span<const double>{ node.rotation } : std::span<const double>{},
+            hasScale(node) ? std::span<const double>{ node.scale } : std::span<const double>{}
+        );
     }
 
-    inline static bool hasTransform(const tinygltf::Node & node)
+    // translation * rotation * scale, an empty part is left out
+    static matrix_t trsMatrix(std::span<const double> translation, std::span<const double> rotation, std::span<const double> scale)
     {
-        return node.matrix.size() == 16U;
+        matrix_t matrix{ identity_matrix };
+        if (rotation.size() == 4U) {
+            const double x{ rotation[0] };
+            const double y{ rotation[1] };
+            const double z{ rotation[2] };
+            const double w{ rotation[3] };
+            matrix = {
+                1.0 - 2.0 * (y * y + z * z), 2.0 * (x * y + z * w), 2.0 * (x * z - y * w), 0.0,
+                2.0 * (x * y - z * w), 1.0 - 2.0 * (x * x + z * z), 2.0 * (y * z + x * w), 0.0,
+                2.0 * (x * z + y * w), 2.0 * (y * z - x * w), 1.0 - 2.0 * (x * x + y * y), 0.0,
+                0.0, 0.0, 0.0, 1.0
+            };
+        }
+        if (scale.size() == 3U) {
+            for (size_t column = 0; column < 3U; ++column) {
+                for (size_t row = 0; row < 3U; ++row) {
+                    matrix[column * 4U + row] *= scale[column];
+                }
+            }
+        }
+        if (translation.size() == 3U) {
+            std::copy(translation.begin(), translation.end(), matrix.begin() + 12);
+        }
+        return matrix;
     }
 
-    static void convertScale(iv_root_t root, const tinygltf::Node & node)
+    static matrix_t multiply(const matrix_t & left, const matrix_t & right)
     {
-        if (hasScale(node)) {
-            spdlog::trace("converting scale [{:.4}, {:.4}, {:.4}] for gltf node", node.scale[0], node.scale[1], node.scale[2]);
-
-            SoScale * scaleNode{ new SoScale };
-
-            SoSFVec3f scaleVector;
-
-            scaleVector.setValue(
-                static_cast<float>(node.scale[0]),
-                static_cast<float>(node.scale[1]),
-                static_cast<float>(node.scale[2])
-            );
-
-            scaleNode->scaleFactor = scaleVector;
-
-            root->addChild(scaleNode);
+        matrix_t result{};
+        for (size_t column = 0; column < 4U; ++column) {
+            for (size_t row = 0; row < 4U; ++row) {
+                for (size_t k = 0; k < 4U; ++k) {
+                    result[column * 4U + row] += left[k * 4U + row] * right[column * 4U + k];
+                }
+            }
         }
+        return result;
     }
 
-    inline static bool hasScale(const tinygltf::Node & node)
+    // the box around the transformed box, from the smaller and larger product per matrix entry
+    static box_t transformBox(const matrix_t & matrix, const box_t & box)
     {
-        return node.scale.size() == 3U;
+        box_t result;
+        for (size_t row = 0; row < 3U; ++row) {
+            result.min[row] = matrix[12U + row];
+            result.max[row] = matrix[12U + row];
+            for (size_t column = 0; column < 3U; ++column) {
+                const double a{ matrix[column * 4U + row] * box.min[column] };
+                const double b{ matrix[column * 4U + row] * box.max[column] };
+                result.min[row] += std::min(a, b);
+                result.max[row] += std::max(a, b);
+            }
+        }
+        return result;
     }
 
-    static void convertRotation(iv_root_t root, const tinygltf::Node & node)
+    // the min and max of normalized accessors are integer values
+    static double normalizedBound(const tinygltf::Accessor & accessor, double value)
     {
-        if (hasRotation(node)) {
-            spdlog::trace("converting rotation [{:.4}, {:.4}, {:.4}, {:.4}] for gltf node", node.rotation[0], node.rotation[1], node.rotation[2], node.rotation[3]);
+        if (!accessor.normalized) {
+            return value;
+        }
+        switch (accessor.componentType) {
+        case TINYGLTF_COMPONENT_TYPE_BYTE: return std::max(value / 127.0, -1.0);
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: return value / 255.0;
+        case TINYGLTF_COMPONENT_TYPE_SHORT: return std::max(value / 32767.0, -1.0);
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: return value / 65535.0;
+        default: return value;
+        }
+    }
 
-            SoRotation * rotationNode{ new SoRotation };
+    // the bounds of the positions of a primitive, nullopt if their accessor has no min and max
+    std::optional<box_t> primitiveBounds(const tinygltf::Primitive & primitive) const
+    {
+        const auto attribute{ primitive.attributes.find("POSITION") };
+        if (attribute == primitive.attributes.cend() || attribute->second < 0 || static_cast<size_t>(attribute->second) >= m_gltfModel.accessors.size()) {
+            return std::nullopt;
+        }
+        const tinygltf::Accessor & accessor{ m_gltfModel.accessors[static_cast<size_t>(attribute->second)] };
+        if (accessor.minValues.size() != 3U || accessor.maxValues.size() != 3U) {
+            return std::nullopt;
+        }
+        box_t bounds;
+        for (size_t i = 0; i < 3U; ++i) {
+            bounds.min[i] = normalizedBound(accessor, accessor.minValues[i]);
+            bounds.max[i] = normalizedBound(accessor, accessor.maxValues[i]);
+        }
+        return bounds;
+    }
 
-            SoSFRotation rotation;
+    // unknown bounds stay unknown
+    static void extendBounds(std::optional<box_t> & bounds, const std::optional<box_t> & other)
+    {
+        if (bounds.has_value() && other.has_value()) {
+            bounds.value().extend(other.value());
+        }
+        else {
+            bounds.reset();
+        }
+    }
 
-            rotation.setValue(
-                static_cast<float>(node.rotation[0]),
-                static_cast<float>(node.rotation[1]),
-                static_cast<float>(node.rotation[2]),
-                static_cast<float>(node.rotation[3])
-            );
+    // finds the nodes, the meshes of nodes and the primitives inside of the region from the
+    // bounds of the primitives in world space. a mesh used by several nodes keeps every
+    // primitive that is inside of the region for any of them.
+    void cullRegion(const std::vector<tinygltf::Scene> & scenes)
+    {
+        if (!m_region.has_value()) {
+            return;
+        }
 
-            rotationNode->rotation = rotation;
+        m_regionNodes.assign(m_gltfModel.nodes.size(), false);
+        m_regionNodeMeshes.assign(m_gltfModel.nodes.size(), false);
+        m_regionPrimitives.resize(m_gltfModel.meshes.size());
+        for (size_t i = 0; i < m_gltfModel.meshes.size(); ++i) {
+            m_regionPrimitives[i].assign(m_gltfModel.meshes[i].primitives.size(), false);
+        }
 
-            root->addChild(rotationNode);
+        for (const tinygltf::Scene & scene : scenes) {
+            for (const int nodeIndex : scene.nodes) {
+                cullNode(static_cast<size_t>(nodeIndex), selectedParentMatrix(static_cast<size_t>(nodeIndex)));
+            }
         }
+        spdlog::debug("{} of {} gltf nodes are inside of the region", std::count(m_regionNodes.cbegin(), m_regionNodes.cend(), true), m_regionNodes.size());
     }
 
-    inline static bool hasRotation(const tinygltf::Node & node)
+    // the matrix of the nodes above a selected node, the identity for all other nodes
+    matrix_t selectedParentMatrix(size_t nodeIndex) const
     {
-        return node.rotation.size() == 4U;
+        const auto parentMatrix{ m_selectedParentMatrices.find(nodeIndex) };
+        return parentMatrix != m_selectedParentMatrices.cend() ? parentMatrix->second : identity_matrix;
     }
 
-    static void convertTranslation(iv_root_t root, const tinygltf::Node & node)
+    // returns the world space bounds of the node and everything below it
+    std::optional<box_t> cullNode(size_t nodeIndex, const matrix_t & parentMatrix)
     {
-        if (hasTranslation(node)) {
+        const tinygltf::Node & node{ m_gltfModel.nodes.at(nodeIndex) };
+        const matrix_t matrix{ multiply(parentMatrix, localMatrix(node)) };
+        std::optional<box_t> bounds{ box_t{} };
+
+        if (hasMesh(node)) {
+            const size_t meshIndex{ static_cast<size_t>(node.mesh) };
+            const std::optional<std::vector<matrix_t>> instances{ instanceMatrices(node) };
+            const std::vector<tinygltf::Primitive> & primitives{ m_gltfModel.meshes.at(meshIndex).primitives };
+            for (size_t i = 0; i < primitives.size(); ++i) {
+                std::optional<box_t> primitiveBox{ primitiveBounds(primitives[i]) };
+                if (primitiveBox.has_value() && instances.has_value()) {
+                    box_t instancesBox;
+                    for (const matrix_t & instance : instances.value()) {
+                        instancesBox.extend(transformBox(multiply(matrix, instance), primitiveBox.value()));
+                    }
+                    primitiveBox = instancesBox;
+                }
+                else if (primitiveBox.has_value()) {
+                    primitiveBox = transformBox(matrix, primitiveBox.value());
+                }
+                if (!primitiveBox.has_value() || primitiveBox.value().intersects(m_region.value())) {
+                    m_regionPrimitives[meshIndex][i] = true;
+                    m_regionNodeMeshes[nodeIndex] = true;
+                }
+                extendBounds(bounds, primitiveBox);
+            }
+        }
 
-            spdlog::trace("converting translation [{:.4}, {:.4}, {:.4}] for gltf node", node.translation[0], node.translation[1], node.translation[2]);
+        for (const int childIndex : node.children) {
+            extendBounds(bounds, cullNode(static_cast<size_t>(childIndex), matrix));
+        }
 
-            SoTranslation * translationNode{ new SoTranslation };
+        if (!bounds.has_value() || bounds.value().intersects(m_region.value())) {
+            m_regionNodes[nodeIndex] = true;
+        }
+        return bounds;
+    }
 
-            SoSFVec3f translation;
+    // the transforms of the instances of a node with EXT_mesh_gpu_instancing, relative to the
+    // node, nullopt for nodes without the extension. instances with zero scale are left out.
+    std::optional<std::vector<matrix_t>> instanceMatrices(const tinygltf::Node & node) const
+    {
+        const auto extension{ node.extensions.find(instancing_extension) };
+        if (extension == node.extensions.cend() || !extension->second.Has("attributes")) {
+            return std::nullopt;
+        }
+        const tinygltf::Value & attributes{ extension->second.Get("attributes") };
 
-            translation.setValue(
-                static_cast<float>(node.translation[0]),
-                static_cast<float>(node.translation[1]),
-                static_cast<float>(node.translation[2])
-            );
+        const accessor_view_t<std::array<float, 3>> translations{ instanceAttribute<3>(attributes, "TRANSLATION", TINYGLTF_TYPE_VEC3) };
+        const accessor_view_t<std::array<float, 4>> rotations{ instanceAttribute<4>(attributes, "ROTATION", TINYGLTF_TYPE_VEC4) };
+        const accessor_view_t<std::array<float, 3>> scales{ instanceAttribute<3>(attributes, "SCALE", TINYGLTF_TYPE_VEC3) };
 
-            translationNode->translation = translation;
+        const size_t count{ std::max({ translations.size(), rotations.size(), scales.size() }) };
+        for (const size_t size : { translations.size(), rotations.size(), scales.size() }) {
+            if (size != 0U && size != count) {
+                throw std::invalid_argument(fmt::format("the instance attributes of gltf node '{}' have different counts", node.name));
+            }
+        }
 
-            root->addChild(translationNode);
+        std::vector<matrix_t> matrices;
+        matrices.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            std::array<double, 3> translation{};
+            std::array<double, 4> rotation{ 0.0, 0.0, 0.0, 1.0 };
+            std::array<double, 3> scale{ 1.0, 1.0, 1.0 };
+            if (translations.size() > 0U) {
+                const auto item{ translations[i] };
+                std::copy(item.cbegin(), item.cend(), translation.begin());
+            }
+            if (rotations.size() > 0U) {
+                const auto item{ rotations[i] };
+                std::copy(item.cbegin(), item.cend(), rotation.begin());
+            }
+            if (scales.size() > 0U) {
+                const auto item{ scales[i] };
+                std::copy(item.cbegin(), item.cend(), scale.begin());
+            }
+            if (scale[0] == 0.0 && scale[1] == 0.0 && scale[2] == 0.0) {
+                continue;
+            }
+            matrices.push_back(trsMatrix(translation, rotation, scale));
         }
+        spdlog::debug("gltf node '{}' has {} instances", node.name, matrices.size());
+        return matrices;
     }
 
-    inline static bool hasTranslation(const tinygltf::Node & node)
+    template<size_t N>
+    accessor_view_t<std::array<float, N>> instanceAttribute(const tinygltf::Value & attributes, const std::string & name, int accessorType) const
     {
-        return node.translation.size() == 3U;
+        if (!attributes.Has(name)) {
+            return {};
+        }
+        const int accessorIndex{ attributes.Get(name).GetNumberAsInt() };
+        if (accessorIndex < 0 || static_cast<size_t>(accessorIndex) >= m_gltfModel.accessors.size()) {
+            throw std::out_of_range(fmt::format("instance attribute {} refers to missing accessor {}", name, accessorIndex));
+        }
+        const tinygltf::Accessor & accessor{ m_gltfModel.accessors[static_cast<size_t>(accessorIndex)] };
+        ensureAccessorType(accessor, accessorType);
+        return floatAccessorView<std::array<float, N>>(accessor);
     }
 
+    bool isInRegion(size_t nodeIndex) const
+    {
+        return !m_region.has_value() || (nodeIndex < m_regionNodes.size() && m_regionNodes[nodeIndex]);
+    }
 
-    void convertMesh(iv_root_t root, size_t meshIndex)
+    bool isMeshInRegion(size_t nodeIndex) const
+    {
+        return !m_region.has_value() || (nodeIndex < m_regionNodeMeshes.size() && m_regionNodeMeshes[nodeIndex]);
+    }
+
+    bool isPrimitiveInRegion(size_t meshIndex, size_t primitiveIndex) const
+    {
+        return !m_region.has_value() || (meshIndex < m_regionPrimitives.size() && primitiveIndex < m_regionPrimitives[meshIndex].size() && m_regionPrimitives[meshIndex][primitiveIndex]);
+    }
+
+    // the meshes reachable from the scenes in the order of their first use
+    std::vector<size_t> usedMeshes(const std::vector<tinygltf::Scene> & scenes) const
+    {
+        std::vector<size_t> meshIndices;
+        std::vector<bool> visitedNodes(m_gltfModel.nodes.size(), false);
+        std::vector<bool> usedMeshes(m_gltfModel.meshes.size(), false);
+        std::vector<int> pendingNodes;
+
+        for (const tinygltf::Scene & scene : scenes) {
+            pendingNodes.assign(scene.nodes.rbegin(), scene.nodes.rend());
+            while (!pendingNodes.empty()) {
+                const int nodeIndex{ pendingNodes.back() };
+                pendingNodes.pop_back();
+                if (nodeIndex < 0 || static_cast<size_t>(nodeIndex) >= visitedNodes.size() || visitedNodes[static_cast<size_t>(nodeIndex)]) {
+                    continue;
+                }
+                visitedNodes[static_cast<size_t>(nodeIndex)] = true;
+
+                const tinygltf::Node & node{ m_gltfModel.nodes[static_cast<size_t>(nodeIndex)] };
+                if (hasZeroScale(node) || !isInRegion(static_cast<size_t>(nodeIndex))) {
+                    continue;
+                }
+                if (hasMesh(node) && isMeshInRegion(static_cast<size_t>(nodeIndex)) && static_cast<size_t>(node.mesh) < usedMeshes.size() && !usedMeshes[static_cast<size_t>(node.mesh)]) {
+                    usedMeshes[static_cast<size_t>(node.mesh)] = true;
+                    meshIndices.push_back(static_cast<size_t>(node.mesh));
+                }
+                pendingNodes.insert(pendingNodes.end(), node.children.rbegin(), node.children.rend());
+            }
+        }
+        return meshIndices;
+    }
+
+    // primitives outside of the region are left empty without reading their accessors
+    std::vector<std::optional<primitive_data_t>> prepareMesh(size_t meshIndex) const
+    {
+        const tinygltf::Mesh & mesh{ m_gltfModel.meshes.at(meshIndex) };
+        std::vector<std::optional<primitive_data_t>> primitives;
+        primitives.reserve(mesh.primitives.size());
+
+        for (size_t i = 0; i < mesh.primitives.size(); ++i) {
+            primitives.push_back(isPrimitiveInRegion(meshIndex, i) ? preparePrimitive(mesh.primitives[i]) : std::nullopt);
+        }
+
+        return primitives;
+    }
+
+    std::optional<primitive_data_t> preparePrimitive(const tinygltf::Primitive & primitive) const
+    {
+        switch (primitive.mode) {
+        case TINYGLTF_MODE_TRIANGLES:
+        case TINYGLTF_MODE_TRIANGLE_STRIP:
+        case TINYGLTF_MODE_TRIANGLE_FAN:
+            return prepareTriangles(primitive);
+        case TINYGLTF_MODE_LINE:
+        case TINYGLTF_MODE_LINE_STRIP:
+        case TINYGLTF_MODE_LINE_LOOP:
+            return prepareLines(primitive);
+        case TINYGLTF_MODE_POINTS:
+            return preparePoints(primitive);
+        default:
+            return std::nullopt;
+        }
+    }
+
+    std::vector<std::optional<primitive_data_t>> takePreparedMesh(size_t meshIndex)
+    {
+        if (meshIndex < m_preparedMeshes.size() && m_preparedMeshes[meshIndex].prepared) {
+            prepared_mesh_t preparedMesh{ std::move(m_preparedMeshes[meshIndex]) };
+            m_preparedMeshes[meshIndex] = prepared_mesh_t{};
+            if (preparedMesh.error) {
+                std::rethrow_exception(preparedMesh.error);
+            }
+            return std::move(preparedMesh.primitives);
+        }
+        return prepareMesh(meshIndex);
+    }
+
+    void convertScene(iv_root_t root, const tinygltf::Scene & scene)
+    {
+        spdlog::trace("converting gltf scene with name '{}'", scene.name);
+
+        SoSeparator * sceneRoot{ new SoSeparator };
+
+        addName(sceneRoot, scene.name);
+        if (m_selectedParentMatrices.empty()) {
+            convertNodes(sceneRoot, scene.nodes);
+        }
+        else {
+            for (const int nodeIndex : scene.nodes) {
+                convertSelectedNode(sceneRoot, static_cast<size_t>(nodeIndex));
+            }
+        }
+
+        root->addChild(sceneRoot);
+    }
+
+    // a selected node below transformed nodes gets a separator with their matrix above it
+    void convertSelectedNode(iv_root_t root, size_t nodeIndex)
+    {
+        const auto parentMatrix{ m_selectedParentMatrices.find(nodeIndex) };
+        const tinygltf::Node & node{ m_gltfModel.nodes.at(nodeIndex) };
+        if (parentMatrix == m_selectedParentMatrices.cend() || hasZeroScale(node) || !isInRegion(nodeIndex)) {
+            convertNode(root, nodeIndex);
+            return;
+        }
+
+        const matrix_t & m{ parentMatrix->second };
+        spdlog::trace("converting the transform of the nodes above selected gltf node with index {}", nodeIndex);
+
+        SoSeparator * selectedRoot{ new SoSeparator };
+        SoMatrixTransform * transformNode{ new SoMatrixTransform };
+        transformNode->matrix = SbMatrix{
+            static_cast<float>(m[0]), static_cast<float>(m[1]), static_cast<float>(m[2]), static_cast<float>(m[3]),
+            static_cast<float>(m[4]), static_cast<float>(m[5]), static_cast<float>(m[6]), static_cast<float>(m[7]),
+            static_cast<float>(m[8]), static_cast<float>(m[9]), static_cast<float>(m[10]), static_cast<float>(m[11]),
+            static_cast<float>(m[12]), static_cast<float>(m[13]), static_cast<float>(m[14]), static_cast<float>(m[15])
+        };
+        selectedRoot->addChild(transformNode);
+        convertNode(selectedRoot, nodeIndex);
+
+        root->addChild(selectedRoot);
+    }
+
+    void addName(iv_base_t root, std::string name)
+    {
+        if (!name.empty()) {
+            SbString nameString{ name.c_str() };
+            root->setName(SbName{ nameString });
+        }
+    }
+
+    void convertNodes(iv_root_t root, const std::vector<int> & nodeIndices)
+    {
+        spdlog::trace("converting {} gltf nodes", nodeIndices.size());
+
+        std::for_each(
+            nodeIndices.cbegin(),
+            nodeIndices.cend(),
+            [this, root] (int nodeIndex)
+            {
+                convertNode(root, static_cast<size_t>(nodeIndex));
+            }
+        );
+    }
+
+    void convertNode(iv_root_t root, size_t nodeIndex)
+    {
+        spdlog::trace("converting gltf node with index {}", nodeIndex);
+
+        if (m_nodes.contains(nodeIndex)) {
+            spdlog::debug("re-using already converted gltf node with index {}", nodeIndex);
+            root->addChild(m_nodes.at(nodeIndex));
+        }
+        else {
+            const tinygltf::Node node{ m_gltfModel.nodes.at(nodeIndex) };
+            spdlog::debug("converting gltf node with name '{}'", node.name);
+
+            if (hasZeroScale(node)) {
+                spdlog::debug("skipping gltf node with zero scale");
+                return;
+            }
+            if (!isInRegion(nodeIndex)) {
+                spdlog::debug("skipping gltf node outside of the region");
+                return;
+            }
+
+            SoSeparator * nodeRoot{ new SoSeparator };
+
+            addName(nodeRoot, node.name);
+
+            // gltf applies the scale first, then the rotation and the translation last
+            convertTransform(nodeRoot, node);
+            convertTranslation(nodeRoot, node);
+            convertRotation(nodeRoot, node);
+            convertScale(nodeRoot, node);
+
+            if (hasMesh(node) && isMeshInRegion(nodeIndex)) {
+                convertInstances(nodeRoot, node);
+            }
+
+            if (!node.children.empty()) {
+                convertNodes(nodeRoot, node.children);
+            }
+
+            root->addChild(nodeRoot);
+            m_nodes.insert(std::make_pair(nodeIndex, nodeRoot));
+        }
+    }
+
+    static inline bool hasMesh(const tinygltf::Node & node) {
+        return node.mesh >= 0;
+    }
+
+    static inline bool hasZeroScale(const tinygltf::Node & node)
+    {
+        return hasScale(node) && node.scale[0] == 0.0 && node.scale[1] == 0.0 && node.scale[2] == 0.0;
+    }
+
+    static void convertTransform(iv_root_t root, const tinygltf::Node & node)
+    {
+        if (hasTransform(node)) {
+            spdlog::trace("converting transform [{:.4}, {:.4}, {:.4}, {:.4}; {:.4}, {:.4}, {:.4}, {:.4}; {:.4}, {:.4}, {:.4}, {:.4}; {:.4}, {:.4}, {:.4}, {:.4};] for gltf node",
+                node.matrix[0], node.matrix[1], node.matrix[2], node.matrix[3],
+                node.matrix[4], node.matrix[5], node.matrix[6], node.matrix[7],
+                node.matrix[8], node.matrix[9], node.matrix[10], node.matrix[11],
+                node.matrix[12], node.matrix[13], node.matrix[14], node.matrix[15]
+            );
+
+            SoTransform * transformNode{ new SoTransform };
+
+            transformNode->setMatrix(
+                SbMatrix{
+                    static_cast<float>(node.matrix[0]), static_cast<float>(node.matrix[1]), static_cast<float>(node.matrix[2]), static_cast<float>(node.matrix[3]),
+                    static_cast<float>(node.matrix[4]), static_cast<float>(node.matrix[5]), static_cast<float>(node.matrix[6]), static_cast<float>(node.matrix[7]),
+                    static_cast<float>(node.matrix[8]), static_cast<float>(node.matrix[9]), static_cast<float>(node.matrix[10]), static_cast<float>(node.matrix[11]),
+                    static_cast<float>(node.matrix[12]), static_cast<float>(node.matrix[13]), static_cast<float>(node.matrix[14]), static_cast<float>(node.matrix[15])
+                }
+            );
+
+            root->addChild(transformNode);
+        }
+    }
+
+    inline static bool hasTransform(const tinygltf::Node & node)
+    {
+        return node.matrix.size() == 16U;
+    }
+
+    static void convertScale(iv_root_t root, const tinygltf::Node & node)
+    {
+        if (hasScale(node)) {
+            spdlog::trace("converting scale [{:.4}, {:.4}, {:.4}] for gltf node", node.scale[0], node.scale[1], node.scale[2]);
+
+            SoScale * scaleNode{ new SoScale };
+
+            SoSFVec3f scaleVector;
+
+            scaleVector.setValue(
+                static_cast<float>(node.scale[0]),
+                static_cast<float>(node.scale[1]),
+                static_cast<float>(node.scale[2])
+            );
+
+            scaleNode->scaleFactor = scaleVector;
+
+            root->addChild(scaleNode);
+        }
+    }
+
+    inline static bool hasScale(const tinygltf::Node & node)
+    {
+        return node.scale.size() == 3U;
+    }
+
+    static void convertRotation(iv_root_t root, const tinygltf::Node & node)
+    {
+        if (hasRotation(node)) {
+            spdlog::trace("converting rotation [{:.4}, {:.4}, {:.4}, {:.4}] for gltf node", node.rotation[0], node.rotation[1], node.rotation[2], node.rotation[3]);
+
+            SoRotation * rotationNode{ new SoRotation };
+
+            SoSFRotation rotation;
+
+            rotation.setValue(
+                static_cast<float>(node.rotation[0]),
+                static_cast<float>(node.rotation[1]),
+                static_cast<float>(node.rotation[2]),
+                static_cast<float>(node.rotation[3])
+            );
+
+            rotationNode->rotation = rotation;
+
+            root->addChild(rotationNode);
+        }
+    }
+
+    inline static bool hasRotation(const tinygltf::Node & node)
+    {
+        return node.rotation.size() == 4U;
+    }
+
+    static void convertTranslation(iv_root_t root, const tinygltf::Node & node)
+    {
+        if (hasTranslation(node)) {
+
+            spdlog::trace("converting translation [{:.4}, {:.4}, {:.4}] for gltf node", node.translation[0], node.translation[1], node.translation[2]);
+
+            SoTranslation * translationNode{ new SoTranslation };
+
+            SoSFVec3f translation;
+
+            translation.setValue(
+                static_cast<float>(node.translation[0]),
+                static_cast<float>(node.translation[1]),
+                static_cast<float>(node.translation[2])
+            );
+
+            translationNode->translation = translation;
+
+            root->addChild(translationNode);
+        }
+    }
+
+    inline static bool hasTranslation(const tinygltf::Node & node)
+    {
+        return node.translation.size() == 3U;
+    }
+
+
+    // the mesh of a node is converted once, instances of it are copies of the same separator
+    void convertInstances(iv_root_t root, const tinygltf::Node & node)
+    {
+        const size_t meshIndex{ static_cast<size_t>(node.mesh) };
+        const std::optional<std::vector<matrix_t>> instances{ instanceMatrices(node) };
+        if (!instances.has_value()) {
+            convertMesh(root.get(), meshIndex);
+            return;
+        }
+        if (instances.value().empty()) {
+            return;
+        }
+
+        SoMultipleCopy * copies{ new SoMultipleCopy };
+        copies->matrix.setNum(static_cast<int>(instances.value().size()));
+        SbMatrix * matrices{ copies->matrix.startEditing() };
+        for (size_t i = 0; i < instances.value().size(); ++i) {
+            const matrix_t & m{ instances.value()[i] };
+            matrices[i] = SbMatrix{
+                static_cast<float>(m[0]), static_cast<float>(m[1]), static_cast<float>(m[2]), static_cast<float>(m[3]),
+                static_cast<float>(m[4]), static_cast<float>(m[5]), static_cast<float>(m[6]), static_cast<float>(m[7]),
+                static_cast<float>(m[8]), static_cast<float>(m[9]), static_cast<float>(m[10]), static_cast<float>(m[11]),
+                static_cast<float>(m[12]), static_cast<float>(m[13]), static_cast<float>(m[14]), static_cast<float>(m[15])
+            };
+        }
+        copies->matrix.finishEditing();
+
+        convertMesh(copies, meshIndex);
+        root->addChild(copies);
+    }
+
+    void convertMesh(iv_group_t root, size_t meshIndex)
     {
         spdlog::trace("converting gltf mesh with index {}", meshIndex);
         if (m_meshes.contains(meshIndex)) {
@@ -296,15 +1140,15 @@ private:
             addName(meshNode, mesh.name);
 
             const std::vector<tinygltf::Primitive> & primitives{ mesh.primitives };
+            const std::vector<std::optional<primitive_data_t>> preparedPrimitives{ takePreparedMesh(meshIndex) };
 
-            std::for_each(
-                primitives.cbegin(),
-                primitives.cend(),
-                [this, meshNode] (const tinygltf::Primitive & primitive)
-                {
-                    convertPrimitive(meshNode, primitive);
+            bool textured{ false };
+            for (size_t i = 0; i < primitives.size(); ++i) {
+                if (!isPrimitiveInRegion(meshIndex, i)) {
+                    continue;
                 }
-            );
+                convertPrimitive(meshNode, primitives[i], preparedPrimitives.at(i), textured);
+            }
 
             root->addChild(meshNode);
             m_meshes.insert(std::make_pair(meshIndex, meshNode));
@@ -325,134 +1169,1024 @@ private:
         }
     }
 
-    void convertPrimitive(iv_root_t root, const tinygltf::Primitive & primitive)
+    // textured tells whether a texture of a previous primitive of the mesh is still active
+    void convertPrimitive(iv_root_t root, const tinygltf::Primitive & primitive, const std::optional<primitive_data_t> & data, bool & textured)
     {
         spdlog::trace("converting gltf primitive with mode {}", stringifyPrimitiveMode(primitive.mode));
 
-        switch (primitive.mode) {
-        case TINYGLTF_MODE_TRIANGLES:
-            convertTrianglesPrimitive(root, primitive);
-            break;
-        default:
+        if (!data.has_value()) {
             spdlog::warn("skipping primitive with unsupported mode {}", stringifyPrimitiveMode(primitive.mode));
+            return;
+        }
+
+        convertMaterial(root, primitive);
+
+        const bool hasTexture{ !data.value().texCoords.empty() && convertTexture(root, primitive) };
+        if (textured && !hasTexture) {
+            // a texture without image switches texturing off for the following shapes
+            root->addChild(new SoTexture2);
+        }
+        textured = hasTexture;
+
+        convertPrimitiveData(root, data.value());
+    }
+
+    void convertMaterial(iv_root_t root, const tinygltf::Primitive & primitive)
+    {
+        if (hasMaterial(primitive)) {
+            convertMaterial(root, static_cast<size_t>(primitive.material));
+        }
+    }
+
+    static inline bool hasMaterial(const tinygltf::Primitive & primitive)
+    {
+        return primitive.material >= 0;
+    }
+
+    void convertMaterial(iv_root_t root, size_t materialIndex)
+    {
+        spdlog::trace("converting gltf material with index {}", materialIndex);
+        if (m_materials.contains(materialIndex)) {
+            spdlog::debug("re-using already converted gltf material with index {}", materialIndex);
+            root->addChild(m_materials.at(materialIndex));
+        }
+        else {
+            const tinygltf::Material material{ m_gltfModel.materials.at(materialIndex) };
+
+            SoMaterial * materialNode = new SoMaterial;
+
+            addName(materialNode, material.name);
+
+            materialNode->diffuseColor = diffuseColor(material);
+            materialNode->transparency = transparency(material);
+            materialNode->emissiveColor = emissiveColor(material);
+            root->addChild(materialNode);
+            m_materials.insert(std::make_pair(materialIndex, materialNode));
+        }
+
+        SoMaterialBinding * materialBinding = new SoMaterialBinding;
+        materialBinding->value = SoMaterialBinding::Binding::OVERALL;
+        root->addChild(materialBinding);
+    }
+
+    // the texture of the material's base color, if the material has one
+    std::optional<size_t> baseColorTexture(const tinygltf::Primitive & primitive) const
+    {
+        if (!hasMaterial(primitive) || static_cast<size_t>(primitive.material) >= m_gltfModel.materials.size()) {
+            return std::nullopt;
+        }
+        const int textureIndex{ m_gltfModel.materials[static_cast<size_t>(primitive.material)].pbrMetallicRoughness.baseColorTexture.index };
+        if (textureIndex < 0 || static_cast<size_t>(textureIndex) >= m_gltfModel.textures.size()) {
+            return std::nullopt;
+        }
+        return static_cast<size_t>(textureIndex);
+    }
+
+    bool convertTexture(iv_root_t root, const tinygltf::Primitive & primitive)
+    {
+        const std::optional<size_t> textureIndex{ baseColorTexture(primitive) };
+        if (!textureIndex.has_value()) {
+            return false;
+        }
+
+        spdlog::trace("converting gltf texture with index {}", textureIndex.value());
+        if (m_textures.contains(textureIndex.value())) {
+            spdlog::debug("re-using already converted gltf texture with index {}", textureIndex.value());
+            root->addChild(m_textures.at(textureIndex.value()));
+            return true;
+        }
+
+        const tinygltf::Image * decodedImage{ textureImage(textureIndex.value()) };
+        if (decodedImage == nullptr) {
+            return false;
+        }
+        const tinygltf::Image & image{ *decodedImage };
+        const tinygltf::Texture & texture{ m_gltfModel.textures[textureIndex.value()] };
+
+        SoTexture2 * textureNode{ new SoTexture2 };
+
+        addName(textureNode, texture.name.empty() ? image.name : texture.name);
+
+        // the decoded image lives in the model as long as the writer, no copy is needed. glTF
+        // and coin both put texture coordinate (0, 0) at the first pixel, so nothing is flipped.
+        textureNode->image.setValue(
+            SbVec2s{ static_cast<short>(image.width), static_cast<short>(image.height) },
+            image.component,
+            image.image.data(),
+            SoSFImage::NO_COPY
+        );
+        textureNode->model = SoTexture2::MODULATE;
+
+        if (texture.sampler >= 0 && static_cast<size_t>(texture.sampler) < m_gltfModel.samplers.size()) {
+            const tinygltf::Sampler & sampler{ m_gltfModel.samplers[static_cast<size_t>(texture.sampler)] };
+            textureNode->wrapS = textureWrap(sampler.wrapS);
+            textureNode->wrapT = textureWrap(sampler.wrapT);
+        }
+
+        spdlog::debug("converted gltf image of size {}x{}x{} to texture", image.width, image.height, image.component);
+
+        root->addChild(textureNode);
+        m_textures.insert(std::make_pair(textureIndex.value(), textureNode));
+        return true;
+    }
+
+    // the decoded 8 bit image of a texture, or nullptr if it has none coin can use
+    const tinygltf::Image * textureImage(size_t textureIndex)
+    {
+        const tinygltf::Texture & texture{ m_gltfModel.textures.at(textureIndex) };
+        if (texture.source < 0 || static_cast<size_t>(texture.source) >= m_gltfModel.images.size()) {
+            spdlog::warn("skipping gltf texture with index {} without image", textureIndex);
+            return nullptr;
+        }
+
+        tinygltf::Image & image{ m_gltfModel.images[static_cast<size_t>(texture.source)] };
+        if (!GltfIv::decodeImage(m_gltfModel, image) || !ensureImage8Bits(image)) {
+            spdlog::warn("skipping gltf texture with index {} without image data", textureIndex);
+            return nullptr;
+        }
+
+        constexpr int max_image_size{ std::numeric_limits<short>::max() };
+        if (image.width <= 0 || image.height <= 0 || image.width > max_image_size || image.height > max_image_size || image.component < 1 || image.component > 4) {
+            spdlog::warn("skipping gltf texture with index {} with unsupported image of size {}x{}x{}", textureIndex, image.width, image.height, image.component);
+            return nullptr;
+        }
+        return &image;
+    }
+
+    // coin has no mirrored repeat, it repeats instead
+    static SoTexture2::Wrap textureWrap(int wrap)
+    {
+        return wrap == TINYGLTF_TEXTURE_WRAP_CLAMP_TO_EDGE ? SoTexture2::CLAMP : SoTexture2::REPEAT;
+    }
+
+    // sixteen bit images are reduced to their high bytes in place, once for all textures using them
+    static bool ensureImage8Bits(tinygltf::Image & image)
+    {
+        if (image.bits == 8) {
+            return true;
+        }
+        if (image.bits != 16) {
+            spdlog::warn("unsupported number of bits per channel ({}) in gltf image '{}'", image.bits, image.name);
+            return false;
+        }
+
+        spdlog::trace("reducing gltf image '{}' from 16 to 8 bits per channel", image.name);
+
+        const size_t channelCount{ image.image.size() / 2U };
+        for (size_t i = 0; i < channelCount; ++i) {
+            uint16_t channel;
+            std::memcpy(&channel, &image.image[i * 2U], sizeof(channel));
+            image.image[i] = static_cast<unsigned char>(channel >> 8);
+        }
+        image.image.resize(channelCount);
+        image.bits = 8;
+        image.pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+        return true;
+    }
+
+    static void ensureColorVectorLength(const std::vector<double> & color, size_t expectedLength) {
+
+        if (color.size() != expectedLength) {
+            throw std::invalid_argument(
+                fmt::format(
+                    "color vector is of length {} as opposed to the expected length {}", 
+                    color.size(), 
+                    expectedLength
+                )
+            );
+        }
+    }
+
+    static SbColor diffuseColor(const tinygltf::Material & material)
+    {
+        spdlog::trace("extracting diffuse color from gltf material");
+
+        const std::vector<double> & baseColorFactor{ material.pbrMetallicRoughness.baseColorFactor };
+
+        ensureColorVectorLength(baseColorFactor, 4U);
+        
+        spdlog::debug("extracting diffuse color ({:.4}, {:.4}, {:.4}) from gltf material", baseColorFactor[0], baseColorFactor[1], baseColorFactor[2]);
+
+        return SbColor{
+            static_cast<float>(baseColorFactor[0]),
+            static_cast<float>(baseColorFactor[1]),
+            static_cast<float>(baseColorFactor[2])
+        };
+    }
+
+    static float transparency(const tinygltf::Material & material)
+    {
+        spdlog::trace("extracting transparency color from gltf material");
+
+        const std::vector<double> & baseColorFactor{ material.pbrMetallicRoughness.baseColorFactor };
+
+        ensureColorVectorLength(baseColorFactor, 4U);
+
+        spdlog::debug("extracting transparency ({:.4}) from gltf material", baseColorFactor[3]);
+
+        return 1.0f - static_cast<float>(baseColorFactor[3]);
+    }
+
+    static SbColor emissiveColor(const tinygltf::Material & material)
+    {
+        spdlog::trace("extracting emissive color from gltf material");
+
+        const std::vector<double> & emissiveFactor{ material.emissiveFactor };
+
+        ensureColorVectorLength(emissiveFactor, 3U);
+
+        spdlog::debug("extracting emissive color ({:.4}, {:.4}, {:.4}) from gltf material", emissiveFactor[0], emissiveFactor[1], emissiveFactor[2]);
+
+        return SbColor{
+            static_cast<float>(emissiveFactor[0]),
+            static_cast<float>(emissiveFactor[1]),
+            static_cast<float>(emissiveFactor[2])
+        };
+    }
+
+    // strips and fans keep their triangles as they are: a strip becomes a single strip and every
+    // two triangles of a fan a strip of four vertices. only triangle lists are stripified.
+    primitive_data_t prepareTriangles(const tinygltf::Primitive & primitive) const
+    {
+        spdlog::trace("preparing vertices of gltf triangles primitive");
+
+        primitive_data_t data{ primitive_shape_t::TRIANGLE_STRIPS };
+        const vertex_indices_t vertices{ prepareVertices(primitive, data) };
+
+        switch (primitive.mode) {
+        case TINYGLTF_MODE_TRIANGLE_STRIP:
+            indexCorners(stripCorners(vertices.positions.size()), vertices, data);
+            break;
+        case TINYGLTF_MODE_TRIANGLE_FAN:
+            indexCorners(fanCorners(vertices.positions.size()), vertices, data);
+            break;
+        default:
+            stripify(vertices, data);
+        }
+        return data;
+    }
+
+    primitive_data_t prepareLines(const tinygltf::Primitive & primitive) const
+    {
+        spdlog::trace("preparing vertices of gltf lines primitive");
+
+        primitive_data_t data{ primitive_shape_t::LINES };
+        const vertex_indices_t vertices{ prepareVertices(primitive, data) };
+
+        switch (primitive.mode) {
+        case TINYGLTF_MODE_LINE_STRIP:
+            indexCorners(lineStripCorners(vertices.positions.size(), false), vertices, data);
+            break;
+        case TINYGLTF_MODE_LINE_LOOP:
+            indexCorners(lineStripCorners(vertices.positions.size(), true), vertices, data);
+            break;
+        default:
+            indexCorners(lineCorners(vertices), vertices, data);
+        }
+        return data;
+    }
+
+    // a point set draws its coordinates in order, so the vertices are gathered through the
+    // indices instead of being made unique
+    primitive_data_t preparePoints(const tinygltf::Primitive & primitive) const
+    {
+        spdlog::trace("preparing vertices of gltf points primitive");
+
+        primitive_data_t data{ primitive_shape_t::POINTS };
+        const positions_view_t positionsView{ positions(primitive) };
+        const normals_view_t normalsView{ normals(primitive) };
+        const texcoords_view_t texCoordsView{ texCoords(primitive) };
+        ensureAttributeCount(positionsView.size(), normalsView.size(), "normals");
+        ensureAttributeCount(positionsView.size(), texCoordsView.size(), "texture coordinates");
+
+        auto gather = [&data, &positionsView, &normalsView, &texCoordsView] (size_t index)
+        {
+            data.positions.push_back(positionsView.at(index));
+            if (!normalsView.empty()) {
+                data.normals.push_back(normalsView[index]);
+            }
+            if (!texCoordsView.empty()) {
+                data.texCoords.push_back(texCoordsView[index]);
+            }
+        };
+
+        if (hasIndices(primitive)) {
+            std::visit(
+                [&data, &gather] (const auto & indexView)
+                {
+                    data.positions.reserve(indexView.size());
+                    for (size_t i = 0; i < indexView.size(); ++i) {
+                        gather(indexView[i]);
+                    }
+                },
+                indices(primitive)
+            );
+        }
+        else {
+            data.positions.reserve(positionsView.size());
+            for (size_t i = 0; i < positionsView.size(); ++i) {
+                gather(i);
+            }
+        }
+
+        spdlog::debug("prepared {} points from gltf primitive", data.positions.size());
+        return data;
+    }
+
+    static void ensureAttributeCount(size_t positionCount, size_t attributeCount, const char * attribute)
+    {
+        if (attributeCount != 0U && attributeCount != positionCount) {
+            throw std::invalid_argument(fmt::format("mismatching number of positions ({}) and {} ({})", positionCount, attribute, attributeCount));
+        }
+    }
+
+    // the unique positions, normals and texture coordinates go to the prepared data, the index of
+    // every vertex of the primitive among them is returned
+    vertex_indices_t prepareVertices(const tinygltf::Primitive & primitive, primitive_data_t & data) const
+    {
+        unique_items_t<position_t> uniquePositions{ unique(positions(primitive)) };
+        unique_items_t<normal_t> uniqueNormals{ unique(normals(primitive)) };
+        unique_items_t<texcoord_t> uniqueTexCoords{ unique(texCoords(primitive)) };
+
+        ensureAttributeCount(uniquePositions.indices.size(), uniqueNormals.indices.size(), "normals");
+        ensureAttributeCount(uniquePositions.indices.size(), uniqueTexCoords.indices.size(), "texture coordinates");
+
+        vertex_indices_t vertices;
+        if (hasIndices(primitive)) {
+            const gltf_indices_t indices{ this->indices(primitive) };
+            vertices.positions = remapIndices(indices, uniquePositions.indices);
+            if (!uniqueNormals.indices.empty()) {
+                vertices.normals = remapIndices(indices, uniqueNormals.indices);
+            }
+            if (!uniqueTexCoords.indices.empty()) {
+                vertices.texCoords = remapIndices(indices, uniqueTexCoords.indices);
+            }
+        }
+        else {
+            vertices.positions = std::move(uniquePositions.indices);
+            vertices.normals = std::move(uniqueNormals.indices);
+            vertices.texCoords = std::move(uniqueTexCoords.indices);
+        }
+
+        data.positions = std::move(uniquePositions.items);
+        data.normals = std::move(uniqueNormals.items);
+        data.texCoords = std::move(uniqueTexCoords.items);
+        return vertices;
+    }
+
+    // corners are positions in the vertex sequence of a primitive, with -1 ending a strip or
+    // polyline. they are resolved to position, normal and texture coordinate indices in one go.
+    static void indexCorners(const iv_indices_t & corners, const vertex_indices_t & vertices, primitive_data_t & data)
+    {
+        auto resolve = [&corners] (const iv_indices_t & indices, iv_indices_t & resolvedIndices)
+        {
+            if (indices.empty()) {
+                return;
+            }
+            resolvedIndices.reserve(corners.size());
+            for (const iv_index_t corner : corners) {
+                resolvedIndices.push_back(corner < 0 ? -1 : indices[static_cast<size_t>(corner)]);
+            }
+        };
+
+        resolve(vertices.positions, data.coordIndex);
+        resolve(vertices.normals, data.normalIndex);
+        resolve(vertices.texCoords, data.textureCoordIndex);
+
+        spdlog::debug("indexed {} vertices of gltf primitive with {} indices", vertices.positions.size(), data.coordIndex.size());
+    }
+
+    static iv_indices_t stripCorners(size_t vertexCount)
+    {
+        iv_indices_t corners;
+        if (vertexCount >= 3U) {
+            corners.reserve(vertexCount + 1U);
+            for (size_t i = 0; i < vertexCount; ++i) {
+                corners.push_back(static_cast<iv_index_t>(i));
+            }
+            corners.push_back(-1);
+        }
+        return corners;
+    }
+
+    // the fan triangles (0, i, i + 1) and (0, i + 1, i + 2) are the strip (i, i + 1, 0, i + 2),
+    // a last odd triangle is a strip of its own
+    static iv_indices_t fanCorners(size_t vertexCount)
+    {
+        iv_indices_t corners;
+        if (vertexCount < 3U) {
+            return corners;
+        }
+        corners.reserve((vertexCount - 1U) / 2U * 5U + 4U);
+
+        size_t i{ 1U };
+        for (; i + 2U < vertexCount; i += 2U) {
+            corners.insert(corners.end(), { static_cast<iv_index_t>(i), static_cast<iv_index_t>(i + 1U), 0, static_cast<iv_index_t>(i + 2U), -1 });
+        }
+        if (i + 1U < vertexCount) {
+            corners.insert(corners.end(), { 0, static_cast<iv_index_t>(i), static_cast<iv_index_t>(i + 1U), -1 });
+        }
+        return corners;
+    }
+
+    static iv_indices_t lineStripCorners(size_t vertexCount, bool closed)
+    {
+        iv_indices_t corners;
+        if (vertexCount >= 2U) {
+            corners.reserve(vertexCount + 2U);
+            for (size_t i = 0; i < vertexCount; ++i) {
+                corners.push_back(static_cast<iv_index_t>(i));
+            }
+            if (closed) {
+                corners.push_back(0);
+            }
+            corners.push_back(-1);
+        }
+        return corners;
+    }
+
+    // segments continuing where the previous one ended are joined into one polyline
+    static iv_indices_t lineCorners(const vertex_indices_t & vertices)
+    {
+        constexpr size_t line_size{ 2U };
+
+        if (vertices.positions.size() % line_size != 0) {
+            spdlog::warn("ignoring the last vertex of a gltf lines primitive with an odd number of vertices ({})", vertices.positions.size());
+        }
+        const size_t lineCount{ vertices.positions.size() / line_size };
+
+        iv_indices_t corners;
+        corners.reserve(lineCount * 3U);
+        for (size_t i = 0; i < lineCount; ++i) {
+            const size_t start{ i * line_size };
+            if (i == 0 || vertexKey(vertices, start - 1U) != vertexKey(vertices, start)) {
+                if (i > 0) {
+                    corners.push_back(-1);
+                }
+                corners.push_back(static_cast<iv_index_t>(start));
+            }
+            corners.push_back(static_cast<iv_index_t>(start + 1U));
+        }
+        if (!corners.empty()) {
+            corners.push_back(-1);
+        }
+        return corners;
+    }
+
+    static vertex_key_t vertexKey(const vertex_indices_t & vertices, size_t i)
+    {
+        return vertex_key_t{
+            vertices.positions[i],
+            vertices.normals.empty() ? 0 : vertices.normals[i],
+            vertices.texCoords.empty() ? 0 : vertices.texCoords[i]
+        };
+    }
+
+    // the strips are built over vertices made of a position, a normal and a texture coordinate
+    // index, as all index fields of the strip set share the same strip structure
+    static void stripify(const vertex_indices_t & vertices, primitive_data_t & data)
+    {
+        constexpr size_t triangle_size{ 3U };
+
+        if (vertices.positions.size() % triangle_size != 0) {
+            throw std::invalid_argument(fmt::format("number of positions ({}) is not divisible by the triangle size ({})", vertices.positions.size(), triangle_size));
+        }
+
+        spdlog::trace("stripifying {} triangles from gltf primitive", vertices.positions.size() / triangle_size);
+
+        std::unordered_map<vertex_key_t, iv_index_t, vertex_key_hash_t> vertexIds;
+        vertexIds.reserve(vertices.positions.size());
+        std::vector<vertex_key_t> uniqueVertices;
+        GltfIvStripifier::indices_t triangleVertices;
+        triangleVertices.reserve(vertices.positions.size());
+
+        for (size_t i = 0; i < vertices.positions.size(); ++i) {
+            const vertex_key_t key{ vertexKey(vertices, i) };
+            const auto [it, inserted] = vertexIds.try_emplace(key, static_cast<iv_index_t>(uniqueVertices.size()));
+            if (inserted) {
+                uniqueVertices.push_back(key);
+            }
+            triangleVertices.push_back(it->second);
+        }
+
+        const GltfIvStripifier::indices_t strips{ GltfIvStripifier::stripify(triangleVertices) };
+
+        auto resolve = [&strips, &uniqueVertices] (size_t component, iv_indices_t & resolvedIndices)
+        {
+            resolvedIndices.reserve(strips.size());
+            for (const iv_index_t vertex : strips) {
+                resolvedIndices.push_back(vertex < 0 ? -1 : uniqueVertices[static_cast<size_t>(vertex)][component]);
+            }
+        };
+
+        resolve(0U, data.coordIndex);
+        if (!vertices.normals.empty()) {
+            resolve(1U, data.normalIndex);
+        }
+        if (!vertices.texCoords.empty()) {
+            resolve(2U, data.textureCoordIndex);
+        }
+
+        spdlog::debug("stripified {} triangles into {} strip indices", vertices.positions.size() / triangle_size, strips.size());
+    }
+
+    static void convertPrimitiveData(iv_root_t root, const primitive_data_t & data)
+    {
+        convertPositions(root, data.positions);
+
+        // without normals an empty normal node still replaces the normals of a previous primitive
+        // of the mesh, so that coin generates them for triangles and draws lines and points unlit
+        if (!data.normals.empty()) {
+            SoNormalBinding * normalBinding = new SoNormalBinding;
+            normalBinding->value = data.shape == primitive_shape_t::POINTS ? SoNormalBinding::Binding::PER_VERTEX : SoNormalBinding::Binding::PER_VERTEX_INDEXED;
+            root->addChild(normalBinding);
+        }
+
+        convertNormals(root, data.normals);
+
+        if (!data.texCoords.empty()) {
+            SoTextureCoordinateBinding * textureCoordinateBinding = new SoTextureCoordinateBinding;
+            textureCoordinateBinding->value = data.shape == primitive_shape_t::POINTS ? SoTextureCoordinateBinding::Binding::PER_VERTEX : SoTextureCoordinateBinding::Binding::PER_VERTEX_INDEXED;
+            root->addChild(textureCoordinateBinding);
+
+            convertTextureCoordinates(root, data.texCoords);
+        }
+
+        switch (data.shape) {
+        case primitive_shape_t::TRIANGLE_STRIPS:
+            convertTriangles(root, data);
+            break;
+        case primitive_shape_t::LINES:
+            convertLines(root, data);
+            break;
+        case primitive_shape_t::POINTS:
+            convertPoints(root, data.positions.size());
+            break;
+        }
+    }
+
+    // the ascii output is streamed from the gltf model in one pass, with the same nodes as the
+    // coin scene graph. nodes, meshes, materials and textures used more than once are written
+    // with DEF and then USE, as SoWriteAction does.
+    bool streamModel(const std::string & filename)
+    {
+        spdlog::stopwatch stopwatch;
+        spdlog::trace("streaming gltf model to open inventor file {}", filename);
+
+        std::ofstream out{ filename, std::ios::binary };
+        if (!out) {
+            spdlog::error("failed to open file {}", filename);
+            return false;
+        }
+
+        const std::vector<tinygltf::Scene> scenes{ selectedScenes() };
+        cullRegion(scenes);
+        const std::vector<size_t> meshIndices{ usedMeshes(scenes) };
+        decodeTextureImages(meshIndices);
+        prepareMeshes(meshIndices);
+        countReferences(scenes);
+
+        GltfIvStreamWriter stream{ out, m_precision };
+        stream.writeHeader();
+        stream.beginNode("Separator");
+        for (const tinygltf::Scene & scene : scenes) {
+            streamScene(stream, scene);
+        }
+        stream.endNode();
+        stream.flush();
+        out.close();
+
+        m_preparedMeshes.clear();
+        m_defCount = 0U;
+
+        if (!out) {
+            spdlog::error("failed to write file {}", filename);
+            return false;
+        }
+        spdlog::debug("finished streaming gltf model to open inventor file {} ({:.3} seconds)", filename, stopwatch);
+        return true;
+    }
+
+    // nodes, meshes, materials and textures by their gltf index
+    struct streamed_objects_t {
+        std::unordered_map<size_t, size_t> references;
+        std::unordered_map<size_t, std::string> defNames;
+
+        void clear()
+        {
+            references.clear();
+            defNames.clear();
+        }
+    };
+
+    void countReferences(const std::vector<tinygltf::Scene> & scenes)
+    {
+        m_streamedNodes.clear();
+        m_streamedMeshes.clear();
+        m_streamedMaterials.clear();
+        m_streamedTextures.clear();
+
+        for (const tinygltf::Scene & scene : scenes) {
+            for (const int nodeIndex : scene.nodes) {
+                countNodeReferences(static_cast<size_t>(nodeIndex));
+            }
+        }
+    }
+
+    void countNodeReferences(size_t nodeIndex)
+    {
+        if (m_streamedNodes.references[nodeIndex]++ > 0U) {
+            return;
+        }
+        const tinygltf::Node & node{ m_gltfModel.nodes.at(nodeIndex) };
+        if (hasZeroScale(node) || !isInRegion(nodeIndex)) {
+            return;
+        }
+        if (hasMesh(node) && isMeshInRegion(nodeIndex) && m_streamedMeshes.references[static_cast<size_t>(node.mesh)]++ == 0U) {
+            const std::vector<tinygltf::Primitive> & primitives{ m_gltfModel.meshes.at(static_cast<size_t>(node.mesh)).primitives };
+            for (size_t i = 0; i < primitives.size(); ++i) {
+                const tinygltf::Primitive & primitive{ primitives[i] };
+                if (!isPrimitiveInRegion(static_cast<size_t>(node.mesh), i)) {
+                    continue;
+                }
+                if (hasMaterial(primitive)) {
+                    ++m_streamedMaterials.references[static_cast<size_t>(primitive.material)];
+                }
+                if (const std::optional<size_t> textureIndex{ baseColorTexture(primitive) }) {
+                    ++m_streamedTextures.references[textureIndex.value()];
+                }
+            }
+        }
+        for (const int childIndex : node.children) {
+            countNodeReferences(static_cast<size_t>(childIndex));
+        }
+    }
+
+    // writes USE for an object streamed before and returns true
+    static bool streamUse(GltfIvStreamWriter & stream, const streamed_objects_t & objects, size_t index)
+    {
+        const auto defName{ objects.defNames.find(index) };
+        if (defName == objects.defNames.cend()) {
+            return false;
+        }
+        stream.useNode(defName->second);
+        return true;
+    }
+
+    // named objects keep their name, objects used more than once get a unique def name
+    std::string streamDefName(streamed_objects_t & objects, size_t index, const std::string & name)
+    {
+        std::string defName{ GltfIvStreamWriter::defName(name) };
+        const auto references{ objects.references.find(index) };
+        if (references != objects.references.cend() && references->second > 1U) {
+            defName += fmt::format("+{}", m_defCount++);
+            objects.defNames.insert(std::make_pair(index, defName));
+        }
+        return defName;
+    }
+
+    void streamScene(GltfIvStreamWriter & stream, const tinygltf::Scene & scene)
+    {
+        spdlog::trace("streaming gltf scene with name '{}'", scene.name);
+
+        stream.beginNode("Separator", GltfIvStreamWriter::defName(scene.name));
+        for (const int nodeIndex : scene.nodes) {
+            streamSelectedNode(stream, static_cast<size_t>(nodeIndex));
+        }
+        stream.endNode();
+    }
+
+    // a selected node below transformed nodes gets a separator with their matrix above it
+    void streamSelectedNode(GltfIvStreamWriter & stream, size_t nodeIndex)
+    {
+        const auto parentMatrix{ m_selectedParentMatrices.find(nodeIndex) };
+        const tinygltf::Node & node{ m_gltfModel.nodes.at(nodeIndex) };
+        if (parentMatrix == m_selectedParentMatrices.cend() || hasZeroScale(node) || !isInRegion(nodeIndex)) {
+            streamNode(stream, nodeIndex);
+            return;
+        }
+
+        std::array<float, 16> matrix;
+        std::transform(parentMatrix->second.cbegin(), parentMatrix->second.cend(), matrix.begin(), [] (double value) { return static_cast<float>(value); });
+        stream.beginNode("Separator");
+        stream.beginNode("MatrixTransform");
+        stream.field("matrix", matrix);
+        stream.endNode();
+        streamNode(stream, nodeIndex);
+        stream.endNode();
+    }
+
+    void streamNode(GltfIvStreamWriter & stream, size_t nodeIndex)
+    {
+        if (streamUse(stream, m_streamedNodes, nodeIndex)) {
+            spdlog::debug("re-using already streamed gltf node with index {}", nodeIndex);
+            return;
+        }
+
+        const tinygltf::Node & node{ m_gltfModel.nodes.at(nodeIndex) };
+        if (hasZeroScale(node)) {
+            spdlog::debug("skipping gltf node with zero scale");
+            return;
+        }
+        if (!isInRegion(nodeIndex)) {
+            spdlog::debug("skipping gltf node outside of the region");
+            return;
+        }
+
+        const bool meshInRegion{ hasMesh(node) && isMeshInRegion(nodeIndex) };
+
+        // an unnamed node used once with nothing but its mesh or a single child, which are
+        // separators themselves, needs no separator of its own
+        const bool flatten{
+            m_compact && isIdentityTransform(node) && node.name.empty() && m_streamedNodes.references[nodeIndex] == 1U
+            && (meshInRegion ? 1U : 0U) + node.children.size() == 1U
+        };
+        if (!flatten) {
+            stream.beginNode("Separator", streamDefName(m_streamedNodes, nodeIndex, node.name));
+            streamTransform(stream, node);
+        }
+
+        if (meshInRegion) {
+            streamInstances(stream, node);
+        }
+
+        for (const int childIndex : node.children) {
+            streamNode(stream, static_cast<size_t>(childIndex));
+        }
+
+        if (!flatten) {
+            stream.endNode();
+        }
+    }
+
+    static bool isZero(const std::vector<double> & values)
+    {
+        return std::all_of(values.cbegin(), values.cend(), [] (double value) { return value == 0.0; });
+    }
+
+    static bool isOne(const std::vector<double> & values)
+    {
+        return std::all_of(values.cbegin(), values.cend(), [] (double value) { return value == 1.0; });
+    }
+
+    static bool isIdentityRotation(const std::vector<double> & rotation)
+    {
+        return GltfIvCompactor::isIdentityRotation(rotation[0], rotation[1], rotation[2], rotation[3]);
+    }
+
+    static bool isIdentityTransform(const tinygltf::Node & node)
+    {
+        if (hasTransform(node)) {
+            return std::equal(node.matrix.cbegin(), node.matrix.cend(), identity_matrix.cbegin());
+        }
+        return (!hasTranslation(node) || isZero(node.translation))
+            && (!hasRotation(node) || isIdentityRotation(node.rotation))
+            && (!hasScale(node) || isOne(node.scale));
+    }
+
+    // gltf applies the scale first, then the rotation and the translation last. compacted, they
+    // are written as one transform without its identity parts.
+    void streamTransform(GltfIvStreamWriter & stream, const tinygltf::Node & node)
+    {
+        if (m_compact && isIdentityTransform(node)) {
+            return;
+        }
+        if (hasTransform(node)) {
+            std::array<float, 16> matrix;
+            std::transform(node.matrix.cbegin(), node.matrix.cend(), matrix.begin(), [] (double value) { return static_cast<float>(value); });
+            stream.beginNode("MatrixTransform");
+            stream.field("matrix", matrix);
+            stream.endNode();
+            return;
+        }
+
+        const bool translation{ hasTranslation(node) && !(m_compact && isZero(node.translation)) };
+        const bool rotation{ hasRotation(node) && !(m_compact && isIdentityRotation(node.rotation)) };
+        const bool scale{ hasScale(node) && !(m_compact && isOne(node.scale)) };
+        const bool merged{ m_compact && (translation ? 1 : 0) + (rotation ? 1 : 0) + (scale ? 1 : 0) > 1 };
+
+        if (merged) {
+            stream.beginNode("Transform");
+        }
+        if (translation) {
+            if (!merged) {
+                stream.beginNode("Translation");
+            }
+            stream.field("translation", std::array<float, 3>{ static_cast<float>(node.translation[0]), static_cast<float>(node.translation[1]), static_cast<float>(node.translation[2]) });
+            if (!merged) {
+                stream.endNode();
+            }
+        }
+        if (rotation) {
+            if (!merged) {
+                stream.beginNode("Rotation");
+            }
+            stream.field("rotation", axisAngle(node.rotation));
+            if (!merged) {
+                stream.endNode();
+            }
+        }
+        if (scale) {
+            if (!merged) {
+                stream.beginNode("Scale");
+            }
+            stream.field("scaleFactor", std::array<float, 3>{ static_cast<float>(node.scale[0]), static_cast<float>(node.scale[1]), static_cast<float>(node.scale[2]) });
+            if (!merged) {
+                stream.endNode();
+            }
+        }
+        if (merged) {
+            stream.endNode();
         }
     }
 
-    void convertTrianglesPrimitive(iv_root_t root, const tinygltf::Primitive & primitive)
+    // the ascii form of a rotation is an axis and an angle, gltf stores a quaternion x, y, z, w
+    static std::array<float, 4> axisAngle(const std::vector<double> & quaternion)
     {
-        spdlog::trace("converting gltf triangles primitive {}");
-
-        convertMaterial(root, primitive);
-        convertTriangles(root, primitive);
+        const double length{ std::sqrt(quaternion[0] * quaternion[0] + quaternion[1] * quaternion[1] + quaternion[2] * quaternion[2] + quaternion[3] * quaternion[3]) };
+        if (length == 0.0) {
+            return { 0.0f, 0.0f, 1.0f, 0.0f };
+        }
+        const double w{ std::clamp(quaternion[3] / length, -1.0, 1.0) };
+        const double sine{ std::sqrt(1.0 - w * w) };
+        if (sine < 1e-9) {
+            return { 0.0f, 0.0f, 1.0f, 0.0f };
+        }
+        return {
+            static_cast<float>(quaternion[0] / length / sine),
+            static_cast<float>(quaternion[1] / length / sine),
+            static_cast<float>(quaternion[2] / length / sine),
+            static_cast<float>(2.0 * std::acos(w))
+        };
     }
 
-    void convertMaterial(iv_root_t root, const tinygltf::Primitive & primitive)
+    void streamInstances(GltfIvStreamWriter & stream, const tinygltf::Node & node)
     {
-        if (hasMaterial(primitive)) {
-            convertMaterial(root, static_cast<size_t>(primitive.material));
+        const size_t meshIndex{ static_cast<size_t>(node.mesh) };
+        const std::optional<std::vector<matrix_t>> instances{ instanceMatrices(node) };
+        if (!instances.has_value()) {
+            streamMesh(stream, meshIndex);
+            return;
+        }
+        if (instances.value().empty()) {
+            return;
         }
-    }
 
-    static inline bool hasMaterial(const tinygltf::Primitive & primitive)
-    {
-        return primitive.material >= 0;
+        std::vector<std::array<float, 16>> matrices(instances.value().size());
+        for (size_t i = 0; i < matrices.size(); ++i) {
+            std::transform(instances.value()[i].cbegin(), instances.value()[i].cend(), matrices[i].begin(), [] (double value) { return static_cast<float>(value); });
+        }
+        stream.beginNode("MultipleCopy");
+        stream.field("matrix", std::span<const std::array<float, 16>>{ matrices });
+        streamMesh(stream, meshIndex);
+        stream.endNode();
     }
 
-    void convertMaterial(iv_root_t root, size_t materialIndex)
+    void streamMesh(GltfIvStreamWriter & stream, size_t meshIndex)
     {
-        spdlog::trace("converting gltf material with index {}", materialIndex);
-        if (m_materials.contains(materialIndex)) {
-            spdlog::debug("re-using already converted gltf material with index {}", materialIndex);
-            root->addChild(m_materials.at(materialIndex));
+        if (streamUse(stream, m_streamedMeshes, meshIndex)) {
+            spdlog::debug("re-using already streamed gltf mesh with index {}", meshIndex);
+            return;
         }
-        else {
-            const tinygltf::Material material{ m_gltfModel.materials.at(materialIndex) };
-
-            SoMaterial * materialNode = new SoMaterial;
 
-            addName(materialNode, material.name);
+        const tinygltf::Mesh & mesh{ m_gltfModel.meshes.at(meshIndex) };
+        stream.beginNode("Separator", streamDefName(m_streamedMeshes, meshIndex, mesh.name));
 
-            materialNode->diffuseColor = diffuseColor(material);
-            materialNode->transparency = transparency(material);
-            materialNode->emissiveColor = emissiveColor(material);
-            root->addChild(materialNode);
-            m_materials.insert(std::make_pair(materialIndex, materialNode));
+        const std::vector<std::optional<primitive_data_t>> preparedPrimitives{ takePreparedMesh(meshIndex) };
+        bool textured{ false };
+        streamed_bindings_t bindings;
+        for (size_t i = 0; i < mesh.primitives.size(); ++i) {
+            if (!isPrimitiveInRegion(meshIndex, i)) {
+                continue;
+            }
+            streamPrimitive(stream, mesh.primitives[i], preparedPrimitives.at(i), textured, bindings);
         }
 
-        SoMaterialBinding * materialBinding = new SoMaterialBinding;
-        materialBinding->value = SoMaterialBinding::Binding::OVERALL;
-        root->addChild(materialBinding);
+        stream.endNode();
     }
 
-    static void ensureColorVectorLength(const std::vector<double> & color, size_t expectedLength) {
+    // the bindings written last in a mesh, compacting leaves out bindings repeating them
+    struct streamed_bindings_t {
+        std::string_view material;
+        std::string_view normal;
+        std::string_view textureCoordinate;
+    };
 
-        if (color.size() != expectedLength) {
-            throw std::invalid_argument(
-                fmt::format(
-                    "color vector is of length {} as opposed to the expected length {}", 
-                    color.size(), 
-                    expectedLength
-                )
-            );
+    void streamBinding(GltfIvStreamWriter & stream, std::string_view type, std::string_view value, std::string_view & bound) const
+    {
+        if (m_compact && bound == value) {
+            return;
         }
+        stream.beginNode(type);
+        stream.field("value", value);
+        stream.endNode();
+        bound = value;
     }
 
-    static SbColor diffuseColor(const tinygltf::Material & material)
+    void streamPrimitive(GltfIvStreamWriter & stream, const tinygltf::Primitive & primitive, const std::optional<primitive_data_t> & data, bool & textured, streamed_bindings_t & bindings)
     {
-        spdlog::trace("extracting diffuse color from gltf material");
+        if (!data.has_value()) {
+            spdlog::warn("skipping primitive with unsupported mode {}", stringifyPrimitiveMode(primitive.mode));
+            return;
+        }
 
-        const std::vector<double> & baseColorFactor{ material.pbrMetallicRoughness.baseColorFactor };
+        if (hasMaterial(primitive)) {
+            streamMaterial(stream, static_cast<size_t>(primitive.material), bindings);
+        }
 
-        ensureColorVectorLength(baseColorFactor, 4U);
-        
-        spdlog::debug("extracting diffuse color ({:.4}, {:.4}, {:.4}) from gltf material", baseColorFactor[0], baseColorFactor[1], baseColorFactor[2]);
+        const bool hasTexture{ !data.value().texCoords.empty() && streamTexture(stream, primitive) };
+        if (textured && !hasTexture) {
+            stream.beginNode("Texture2");
+            stream.endNode();
+        }
+        textured = hasTexture;
 
-        return SbColor{
-            static_cast<float>(baseColorFactor[0]),
-            static_cast<float>(baseColorFactor[1]),
-            static_cast<float>(baseColorFactor[2])
-        };
+        streamPrimitiveData(stream, data.value(), bindings);
     }
 
-    static float transparency(const tinygltf::Material & material)
+    void streamMaterial(GltfIvStreamWriter & stream, size_t materialIndex, streamed_bindings_t & bindings)
     {
-        spdlog::trace("extracting transparency color from gltf material");
+        if (!streamUse(stream, m_streamedMaterials, materialIndex)) {
+            const tinygltf::Material & material{ m_gltfModel.materials.at(materialIndex) };
+            const SbColor diffuse{ diffuseColor(material) };
+            const SbColor emissive{ emissiveColor(material) };
+
+            stream.beginNode("Material", streamDefName(m_streamedMaterials, materialIndex, material.name));
+            stream.field("diffuseColor", std::array<float, 3>{ diffuse[0], diffuse[1], diffuse[2] });
+            stream.field("emissiveColor", std::array<float, 3>{ emissive[0], emissive[1], emissive[2] });
+            stream.field("transparency", transparency(material));
+            stream.endNode();
+        }
 
-        const std::vector<double> & baseColorFactor{ material.pbrMetallicRoughness.baseColorFactor };
+        streamBinding(stream, "MaterialBinding", "OVERALL", bindings.material);
+    }
 
-        ensureColorVectorLength(baseColorFactor, 4U);
+    bool streamTexture(GltfIvStreamWriter & stream, const tinygltf::Primitive & primitive)
+    {
+        const std::optional<size_t> textureIndex{ baseColorTexture(primitive) };
+        if (!textureIndex.has_value()) {
+            return false;
+        }
+        if (streamUse(stream, m_streamedTextures, textureIndex.value())) {
+            return true;
+        }
 
-        spdlog::debug("extracting transparency ({:.4}) from gltf material", baseColorFactor[3]);
+        const tinygltf::Image * image{ textureImage(textureIndex.value()) };
+        if (image == nullptr) {
+            return false;
+        }
 
-        return 1.0f - static_cast<float>(baseColorFactor[3]);
+        const tinygltf::Texture & texture{ m_gltfModel.textures[textureIndex.value()] };
+        stream.beginNode("Texture2", streamDefName(m_streamedTextures, textureIndex.value(), texture.name.empty() ? image->name : texture.name));
+        stream.imageField("image", image->width, image->height, image->component, image->image);
+        if (texture.sampler >= 0 && static_cast<size_t>(texture.sampler) < m_gltfModel.samplers.size()) {
+            const tinygltf::Sampler & sampler{ m_gltfModel.samplers[static_cast<size_t>(texture.sampler)] };
+            stream.field("wrapS", textureWrap(sampler.wrapS) == SoTexture2::CLAMP ? "CLAMP" : "REPEAT");
+            stream.field("wrapT", textureWrap(sampler.wrapT) == SoTexture2::CLAMP ? "CLAMP" : "REPEAT");
+        }
+        stream.endNode();
+        return true;
     }
 
-    static SbColor emissiveColor(const tinygltf::Material & material)
+    void streamPrimitiveData(GltfIvStreamWriter & stream, const primitive_data_t & data, streamed_bindings_t & bindings) const
     {
-        spdlog::trace("extracting emissive color from gltf material");
+        const std::string_view binding{ data.shape == primitive_shape_t::POINTS ? "PER_VERTEX" : "PER_VERTEX_INDEXED" };
 
-        const std::vector<double> & emissiveFactor{ material.emissiveFactor };
-
-        ensureColorVectorLength(emissiveFactor, 3U);
+        stream.beginNode("Coordinate3");
+        stream.field("point", std::span<const position_t>{ data.positions });
+        stream.endNode();
 
-        spdlog::debug("extracting emissive color ({:.4}, {:.4}, {:.4}) from gltf material", emissiveFactor[0], emissiveFactor[1], emissiveFactor[2]);
+        if (!data.normals.empty()) {
+            streamBinding(stream, "NormalBinding", binding, bindings.normal);
+        }
+        stream.beginNode("Normal");
+        stream.field("vector", std::span<const normal_t>{ data.normals });
+        stream.endNode();
+
+        if (!data.texCoords.empty()) {
+            streamBinding(stream, "TextureCoordinateBinding", binding, bindings.textureCoordinate);
+            stream.beginNode("TextureCoordinate2");
+            stream.field("point", std::span<const texcoord_t>{ data.texCoords });
+            stream.endNode();
+        }
 
-        return SbColor{
-            static_cast<float>(emissiveFactor[0]),
-            static_cast<float>(emissiveFactor[1]),
-            static_cast<float>(emissiveFactor[2])
-        };
-    }
+        if (data.shape == primitive_shape_t::POINTS) {
+            stream.beginNode("PointSet");
+            stream.field("numPoints", static_cast<int32_t>(data.positions.size()));
+            stream.endNode();
+            return;
+        }
 
-    void convertTriangles(iv_root_t root, const tinygltf::Primitive & primitive) const
-    {
-        if (hasIndices(primitive)) {
-            const gltf_indices_t indices{ this->indices(primitive) };
-            convertTriangles(root, convertPositions(root, indices, primitive), convertNormals(root, indices, primitive));
+        stream.beginNode(data.shape == primitive_shape_t::LINES ? "IndexedLineSet" : "IndexedTriangleStripSet");
+        stream.field("coordIndex", std::span<const iv_index_t>{ data.coordIndex });
+        if (!data.normalIndex.empty()) {
+            stream.field("normalIndex", std::span<const iv_index_t>{ data.normalIndex });
         }
-        else {
-            convertTriangles(root, convertPositions(root, primitive), convertNormals(root, primitive));
+        if (!data.textureCoordIndex.empty()) {
+            stream.field("textureCoordIndex", std::span<const iv_index_t>{ data.textureCoordIndex });
         }
+        stream.field("materialIndex", 0);
+        stream.endNode();
     }
 
     static inline bool hasIndices(const tinygltf::Primitive & primitive)
@@ -460,76 +2194,46 @@ private:
         return primitive.indices >= 0;
     }
 
-    static void convertTriangles(iv_root_t root, const iv_indices_t & positionIndices, const iv_indices_t & normalIndices)
+    static void convertTriangles(iv_root_t root, const primitive_data_t & data)
     {
-        if (positionIndices.size() != normalIndices.size()) {
-            throw std::invalid_argument(fmt::format("mismatching number of positions ({}) and normals ({})", positionIndices.size(), normalIndices.size()));
-        }
-
-        constexpr size_t triangle_strip_size{ 3U };
-
-        if (positionIndices.size() % triangle_strip_size != 0) {
-            throw std::invalid_argument(fmt::format("number of positions ({}) is not divisible by the triangle size ({})", positionIndices.size(), triangle_strip_size));
-        }
-
-        spdlog::trace("converting {} triangles from gltf primitive", positionIndices.size() / triangle_strip_size);
+        spdlog::trace("converting {} strip indices from gltf primitive", data.coordIndex.size());
 
         SoIndexedTriangleStripSet * triangles = new SoIndexedTriangleStripSet;
 
-        const int indexSize{ static_cast<int>(positionIndices.size() + positionIndices.size() / triangle_strip_size) };
-
-        SoMFInt32 coordIndex{};
-        SoMFInt32 normalIndex{};
-
-        coordIndex.setNum(indexSize);
-        normalIndex.setNum(indexSize);
-
-        iv_index_t * coordIndexPosition = coordIndex.startEditing();
-        iv_index_t * normalIndexPosition = normalIndex.startEditing();
-
-        for (size_t i = 0; i + triangle_strip_size - 1 < positionIndices.size(); i += triangle_strip_size) {
-
-            std::memcpy(coordIndexPosition, &positionIndices[i], sizeof(iv_index_t) * triangle_strip_size);
-            std::memcpy(normalIndexPosition, &normalIndices[i], sizeof(iv_index_t) * triangle_strip_size);
-
-            std::advance(coordIndexPosition, triangle_strip_size);
-            std::advance(normalIndexPosition, triangle_strip_size);
-
-            *coordIndexPosition++ = -1;
-            *normalIndexPosition++ = -1;
-        }
-        coordIndex.finishEditing();
-        normalIndex.finishEditing();
-
         triangles->materialIndex = 0;
-        triangles->coordIndex = coordIndex;
-        triangles->normalIndex = normalIndex;
+        convertIndices(triangles, data);
 
         root->addChild(triangles);
     }
 
-    iv_indices_t convertPositions(iv_root_t root, const gltf_indices_t & indices, const tinygltf::Primitive & primitive) const
+    static void convertLines(iv_root_t root, const primitive_data_t & data)
     {
-        spdlog::trace("converting gltf positions from gltf primitive");
+        spdlog::trace("converting {} polyline indices from gltf primitive", data.coordIndex.size());
+
+        SoIndexedLineSet * lines = new SoIndexedLineSet;
 
-        const positions_t positions{ GltfIvWriter::positions(primitive) };
-        const positions_t uniquePositions{ unique<position_t>(positions) };
+        lines->materialIndex = 0;
+        convertIndices(lines, data);
 
-        convertPositions(root, uniquePositions);
+        root->addChild(lines);
+    }
 
-        return positionIndices(indices, positions, positionMap(uniquePositions));
+    static void convertIndices(gsl::not_null<SoIndexedShape *> shape, const primitive_data_t & data)
+    {
+        shape->coordIndex.setValues(0, static_cast<int>(data.coordIndex.size()), data.coordIndex.data());
+        shape->normalIndex.setValues(0, static_cast<int>(data.normalIndex.size()), data.normalIndex.data());
+        shape->textureCoordIndex.setValues(0, static_cast<int>(data.textureCoordIndex.size()), data.textureCoordIndex.data());
     }
 
-    iv_indices_t convertPositions(iv_root_t root, const tinygltf::Primitive & primitive) const
+    static void convertPoints(iv_root_t root, size_t pointCount)
     {
-        spdlog::trace("converting gltf positions from gltf primitive");
+        spdlog::trace("converting {} points from gltf primitive", pointCount);
 
-        const positions_t positions{ GltfIvWriter::positions(primitive) };
-        const positions_t uniquePositions{ unique<position_t>(positions) };
+        SoPointSet * points = new SoPointSet;
 
-        convertPositions(root, uniquePositions);
+        points->numPoints = static_cast<int32_t>(pointCount);
 
-        return positionIndices(positions, positionMap(uniquePositions));
+        root->addChild(points);
     }
 
     static void convertPositions(iv_root_t root, const positions_t & positions)
@@ -549,40 +2253,6 @@ private:
         root->addChild(coords);
     }
 
-    iv_indices_t convertNormals(iv_root_t root, const gltf_indices_t & indices, const tinygltf::Primitive & primitive) const
-    {
-        spdlog::trace("converting gltf normals from gltf primitive");
-
-        SoNormalBinding * normalBinding = new SoNormalBinding;
-        normalBinding->value = SoNormalBinding::Binding::PER_VERTEX_INDEXED;
-        root->addChild(normalBinding);
-
-        const normals_t normals{ GltfIvWriter::normals(primitive) };
-
-        const normals_t uniqueNormals{ unique(normals) };
-
-        convertNormals(root, uniqueNormals);
-
-        return normalIndices(indices, normals, normalMap(uniqueNormals));
-    }
-
-    iv_indices_t convertNormals(iv_root_t root, const tinygltf::Primitive & primitive) const
-    {
-        spdlog::trace("converting gltf normals from gltf primitive");
-
-        SoNormalBinding * normalBinding = new SoNormalBinding;
-        normalBinding->value = SoNormalBinding::Binding::PER_VERTEX_INDEXED;
-        root->addChild(normalBinding);
-
-        const normals_t normals{ GltfIvWriter::normals(primitive) };
-
-        const normals_t uniqueNormals{ unique(normals) };
-
-        convertNormals(root, uniqueNormals);
-
-        return normalIndices(normals, normalMap(uniqueNormals));
-    }
-
     static void convertNormals(iv_root_t root, const normals_t & normals)
     {
         spdlog::trace("converting {} gltf normals", normals.size());
@@ -600,119 +2270,39 @@ private:
         root->addChild(normalNode);
     }
 
-    static normal_map_t normalMap(const normals_t & normals)
+    static void convertTextureCoordinates(iv_root_t root, const texcoords_t & texCoords)
     {
-        spdlog::trace("create index map for {} normals", normals.size());
+        spdlog::trace("converting {} gltf texture coordinates", texCoords.size());
 
-        normal_map_t result;
-
-        for (size_t index = 0; index < normals.size(); ++index) {
-            result[normals[index]] = static_cast<iv_index_t>(index);
+        SoTextureCoordinate2 * textureCoordinates = new SoTextureCoordinate2;
+        textureCoordinates->point.setNum(static_cast<int>(texCoords.size()));
+        SbVec2f * ivPointsPtr = textureCoordinates->point.startEditing();
+        for (const texcoord_t & texCoord : texCoords) {
+            *ivPointsPtr++ = SbVec2f(texCoord[0], texCoord[1]);
         }
+        textureCoordinates->point.finishEditing();
 
-        return result;
-    }
-
-    static iv_indices_t normalIndices(const gltf_indices_t & indices, const normals_t & normals, const normal_map_t & normalMap)
-    {
-        spdlog::trace("create index for {} indexed normals", indices.size());
-
-        iv_indices_t normalIndices;
-        normalIndices.reserve(indices.size());
-
-        std::transform(
-            indices.cbegin(),
-            indices.cend(),
-            std::back_inserter(normalIndices),
-            [&normals, &normalMap] (const gltf_index_t & index)
-            {
-                return normalMap.at(normals.at(index));
-            }
-        );
-
-        return normalIndices;
-    }
-
-    static iv_indices_t normalIndices(const normals_t & normals, const normal_map_t & normalMap)
-    {
-        spdlog::trace("create index for {} normals", normals.size());
-
-        iv_indices_t normalIndices;
-        normalIndices.reserve(normals.size());
-
-        std::transform(
-            normals.cbegin(),
-            normals.cend(),
-            std::back_inserter(normalIndices),
-            [&normalMap] (const normal_t & normal)
-            {
-                return normalMap.at(normal);
-            }
-        );
-
-        return normalIndices;
+        root->addChild(textureCoordinates);
     }
 
-    static iv_indices_t positionIndices(const gltf_indices_t & indices, const positions_t & positions, const position_map_t & positionMap)
+    static iv_indices_t remapIndices(const gltf_indices_t & indices, const iv_indices_t & remap)
     {
-        spdlog::trace("create index for {} indexed positions", indices.size());
-
-        iv_indices_t positionIndices;
-        positionIndices.reserve(indices.size());
-
-        std::transform(
-            indices.cbegin(),
-            indices.cend(),
-            std::back_inserter(positionIndices),
-            [&positions, &positionMap] (const gltf_index_t & index)
+        return std::visit(
+            [&remap] (const auto & indexView)
             {
-                return positionMap.at(positions.at(index));
-            }
-        );
-
-        return positionIndices;
-    }
+                spdlog::trace("remap {} indices to unique items", indexView.size());
 
-    static iv_indices_t positionIndices(const positions_t & positions, const position_map_t & positionMap)
-    {
-        spdlog::trace("create index for {} positions", positions.size());
+                iv_indices_t remappedIndices;
+                remappedIndices.reserve(indexView.size());
 
-        iv_indices_t positionIndices;
-        positionIndices.reserve(positions.size());
+                for (size_t i = 0; i < indexView.size(); ++i) {
+                    remappedIndices.push_back(remap.at(indexView[i]));
+                }
 
-        std::transform(
-            positions.cbegin(),
-            positions.cend(),
-            std::back_inserter(positionIndices),
-            [&positionMap] (const position_t & position)
-            {
-                return positionMap.at(position);
-            }
+                return remappedIndices;
+            },
+            indices
         );
-
-        return positionIndices;
-    }
-
-    static position_map_t positionMap(const positions_t & positions)
-    {
-        spdlog::trace("create index map for {} positions", positions.size());
-
-        position_map_t positionMap;
-
-        for (size_t i = 0; i < positions.size(); ++i) {
-            positionMap[positions[i]] = static_cast<iv_index_t>(i);
-        }
-
-        return positionMap;
-    }
-
-    template<class U, class T>
-    static std::vector<U> cast(const std::vector<T> & source)
-    {
-        std::vector<U> target;
-        target.reserve(source.size());
-        std::copy(source.cbegin(), source.cend(), std::back_inserter(target));
-        return target;
     }
 
     gltf_indices_t indices(const tinygltf::Primitive & primitive) const
@@ -725,9 +2315,9 @@ private:
             spdlog::debug("retrieving index of type {} with compoment type {}", stringifyAccessorType(accessor.type), stringifyAccessorComponentType(accessor.componentType));
 
             switch (accessor.componentType) {
-            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: return cast<gltf_index_t, uint8_t>(accessorContents<uint8_t>(accessor));
-            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: return cast<gltf_index_t, uint16_t>(accessorContents<uint16_t>(accessor));
-            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: return cast<gltf_index_t, uint32_t>(accessorContents<uint32_t>(accessor));
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: return accessorView<uint8_t>(accessor);
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: return accessorView<uint16_t>(accessor);
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: return accessorView<uint32_t>(accessor);
             default: throw std::invalid_argument(fmt::format("component type {} is unsupported for indices", stringifyAccessorComponentType(accessor.componentType)));
             }
         }
@@ -737,15 +2327,14 @@ private:
         }
     }
 
-    positions_t positions(const tinygltf::Primitive & primitive) const
+    positions_view_t positions(const tinygltf::Primitive & primitive) const
     {
         spdlog::trace("retrieve positions from primitive");
         const int accessorIndex{ primitive.attributes.at("POSITION") };
         if (accessorIndex >= 0) {
             const tinygltf::Accessor & accessor = m_gltfModel.accessors.at(static_cast<size_t>(accessorIndex));
             ensureAccessorType(accessor, TINYGLTF_TYPE_VEC3);
-            ensureAccessorComponentType(accessor, TINYGLTF_COMPONENT_TYPE_FLOAT);
-            return accessorContents<position_t>(accessor);
+            return floatAccessorView<position_t>(accessor);
         }
         else {
             spdlog::warn("positions accessor at index {} not found", accessorIndex);
@@ -754,15 +2343,19 @@ private:
 
     }
 
-    normals_t normals(const tinygltf::Primitive & primitive) const
+    normals_view_t normals(const tinygltf::Primitive & primitive) const
     {
         spdlog::trace("retrieve normals from primitive");
-        const int accessorIndex{ primitive.attributes.at("NORMAL") };
+        const auto attribute{ primitive.attributes.find("NORMAL") };
+        if (attribute == primitive.attributes.cend()) {
+            spdlog::debug("gltf primitive has no normals");
+            return {};
+        }
+        const int accessorIndex{ attribute->second };
         if (accessorIndex >= 0) {
             const tinygltf::Accessor & accessor = m_gltfModel.accessors.at(static_cast<size_t>(accessorIndex));
             ensureAccessorType(accessor, TINYGLTF_TYPE_VEC3);
-            ensureAccessorComponentType(accessor, TINYGLTF_COMPONENT_TYPE_FLOAT);
-            return accessorContents<normal_t>(accessor);
+            return floatAccessorView<normal_t>(accessor);
         }
         else {
             spdlog::warn("normals accessor at index {} not found", accessorIndex);
@@ -770,6 +2363,25 @@ private:
         }
     }
 
+    // the texture coordinates are only read for primitives with a base color texture, from the
+    // set the texture refers to
+    texcoords_view_t texCoords(const tinygltf::Primitive & primitive) const
+    {
+        spdlog::trace("retrieve texture coordinates from primitive");
+        if (!baseColorTexture(primitive).has_value()) {
+            return {};
+        }
+        const int texCoordSet{ m_gltfModel.materials[static_cast<size_t>(primitive.material)].pbrMetallicRoughness.baseColorTexture.texCoord };
+        const auto attribute{ primitive.attributes.find(fmt::format("TEXCOORD_{}", texCoordSet)) };
+        if (attribute == primitive.attributes.cend() || attribute->second < 0) {
+            spdlog::warn("gltf primitive has a texture but no texture coordinates TEXCOORD_{}", texCoordSet);
+            return {};
+        }
+        const tinygltf::Accessor & accessor = m_gltfModel.accessors.at(static_cast<size_t>(attribute->second));
+        ensureAccessorType(accessor, TINYGLTF_TYPE_VEC2);
+        return floatAccessorView<texcoord_t>(accessor);
+    }
+
     static std::string stringifyAccessorType(int accessorType)
     {
         switch (accessorType) {
@@ -816,68 +2428,202 @@ private:
         }
     }
 
-    static void ensureAccessorComponentType(const tinygltf::Accessor & accessor, int accessorComponentType)
-    {
-        spdlog::trace("ensure gltf accessor component type is {}", stringifyAccessorComponentType(accessorComponentType));
-
-        if (accessor.componentType != accessorComponentType) {
-            throw std::domain_error(
-                fmt::format(
-                    "expected accessor component type {} instead of {}",
-                    stringifyAccessorComponentType(accessorComponentType),
-                    stringifyAccessorComponentType(accessor.componentType)
-                )
-            );
-        }
-    }
-
     template<class T>
-    static void ensureByteStrideMatchesType(const tinygltf::Accessor & accessor, const tinygltf::BufferView & bufferView)
+    static size_t byteStride(const tinygltf::Accessor & accessor, const tinygltf::BufferView & bufferView)
     {
         const int byteStride{ accessor.ByteStride(bufferView) };
-        if (byteStride != sizeof(T)) {
+        if (byteStride < static_cast<int>(sizeof(T))) {
             throw std::invalid_argument(
                 fmt::format(
-                    "mismatching size of the buffer's byte stride ({}) and the size of the target type ({})",
+                    "the buffer's byte stride ({}) is smaller than the size of the target type ({})",
                     byteStride,
                     sizeof(T)
                 )
             );
         }
+        return static_cast<size_t>(byteStride);
     }
 
-    static void ensureByteOffsetWithinBuffer(size_t byteOffset, const tinygltf::Buffer & buffer)
+    static void ensureByteOffsetWithinBuffer(size_t byteOffset, std::span<const unsigned char> buffer)
     {
-        if (byteOffset >= buffer.data.size()) {
+        if (byteOffset >= buffer.size()) {
             throw std::out_of_range(
                 fmt::format(
                     "byte offset {} is outside of the range of a buffer with size {}",
                     byteOffset,
-                    buffer.data.size()
+                    buffer.size()
                 )
             );
         }
     }
 
-    static void ensureByteOffsetPlusBytesToCopyWithinBuffer(size_t byteOffset, size_t bytesToCopy, const tinygltf::Buffer & buffer)
+    static void ensureByteOffsetPlusBytesToCopyWithinBuffer(size_t byteOffset, size_t bytesToCopy, std::span<const unsigned char> buffer)
     {
-        if (bytesToCopy > buffer.data.size() || byteOffset > buffer.data.size() - bytesToCopy) {
+        if (bytesToCopy > buffer.size() || byteOffset > buffer.size() - bytesToCopy) {
             throw std::out_of_range(
                 fmt::format(
                     "byte offset ({}) plus the number of bytes to copy ({}) is beyond the length of the buffer ({})",
                     byteOffset,
                     bytesToCopy,
-                    buffer.data.size()
+                    buffer.size()
                 )
             );
         }
     }
 
+    // bytes of a buffer view, the first buffer of a mapped glb is read straight from the file
+    std::span<const unsigned char> bufferViewBytes(int bufferViewIndex, size_t byteOffset, size_t byteCount) const
+    {
+        if (bufferViewIndex < 0 || static_cast<size_t>(bufferViewIndex) >= m_gltfModel.bufferViews.size()) {
+            throw std::out_of_range(fmt::format("buffer view {} not found", bufferViewIndex));
+        }
+        const tinygltf::BufferView & bufferView = m_gltfModel.bufferViews[static_cast<size_t>(bufferViewIndex)];
+        if (bufferView.buffer < 0) {
+            throw std::out_of_range(fmt::format("buffer {} of buffer view {} not found", bufferView.buffer, bufferViewIndex));
+        }
+        const std::span<const unsigned char> buffer{ m_gltfModel.bufferData(static_cast<size_t>(bufferView.buffer)) };
+
+        const size_t offset{ bufferView.byteOffset + byteOffset };
+        ensureByteOffsetWithinBuffer(offset, buffer);
+        ensureByteOffsetPlusBytesToCopyWithinBuffer(offset, byteCount, buffer);
+        return buffer.subspan(offset, byteCount);
+    }
+
+    template<class I>
+    static void appendSparseIndices(std::span<const unsigned char> bytes, size_t count, std::vector<uint32_t> & sparseIndices)
+    {
+        const accessor_view_t<I> view{ bytes.data(), count, sizeof(I) };
+        for (size_t i = 0; i < view.size(); ++i) {
+            sparseIndices.push_back(view[i]);
+        }
+    }
+
+    // the sparse indices of an accessor, which glTF requires to be strictly increasing
+    std::shared_ptr<const std::vector<uint32_t>> sparseIndices(const tinygltf::Accessor & accessor) const
+    {
+        const size_t count{ static_cast<size_t>(accessor.sparse.count) };
+        const int componentType{ accessor.sparse.indices.componentType };
+        const size_t componentSize{
+            componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE ? sizeof(uint8_t) :
+            componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT ? sizeof(uint16_t) :
+            componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT ? sizeof(uint32_t) : 0U
+        };
+        if (componentSize == 0U) {
+            throw std::invalid_argument(fmt::format("component type {} is unsupported for sparse indices", stringifyAccessorComponentType(componentType)));
+        }
+        const std::span<const unsigned char> bytes{
+            bufferViewBytes(accessor.sparse.indices.bufferView, static_cast<size_t>(accessor.sparse.indices.byteOffset), count * componentSize)
+        };
+
+        auto indices{ std::make_shared<std::vector<uint32_t>>() };
+        indices->reserve(count);
+        switch (componentType) {
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: appendSparseIndices<uint8_t>(bytes, count, *indices); break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: appendSparseIndices<uint16_t>(bytes, count, *indices); break;
+        default: appendSparseIndices<uint32_t>(bytes, count, *indices); break;
+        }
+
+        for (size_t i = 0; i < indices->size(); ++i) {
+            if ((*indices)[i] >= accessor.count || (i > 0 && (*indices)[i] <= (*indices)[i - 1U])) {
+                throw std::invalid_argument(
+                    fmt::format("sparse index {} at position {} is out of order or beyond the {} elements of the accessor", (*indices)[i], i, accessor.count)
+                );
+            }
+        }
+        return indices;
+    }
+
+    template<class T>
+    accessor_view_t<T> accessorView(const tinygltf::Accessor & accessor) const
+    {
+        spdlog::trace("view contents of gltf accessor with name '{}'", accessor.name);
+
+        if (!accessor.sparse.isSparse || accessor.sparse.count <= 0) {
+            return denseAccessorView<T>(accessor);
+        }
+
+        spdlog::debug("accessor '{}' replaces {} of its {} elements sparsely", accessor.name, accessor.sparse.count, accessor.count);
+        // a sparse accessor without a buffer view replaces elements of zeros
+        accessor_view_t<T> view{
+            accessor.bufferView < 0 ? accessor_view_t<T>{ nullptr, accessor.count, sizeof(T) } : denseAccessorView<T>(accessor)
+        };
+        const std::span<const unsigned char> values{
+            bufferViewBytes(accessor.sparse.values.bufferView, static_cast<size_t>(accessor.sparse.values.byteOffset), static_cast<size_t>(accessor.sparse.count) * sizeof(T))
+        };
+        view.setSparse(sparseIndices(accessor), values.data());
+        return view;
+    }
+
+    // float attributes are viewed in place, quantized ones are converted to float once
     template<class T>
-    std::vector<T> accessorContents(const tinygltf::Accessor & accessor) const
+    accessor_view_t<T> floatAccessorView(const tinygltf::Accessor & accessor) const
+    {
+        switch (accessor.componentType) {
+        case TINYGLTF_COMPONENT_TYPE_FLOAT: return accessorView<T>(accessor);
+        case TINYGLTF_COMPONENT_TYPE_BYTE: return dequantizedAccessorView<T, int8_t>(accessor);
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: return dequantizedAccessorView<T, uint8_t>(accessor);
+        case TINYGLTF_COMPONENT_TYPE_SHORT: return dequantizedAccessorView<T, int16_t>(accessor);
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: return dequantizedAccessorView<T, uint16_t>(accessor);
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: return dequantizedAccessorView<T, uint32_t>(accessor);
+        default: throw std::invalid_argument(fmt::format("component type {} is unsupported for vertex attributes", stringifyAccessorComponentType(accessor.componentType)));
+        }
+    }
+
+    template<class T, class C>
+    static void dequantize(bool normalized, const unsigned char * data, size_t count, size_t byteStride, T * items)
+    {
+        static_assert(sizeof(T) == std::tuple_size_v<T> * sizeof(float));
+        float * out{ reinterpret_cast<float *>(items) };
+        if (normalized) {
+            GltfIvDequantizer::dequantize<C, std::tuple_size_v<T>, true>(data, count, byteStride, out);
+        }
+        else {
+            GltfIvDequantizer::dequantize<C, std::tuple_size_v<T>, false>(data, count, byteStride, out);
+        }
+    }
+
+    // quantized elements, sparse ones included, are converted into a list owned by the view
+    template<class T, class C>
+    accessor_view_t<T> dequantizedAccessorView(const tinygltf::Accessor & accessor) const
     {
-        spdlog::trace("read contents of gltf accessor with name '{}'", accessor.name);
+        constexpr size_t elementSize{ std::tuple_size_v<T> * sizeof(C) };
+        spdlog::debug("dequantize {} elements of accessor '{}' with component type {}", accessor.count, accessor.name, stringifyAccessorComponentType(accessor.componentType));
+
+        if (accessor.count == 0) {
+            return {};
+        }
+        auto items{ std::make_shared<std::vector<T>>(accessor.count) };
+
+        if (accessor.bufferView >= 0) {
+            const tinygltf::BufferView & bufferView = m_gltfModel.bufferViews.at(static_cast<size_t>(accessor.bufferView));
+            const size_t byteStride{ bufferView.byteStride > 0 ? static_cast<size_t>(bufferView.byteStride) : elementSize };
+            if (byteStride < elementSize) {
+                throw std::invalid_argument(fmt::format("the buffer's byte stride ({}) is smaller than the size of an element ({})", byteStride, elementSize));
+            }
+            const std::span<const unsigned char> bytes{
+                bufferViewBytes(accessor.bufferView, static_cast<size_t>(accessor.byteOffset), (accessor.count - 1U) * byteStride + elementSize)
+            };
+            dequantize<T, C>(accessor.normalized, bytes.data(), accessor.count, byteStride, items->data());
+        }
+
+        if (accessor.sparse.isSparse && accessor.sparse.count > 0) {
+            const std::shared_ptr<const std::vector<uint32_t>> indices{ sparseIndices(accessor) };
+            const std::span<const unsigned char> values{
+                bufferViewBytes(accessor.sparse.values.bufferView, static_cast<size_t>(accessor.sparse.values.byteOffset), indices->size() * elementSize)
+            };
+            std::vector<T> sparseItems(indices->size());
+            dequantize<T, C>(accessor.normalized, values.data(), sparseItems.size(), elementSize, sparseItems.data());
+            for (size_t i = 0; i < indices->size(); ++i) {
+                (*items)[(*indices)[i]] = sparseItems[i];
+            }
+        }
+
+        return accessor_view_t<T>{ std::move(items) };
+    }
 
+    template<class T>
+    accessor_view_t<T> denseAccessorView(const tinygltf::Accessor & accessor) const
+    {
         const int bufferViewIndex{ accessor.bufferView };
         if (bufferViewIndex < 0) {
             spdlog::warn("accessor buffer view not found at index {}", bufferViewIndex);
@@ -885,7 +2631,7 @@ private:
         }
         const tinygltf::BufferView & bufferView = m_gltfModel.bufferViews.at(static_cast<size_t>(bufferViewIndex));
 
-        ensureByteStrideMatchesType<T>(accessor, bufferView);
+        const size_t byteStride{ GltfIvWriter::byteStride<T>(accessor, bufferView) };
 
         const int bufferIndex{ bufferView.buffer };
         if (bufferIndex < 0) {
@@ -893,34 +2639,100 @@ private:
             return {};
         }
 
-        const tinygltf::Buffer & buffer = m_gltfModel.buffers.at(static_cast<size_t>(bufferIndex));
+        // the first buffer of a mapped glb is read straight from the file
+        const std::span<const unsigned char> buffer{ m_gltfModel.bufferData(static_cast<size_t>(bufferIndex)) };
+
+        if (accessor.count == 0) {
+            return {};
+        }
 
         const size_t byteOffset{ bufferView.byteOffset + accessor.byteOffset };
-        const size_t bytesToCopy{ accessor.count * sizeof(T) };
+        const size_t bytesToRead{ (accessor.count - 1U) * byteStride + sizeof(T) };
 
         ensureByteOffsetWithinBuffer(byteOffset, buffer);
-        ensureByteOffsetPlusBytesToCopyWithinBuffer(byteOffset, bytesToCopy, buffer);
+        ensureByteOffsetPlusBytesToCopyWithinBuffer(byteOffset, bytesToRead, buffer);
 
-        std::vector<T> contents;
-        contents.resize(accessor.count);
+        return accessor_view_t<T>{ buffer.data() + byteOffset, accessor.count, byteStride };
+    }
 
-        std::memcpy(&contents[0], &buffer.data[byteOffset], bytesToCopy);
+    template<class T>
+    static std::array<uint32_t, std::tuple_size_v<T>> canonicalBits(const T & item)
+    {
+        std::array<uint32_t, std::tuple_size_v<T>> bits{};
+        for (size_t i = 0; i < bits.size(); ++i) {
+            // -0 and 0 are the same vertex
+            bits[i] = std::bit_cast<uint32_t>(item[i] == 0.0f ? 0.0f : item[i]);
+        }
+        return bits;
+    }
 
-        return contents;
+    template<size_t N>
+    static size_t hashBits(const std::array<uint32_t, N> & bits)
+    {
+        uint64_t hash{ 0xcbf29ce484222325ULL };
+        for (uint32_t word : bits) {
+            hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+        }
+        return static_cast<size_t>(hash ^ (hash >> 32));
     }
 
+    // single pass over an open addressing table with linear probing that yields the unique
+    // items in order of their first occurrence and the index of every item among them. the
+    // table is allocated once with a power of two size of at least twice the item count.
     template<class T>
-    static std::vector<T> unique(const std::vector<T> & items) {
+    static unique_items_t<T> unique(const accessor_view_t<T> & items)
+    {
+        static_assert(std::is_same_v<typename T::value_type, float>);
         spdlog::trace("remove duplicates among {} items", items.size());
-        std::vector<T> unqiueItems{ items };
-        std::sort(unqiueItems.begin(), unqiueItems.end());
-        unqiueItems.erase(std::unique(unqiueItems.begin(), unqiueItems.end()), unqiueItems.end());
-        return unqiueItems;
 
+        unique_items_t<T> result;
+        result.indices.reserve(items.size());
+
+        size_t tableSize{ 16U };
+        while (tableSize < items.size() * 2U) {
+            tableSize *= 2U;
+        }
+        const size_t mask{ tableSize - 1U };
+        std::vector<iv_index_t> table(tableSize, -1);
+
+        for (size_t i = 0; i < items.size(); ++i) {
+            const T item{ items[i] };
+            const auto bits{ canonicalBits(item) };
+            size_t slot{ hashBits(bits) & mask };
+            while (table[slot] >= 0 && canonicalBits(result.items[static_cast<size_t>(table[slot])]) != bits) {
+                slot = (slot + 1U) & mask;
+            }
+            if (table[slot] < 0) {
+                table[slot] = static_cast<iv_index_t>(result.items.size());
+                result.items.push_back(item);
+            }
+            result.indices.push_back(table[slot]);
+        }
+
+        spdlog::debug("found {} unique items among {} items", result.items.size(), items.size());
+        return result;
     }
 
-    const tinygltf::Model m_gltfModel;
+    GltfIvModel m_gltfModel;
     std::unordered_map<size_t, iv_root_t> m_nodes;
     std::unordered_map<size_t, iv_root_t> m_meshes;
     std::unordered_map<size_t, iv_material_t> m_materials;
+    std::unordered_map<size_t, iv_texture_t> m_textures;
+    std::vector<prepared_mesh_t> m_preparedMeshes;
+    unsigned m_threadCount{ 0U };
+    std::optional<size_t> m_sceneIndex;
+    std::vector<std::string> m_nodePatterns;
+    std::unordered_map<size_t, matrix_t> m_selectedParentMatrices;
+    std::optional<box_t> m_region;
+    std::vector<bool> m_regionNodes;
+    std::vector<bool> m_regionNodeMeshes;
+    std::vector<std::vector<bool>> m_regionPrimitives;
+    bool m_directOutput{ true };
+    bool m_compact{ true };
+    int m_precision{ 0 };
+    streamed_objects_t m_streamedNodes;
+    streamed_objects_t m_streamedMeshes;
+    streamed_objects_t m_streamedMaterials;
+    streamed_objects_t m_streamedTextures;
+    size_t m_defCount{ 0U };
 };
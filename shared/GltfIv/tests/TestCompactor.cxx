@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoGroup.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoTransform.h>
+#include <Inventor/nodes/SoTranslation.h>
+#include <Inventor/nodes/SoRotation.h>
+#include <Inventor/nodes/SoScale.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
+#include "GltfIvCompactor.h"
+
+static void expectVec3f(const SbVec3f& actual, float x, float y, float z)
+{
+    EXPECT_FLOAT_EQ(actual[0], x);
+    EXPECT_FLOAT_EQ(actual[1], y);
+    EXPECT_FLOAT_EQ(actual[2], z);
+}
+
+TEST(GltfIvCompactor, MergeTransformations)
+{
+    SoSeparator* root = new SoSeparator;
+    root->ref();
+    SoTranslation* translation = new SoTranslation;
+    translation->translation = SbVec3f(1, 2, 3);
+    SoRotation* rotation = new SoRotation;
+    rotation->rotation = SbRotation(0, 0.6f, 0, 0.8f);
+    SoScale* scale = new SoScale;
+    scale->scaleFactor = SbVec3f(2, 2, 2);
+    root->addChild(translation);
+    root->addChild(rotation);
+    root->addChild(scale);
+    root->addChild(new SoCube);
+
+    EXPECT_EQ(GltfIvCompactor::compact(root), 2u);
+    ASSERT_EQ(root->getNumChildren(), 2);
+    ASSERT_EQ(root->getChild(0)->getTypeId(), SoTransform::getClassTypeId());
+    const SoTransform* transform = static_cast<const SoTransform*>(root->getChild(0));
+    expectVec3f(transform->translation.getValue(), 1, 2, 3);
+    const float* quaternion = transform->rotation.getValue().getValue();
+    EXPECT_FLOAT_EQ(quaternion[1], 0.6f);
+    EXPECT_FLOAT_EQ(quaternion[3], 0.8f);
+    expectVec3f(transform->scaleFactor.getValue(), 2, 2, 2);
+    EXPECT_EQ(root->getChild(1)->getTypeId(), SoCube::getClassTypeId());
+    root->unref();
+}
+
+TEST(GltfIvCompactor, KeepTransformationsOutOfOrder)
+{
+    // the scale is applied after the translation here, a transform would apply it before
+    SoSeparator* root = new SoSeparator;
+    root->ref();
+    SoScale* scale = new SoScale;
+    scale->scaleFactor = SbVec3f(2, 2, 2);
+    SoTranslation* translation = new SoTranslation;
+    translation->translation = SbVec3f(1, 2, 3);
+    root->addChild(scale);
+    root->addChild(translation);
+    root->addChild(new SoCube);
+
+    EXPECT_EQ(GltfIvCompactor::compact(root), 0u);
+    ASSERT_EQ(root->getNumChildren(), 3);
+    EXPECT_EQ(root->getChild(0), scale);
+    EXPECT_EQ(root->getChild(1), translation);
+    root->unref();
+}
+
+TEST(GltfIvCompactor, RemoveIdentities)
+{
+    EXPECT_TRUE(GltfIvCompactor::isIdentityRotation(0.0f, 0.0f, 0.0f, 1.0f));
+    EXPECT_TRUE(GltfIvCompactor::isIdentityRotation(0.0, 0.0, 0.0, -1.0));
+    EXPECT_FALSE(GltfIvCompactor::isIdentityRotation(0.0f, 0.6f, 0.0f, 0.8f));
+
+    SoSeparator* root = new SoSeparator;
+    root->ref();
+    SoTranslation* translation = new SoTranslation;
+    translation->translation = SbVec3f(0, 0, 0);
+    SoRotation* rotation = new SoRotation;
+    rotation->rotation = SbRotation(0, 0, 0, -1);
+    SoScale* scale = new SoScale;
+    scale->scaleFactor = SbVec3f(1, 1, 1);
+    SoTransform* transform = new SoTransform;
+    SoRotation* turn = new SoRotation;
+    turn->rotation = SbRotation(0, 0.6f, 0, 0.8f);
+    root->addChild(translation);
+    root->addChild(rotation);
+    root->addChild(scale);
+    root->addChild(transform);
+    root->addChild(turn);
+    root->addChild(new SoCube);
+
+    EXPECT_EQ(GltfIvCompactor::compact(root), 4u);
+    ASSERT_EQ(root->getNumChildren(), 2);
+    EXPECT_EQ(root->getChild(0), turn);
+    EXPECT_EQ(root->getChild(1)->getTypeId(), SoCube::getClassTypeId());
+    root->unref();
+}
+
+TEST(GltfIvCompactor, RemoveRepeatedBindings)
+{
+    SoSeparator* root = new SoSeparator;
+    root->ref();
+    SoMaterialBinding* perFace = new SoMaterialBinding;
+    perFace->value = SoMaterialBinding::PER_FACE;
+    SoMaterialBinding* repeated = new SoMaterialBinding;
+    repeated->value = SoMaterialBinding::PER_FACE;
+    SoMaterialBinding* overall = new SoMaterialBinding;
+    overall->value = SoMaterialBinding::OVERALL;
+    // a group passes its bindings on, the binding after it is needed again
+    SoGroup* group = new SoGroup;
+    group->addChild(overall);
+    SoMaterialBinding* afterGroup = new SoMaterialBinding;
+    afterGroup->value = SoMaterialBinding::PER_FACE;
+    root->addChild(perFace);
+    root->addChild(new SoCube);
+    root->addChild(repeated);
+    root->addChild(new SoCube);
+    root->addChild(group);
+    root->addChild(afterGroup);
+    root->addChild(new SoCube);
+
+    EXPECT_EQ(GltfIvCompactor::compact(root), 1u);
+    ASSERT_EQ(root->getNumChildren(), 6);
+    EXPECT_EQ(root->getChild(0), perFace);
+    EXPECT_EQ(root->findChild(repeated), -1);
+    EXPECT_EQ(root->getChild(3), group);
+    EXPECT_EQ(root->getChild(4), afterGroup);
+    root->unref();
+}
+
+TEST(GltfIvCompactor, FlattenSharedSeparator)
+{
+    // the same separator is used twice, it is written once with DEF and then with USE
+    SoSeparator* root = new SoSeparator;
+    root->ref();
+    SoSeparator* shared = new SoSeparator;
+    SoCube* cube = new SoCube;
+    shared->addChild(cube);
+    SoSeparator* named = new SoSeparator;
+    named->setName("Named");
+    named->addChild(new SoCube);
+    root->addChild(shared);
+    root->addChild(named);
+    root->addChild(shared);
+
+    EXPECT_EQ(GltfIvCompactor::compact(root), 2u);
+    ASSERT_EQ(root->getNumChildren(), 3);
+    EXPECT_EQ(root->getChild(0), cube);
+    EXPECT_EQ(root->getChild(1), named);
+    EXPECT_EQ(root->getChild(2), cube);
+    root->unref();
+}
+
+int main(int ac, char* av[])
+{
+    testing::InitGoogleTest(&ac, av);
+    SoDB::init();
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include "GltfIvDequantizer.h"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace {
+
+    // values over the whole range of the type, starting with its minimum and maximum
+    template<class C>
+    C component(size_t i)
+    {
+        if (i == 0U) {
+            return std::numeric_limits<C>::min();
+        }
+        if (i == 1U) {
+            return std::numeric_limits<C>::max();
+        }
+        return static_cast<C>(static_cast<uint32_t>(i) * 2654435761U);
+    }
+
+    // count elements of three components, byteStride bytes apart, through the vector kernels
+    // and one by one through the scalar conversion
+    template<class C, bool Normalized>
+    void compareWithScalar(size_t count, size_t byteStride)
+    {
+        constexpr size_t components{ 3U };
+        std::vector<unsigned char> data(count * byteStride, 0xcd);
+        std::vector<C> values;
+        for (size_t i = 0; i < count; ++i) {
+            for (size_t j = 0; j < components; ++j) {
+                values.push_back(component<C>(i * components + j));
+                std::memcpy(data.data() + i * byteStride + j * sizeof(C), &values.back(), sizeof(C));
+            }
+        }
+
+        std::vector<float> out(count * components);
+        GltfIvDequantizer::dequantize<C, components, Normalized>(data.data(), count, byteStride, out.data());
+        for (size_t i = 0; i < values.size(); ++i) {
+            EXPECT_EQ(out[i], (GltfIvDequantizer::convert<C, Normalized>(values[i]))) << "component " << i << " of " << sizeof(C) << " bytes with stride " << byteStride;
+        }
+    }
+
+    // packed and padded elements, both with counts that leave a tail after groups of 4 and 8
+    template<class C, bool Normalized>
+    void compareWithScalar()
+    {
+        compareWithScalar<C, Normalized>(13U, 3U * sizeof(C));
+        compareWithScalar<C, Normalized>(301U, 3U * sizeof(C) + 5U);
+    }
+
+}
+
+TEST(GltfIvDequantizer, MatchScalarConversion)
+{
+    compareWithScalar<int8_t, false>();
+    compareWithScalar<int8_t, true>();
+    compareWithScalar<uint8_t, false>();
+    compareWithScalar<uint8_t, true>();
+    compareWithScalar<int16_t, false>();
+    compareWithScalar<int16_t, true>();
+    compareWithScalar<uint16_t, false>();
+    compareWithScalar<uint16_t, true>();
+    compareWithScalar<uint32_t, false>();
+}
+
+TEST(GltfIvDequantizer, ClampNormalizedMinimum)
+{
+    EXPECT_EQ((GltfIvDequantizer::convert<int8_t, true>(-128)), -1.0f);
+    EXPECT_EQ((GltfIvDequantizer::convert<int8_t, true>(127)), 1.0f);
+    EXPECT_EQ((GltfIvDequantizer::convert<int16_t, true>(-32768)), -1.0f);
+    EXPECT_EQ((GltfIvDequantizer::convert<uint16_t, true>(65535)), 1.0f);
+    EXPECT_EQ((GltfIvDequantizer::convert<int16_t, false>(-32768)), -32768.0f);
+}
+
+int main(int ac, char* av[])
+{
+    testing::InitGoogleTest(&ac, av);
+    return RUN_ALL_TESTS();
+}
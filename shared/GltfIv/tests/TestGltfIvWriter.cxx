@@ -0,0 +1,374 @@
+#include <gtest/gtest.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoSearchAction.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include "GltfIvWriter.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+using point_t = std::array<float, 3>;
+
+// appends the bytes of the items to the first buffer of the model in a buffer view of their own
+template<class T>
+static int addBufferView(tinygltf::Model& model, const std::vector<T>& items)
+{
+    if (model.buffers.empty()) {
+        model.buffers.emplace_back();
+    }
+    std::vector<unsigned char>& data = model.buffers[0].data;
+    tinygltf::BufferView bufferView;
+    bufferView.buffer = 0;
+    bufferView.byteOffset = data.size();
+    bufferView.byteLength = items.size() * sizeof(T);
+    data.resize(data.size() + bufferView.byteLength);
+    std::memcpy(data.data() + bufferView.byteOffset, items.data(), bufferView.byteLength);
+    model.bufferViews.push_back(bufferView);
+    return static_cast<int>(model.bufferViews.size() - 1U);
+}
+
+// a model with a single triangle whose positions are a sparse accessor, over the given base
+// positions or over zeros if there are none
+static GltfIvModel sparseTriangleModel(const std::vector<point_t>& basePositions, const std::vector<uint16_t>& sparseIndices, const std::vector<point_t>& sparseValues)
+{
+    GltfIvModel model;
+
+    tinygltf::Accessor positions;
+    positions.bufferView = basePositions.empty() ? -1 : addBufferView(model, basePositions);
+    positions.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
+    positions.type = TINYGLTF_TYPE_VEC3;
+    positions.count = 3;
+    positions.sparse.isSparse = true;
+    positions.sparse.count = static_cast<int>(sparseIndices.size());
+    positions.sparse.indices.bufferView = addBufferView(model, sparseIndices);
+    positions.sparse.indices.componentType = TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+    positions.sparse.values.bufferView = addBufferView(model, sparseValues);
+    model.accessors.push_back(positions);
+
+    tinygltf::Primitive primitive;
+    primitive.attributes["POSITION"] = 0;
+    primitive.mode = TINYGLTF_MODE_TRIANGLES;
+    tinygltf::Mesh mesh;
+    mesh.primitives.push_back(primitive);
+    model.meshes.push_back(mesh);
+
+    tinygltf::Node node;
+    node.mesh = 0;
+    model.nodes.push_back(node);
+    tinygltf::Scene scene;
+    scene.nodes.push_back(0);
+    model.scenes.push_back(scene);
+    model.defaultScene = 0;
+    return model;
+}
+
+// reads an inventor file, the root is referenced
+static SoSeparator* readFile(const std::string& filename)
+{
+    SoInput input;
+    if (!input.openFile(filename.c_str())) {
+        ADD_FAILURE() << "cannot open " << filename;
+        return nullptr;
+    }
+    SoSeparator* root = SoDB::readAll(&input);
+    input.closeFile();
+    if (root == nullptr) {
+        ADD_FAILURE() << "cannot read " << filename;
+        return nullptr;
+    }
+    root->ref();
+    return root;
+}
+
+// the points of all coordinate nodes in an inventor file, sorted as the writer may reorder them
+static std::vector<point_t> readPoints(const std::string& filename)
+{
+    std::vector<point_t> points;
+    SoSeparator* root = readFile(filename);
+    if (root == nullptr) {
+        return points;
+    }
+
+    SoSearchAction search;
+    search.setType(SoCoordinate3::getClassTypeId());
+    search.setInterest(SoSearchAction::ALL);
+    search.apply(root);
+    const SoPathList& paths = search.getPaths();
+    for (int i = 0; i < paths.getLength(); ++i) {
+        const SoCoordinate3* coordinates = static_cast<const SoCoordinate3*>(paths[i]->getTail());
+        for (int j = 0; j < coordinates->point.getNum(); ++j) {
+            const SbVec3f& point = coordinates->point[j];
+            points.push_back({ point[0], point[1], point[2] });
+        }
+    }
+    root->unref();
+
+    std::sort(points.begin(), points.end());
+    return points;
+}
+
+// writes the model streamed and from a scene graph and expects the points of both files
+static void expectWrittenPoints(const GltfIvModel& model, const std::string& name, std::vector<point_t> expected)
+{
+    std::sort(expected.begin(), expected.end());
+    for (const bool directOutput : { true, false }) {
+        SCOPED_TRACE(directOutput ? "streamed" : "scene graph");
+        const std::string filename{ name + (directOutput ? "_streamed.iv" : "_scenegraph.iv") };
+        GltfIvWriter writer{ GltfIvModel{ model } };
+        writer.setDirectOutput(directOutput);
+        ASSERT_TRUE(writer.write(filename, false));
+        EXPECT_EQ(readPoints(filename), expected);
+    }
+}
+
+// a model with a mesh of two triangles in one material, used by two nodes
+static GltfIvModel sharedMeshModel()
+{
+    GltfIvModel model;
+
+    tinygltf::Material material;
+    material.name = "red";
+    material.pbrMetallicRoughness.baseColorFactor = { 1, 0, 0, 1 };
+    model.materials.push_back(material);
+
+    tinygltf::Mesh mesh;
+    mesh.name = "triangles";
+    const std::vector<std::vector<point_t>> triangles{
+        { { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 } },
+        { { 0, 0, 1 }, { 1, 0, 1 }, { 0, 1, 1 } }
+    };
+    for (const std::vector<point_t>& triangle : triangles) {
+        tinygltf::Accessor positions;
+        positions.bufferView = addBufferView(model, triangle);
+        positions.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
+        positions.type = TINYGLTF_TYPE_VEC3;
+        positions.count = triangle.size();
+        model.accessors.push_back(positions);
+
+        tinygltf::Primitive primitive;
+        primitive.attributes["POSITION"] = static_cast<int>(model.accessors.size() - 1U);
+        primitive.material = 0;
+        primitive.mode = TINYGLTF_MODE_TRIANGLES;
+        mesh.primitives.push_back(primitive);
+    }
+    model.meshes.push_back(mesh);
+
+    tinygltf::Scene scene;
+    for (const double x : { 0.0, 2.0 }) {
+        tinygltf::Node node;
+        node.mesh = 0;
+        node.translation = { x, 0, 0 };
+        model.nodes.push_back(node);
+        scene.nodes.push_back(static_cast<int>(model.nodes.size() - 1U));
+    }
+    model.scenes.push_back(scene);
+    model.defaultScene = 0;
+    return model;
+}
+
+// the nodes of a scene graph, shared ones are visited once for every parent
+struct node_counts_t {
+    size_t instances{ 0U };
+    std::set<const SoNode*> nodes;
+    size_t coordinateInstances{ 0U };
+    std::set<const SoNode*> coordinates;
+    size_t materialInstances{ 0U };
+    std::set<const SoNode*> materials;
+    size_t points{ 0U };
+};
+
+static void countNodes(const SoNode* node, node_counts_t& counts)
+{
+    ++counts.instances;
+    counts.nodes.insert(node);
+    if (node->getTypeId() == SoCoordinate3::getClassTypeId()) {
+        ++counts.coordinateInstances;
+        counts.coordinates.insert(node);
+        counts.points += static_cast<const SoCoordinate3*>(node)->point.getNum();
+    }
+    else if (node->getTypeId() == SoMaterial::getClassTypeId()) {
+        ++counts.materialInstances;
+        counts.materials.insert(node);
+    }
+    if (const SoChildList* children = node->getChildren()) {
+        for (int i = 0; i < children->getLength(); ++i) {
+            countNodes((*children)[i], counts);
+        }
+    }
+}
+
+// a model with a triangle in a child node below a parent translated along x
+static GltfIvModel translatedChildModel()
+{
+    GltfIvModel model;
+
+    tinygltf::Accessor positions;
+    positions.bufferView = addBufferView(model, std::vector<point_t>{ { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 } });
+    positions.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
+    positions.type = TINYGLTF_TYPE_VEC3;
+    positions.count = 3;
+    positions.minValues = { 0, 0, 0 };
+    positions.maxValues = { 1, 1, 0 };
+    model.accessors.push_back(positions);
+
+    tinygltf::Primitive primitive;
+    primitive.attributes["POSITION"] = 0;
+    primitive.mode = TINYGLTF_MODE_TRIANGLES;
+    tinygltf::Mesh mesh;
+    mesh.primitives.push_back(primitive);
+    model.meshes.push_back(mesh);
+
+    tinygltf::Node parent;
+    parent.name = "parent";
+    parent.translation = { 10, 0, 0 };
+    parent.children.push_back(1);
+    model.nodes.push_back(parent);
+    tinygltf::Node child;
+    child.name = "child";
+    child.mesh = 0;
+    model.nodes.push_back(child);
+
+    tinygltf::Scene scene;
+    scene.nodes.push_back(0);
+    model.scenes.push_back(scene);
+    model.defaultScene = 0;
+    return model;
+}
+
+// the bounding box of an inventor file in world space
+static SbBox3f readBoundingBox(const std::string& filename)
+{
+    SoSeparator* root = readFile(filename);
+    if (root == nullptr) {
+        return SbBox3f{};
+    }
+    SoGetBoundingBoxAction action{ SbViewportRegion{} };
+    action.apply(root);
+    const SbBox3f box{ action.getBoundingBox() };
+    root->unref();
+    return box;
+}
+
+TEST(GltfIvWriter, SparseAccessorOverBufferView)
+{
+    const GltfIvModel model{ sparseTriangleModel({ { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 } }, { 1 }, { { 2, 0, 0 } }) };
+    expectWrittenPoints(model, "testgltfivwriter_sparse", { { 0, 0, 0 }, { 2, 0, 0 }, { 0, 1, 0 } });
+}
+
+TEST(GltfIvWriter, SparseAccessorWithoutBufferView)
+{
+    // the element that is not replaced reads as zeros
+    const GltfIvModel model{ sparseTriangleModel({}, { 1, 2 }, { { 1, 0, 0 }, { 0, 1, 0 } }) };
+    expectWrittenPoints(model, "testgltfivwriter_sparsezeros", { { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 } });
+}
+
+TEST(GltfIvWriter, RejectUnsortedSparseIndices)
+{
+    const GltfIvModel model{ sparseTriangleModel({ { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 } }, { 2, 1 }, { { 0, 2, 0 }, { 2, 0, 0 } }) };
+    for (const bool directOutput : { true, false }) {
+        GltfIvWriter writer{ GltfIvModel{ model } };
+        writer.setDirectOutput(directOutput);
+        EXPECT_FALSE(writer.write("testgltfivwriter_sparseunsorted.iv", false));
+    }
+}
+
+TEST(GltfIvWriter, RejectSparseIndicesOutOfRange)
+{
+    const GltfIvModel model{ sparseTriangleModel({ { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 } }, { 1, 3 }, { { 2, 0, 0 }, { 0, 2, 0 } }) };
+    for (const bool directOutput : { true, false }) {
+        GltfIvWriter writer{ GltfIvModel{ model } };
+        writer.setDirectOutput(directOutput);
+        EXPECT_FALSE(writer.write("testgltfivwriter_sparserange.iv", false));
+    }
+}
+
+TEST(GltfIvWriter, StreamedMatchesSceneGraph)
+{
+    const GltfIvModel model{ sharedMeshModel() };
+    for (const bool compact : { true, false }) {
+        SCOPED_TRACE(compact ? "compact" : "not compact");
+        std::array<node_counts_t, 2> counts;
+        for (const bool directOutput : { true, false }) {
+            const std::string filename{ std::string{ "testgltfivwriter_shared" } + (compact ? "_compact" : "") + (directOutput ? "_streamed.iv" : "_scenegraph.iv") };
+            GltfIvWriter writer{ GltfIvModel{ model } };
+            writer.setDirectOutput(directOutput);
+            writer.setCompact(compact);
+            ASSERT_TRUE(writer.write(filename, false));
+            SoSeparator* root = readFile(filename);
+            ASSERT_NE(root, nullptr);
+            countNodes(root, counts[directOutput ? 0U : 1U]);
+            root->unref();
+        }
+
+        const node_counts_t& streamed = counts[0];
+        const node_counts_t& sceneGraph = counts[1];
+        EXPECT_EQ(streamed.instances, sceneGraph.instances);
+        EXPECT_EQ(streamed.nodes.size(), sceneGraph.nodes.size());
+        EXPECT_EQ(streamed.points, sceneGraph.points);
+        for (const node_counts_t& count : counts) {
+            // both nodes use the mesh with its two triangles and both triangles use the material
+            EXPECT_EQ(count.coordinateInstances, 4u);
+            EXPECT_EQ(count.coordinates.size(), 2u);
+            EXPECT_EQ(count.points, 12u);
+            EXPECT_EQ(count.materials.size(), 1u);
+            EXPECT_GT(count.materialInstances, 1u);
+        }
+    }
+}
+
+TEST(GltfIvWriter, SelectedNodeKeepsParentTransform)
+{
+    const GltfIvModel model{ translatedChildModel() };
+    for (const bool directOutput : { true, false }) {
+        SCOPED_TRACE(directOutput ? "streamed" : "scene graph");
+        const std::string filename{ std::string{ "testgltfivwriter_selected" } + (directOutput ? "_streamed.iv" : "_scenegraph.iv") };
+        GltfIvWriter writer{ GltfIvModel{ model } };
+        writer.setDirectOutput(directOutput);
+        writer.setNodes({ "child" });
+        ASSERT_TRUE(writer.write(filename, false));
+        const SbBox3f box{ readBoundingBox(filename) };
+        ASSERT_FALSE(box.isEmpty());
+        EXPECT_FLOAT_EQ(box.getMin()[0], 10.0f);
+        EXPECT_FLOAT_EQ(box.getMax()[0], 11.0f);
+    }
+}
+
+TEST(GltfIvWriter, SelectedNodeInWorldSpaceRegion)
+{
+    const GltfIvModel model{ translatedChildModel() };
+    for (const bool directOutput : { true, false }) {
+        SCOPED_TRACE(directOutput ? "streamed" : "scene graph");
+        const std::string filename{ std::string{ "testgltfivwriter_selectedregion" } + (directOutput ? "_streamed.iv" : "_scenegraph.iv") };
+
+        // the triangle is at x 10 to 11 in world space but at 0 to 1 in the frame of its node
+        GltfIvWriter local{ GltfIvModel{ model } };
+        local.setDirectOutput(directOutput);
+        local.setNodes({ "child" });
+        local.setRegion(GltfIvWriter::box_t{ { -0.5, -0.5, -0.5 }, { 1.5, 1.5, 0.5 } });
+        ASSERT_TRUE(local.write(filename, false));
+        EXPECT_TRUE(readPoints(filename).empty());
+
+        GltfIvWriter world{ GltfIvModel{ model } };
+        world.setDirectOutput(directOutput);
+        world.setNodes({ "child" });
+        world.setRegion(GltfIvWriter::box_t{ { 9.5, -0.5, -0.5 }, { 11.5, 1.5, 0.5 } });
+        ASSERT_TRUE(world.write(filename, false));
+        EXPECT_EQ(readPoints(filename).size(), 3u);
+    }
+}
+
+int main(int ac, char* av[])
+{
+    testing::InitGoogleTest(&ac, av);
+    SoDB::init();
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+#include "GltfIvMeshoptDecoder.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+    // four vertices of 12 bytes, a 16 bit position, an 8 bit normal and a 16 bit texture coordinate
+    struct packed_vertex_t {
+        uint16_t px, py, pz;
+        uint8_t nu, nv;
+        uint16_t tx, ty;
+    };
+    static_assert(sizeof(packed_vertex_t) == 12U);
+
+    const std::array<packed_vertex_t, 4> vertices{ {
+        { 0, 0, 0, 0, 0, 0, 0 },
+        { 300, 0, 0, 0, 0, 500, 0 },
+        { 0, 300, 0, 0, 0, 0, 500 },
+        { 300, 300, 0, 0, 0, 500, 500 },
+    } };
+
+    // one block with a byte group per vertex byte, 2 bit deltas with escaped bytes for the low
+    // bytes, followed by the first vertex as tail
+    std::vector<unsigned char> encodedVertices()
+    {
+        std::vector<unsigned char> data{
+            0xa0,
+            0x01, 0x3f, 0x00, 0x00, 0x00, 0x58, 0x57, 0x58,
+            0x01, 0x26, 0x00, 0x00, 0x00,
+            0x01, 0x0c, 0x00, 0x00, 0x00, 0x58,
+            0x01, 0x08, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00,
+            0x01, 0x3f, 0x00, 0x00, 0x00, 0x17, 0x18, 0x17,
+            0x01, 0x26, 0x00, 0x00, 0x00,
+            0x01, 0x0c, 0x00, 0x00, 0x00, 0x17,
+            0x01, 0x08, 0x00, 0x00, 0x00,
+        };
+        data.resize(data.size() + 32U, 0x00);
+        return data;
+    }
+
+    // the auxiliary code table every encoder writes at the end of the index data
+    const std::array<unsigned char, 16> codeaux_table{ 0x00, 0x76, 0x87, 0x56, 0x67, 0x78, 0xa9, 0x86, 0x65, 0x89, 0x68, 0x98, 0x01, 0x69, 0x00, 0x00 };
+
+    std::vector<unsigned char> withCodeauxTable(std::vector<unsigned char> data)
+    {
+        data.insert(data.end(), codeaux_table.cbegin(), codeaux_table.cend());
+        return data;
+    }
+
+    // new vertices, an edge with a new vertex, a triangle of a new and two cached vertices and
+    // one of three new vertices read from the data
+    const std::vector<unsigned char> index_data_v0{ withCodeauxTable({ 0xe0, 0xf0, 0x10, 0xfe, 0xff, 0xf0, 0x0c, 0xff, 0x02, 0x02, 0x02 }) };
+    const std::vector<uint32_t> indices_v0{ 0, 1, 2, 2, 1, 3, 4, 6, 5, 7, 8, 9 };
+
+    // three free indices, the last free index minus and plus one and a restart
+    const std::vector<unsigned char> index_data_v1{ withCodeauxTable({ 0xe1, 0xf0, 0x10, 0xff, 0x0d, 0x0e, 0xfe, 0xff, 0x14, 0x02, 0x03, 0x00 }) };
+    const std::vector<uint32_t> indices_v1{ 0, 1, 2, 2, 1, 3, 10, 11, 9, 10, 9, 8, 10, 8, 9, 0, 1, 2 };
+
+    // deltas against two baselines, the last index takes two bytes
+    const std::vector<unsigned char> index_sequence_data{ 0xd1, 0x00, 0x04, 0xcd, 0x01, 0x04, 0x07, 0x98, 0x1f, 0x00, 0x00, 0x00, 0x00 };
+    const std::vector<uint32_t> index_sequence{ 0, 1, 51, 2, 49, 1000 };
+
+    template <typename T>
+    std::span<unsigned char> bytes(std::vector<T> & values)
+    {
+        return { reinterpret_cast<unsigned char *>(values.data()), values.size() * sizeof(T) };
+    }
+
+    std::vector<uint32_t> decodeIndices(const std::vector<unsigned char> & data, size_t count)
+    {
+        std::vector<uint32_t> indices(count);
+        EXPECT_TRUE(GltfIvMeshoptDecoder::decodeIndexBuffer(bytes(indices), count, sizeof(uint32_t), data));
+        return indices;
+    }
+
+}
+
+TEST(GltfIvMeshoptDecoder, DecodeVertexBuffer)
+{
+    std::vector<packed_vertex_t> decoded(vertices.size());
+    ASSERT_TRUE(GltfIvMeshoptDecoder::decodeVertexBuffer(bytes(decoded), decoded.size(), sizeof(packed_vertex_t), encodedVertices()));
+    EXPECT_EQ(std::memcmp(decoded.data(), vertices.data(), sizeof(vertices)), 0);
+}
+
+TEST(GltfIvMeshoptDecoder, DecodeIndexBuffer)
+{
+    EXPECT_EQ(decodeIndices(index_data_v0, indices_v0.size()), indices_v0);
+    EXPECT_EQ(decodeIndices(index_data_v1, indices_v1.size()), indices_v1);
+
+    std::vector<uint16_t> shortIndices(indices_v0.size());
+    ASSERT_TRUE(GltfIvMeshoptDecoder::decodeIndexBuffer(bytes(shortIndices), shortIndices.size(), sizeof(uint16_t), index_data_v0));
+    for (size_t i = 0; i < indices_v0.size(); ++i) {
+        EXPECT_EQ(shortIndices[i], indices_v0[i]);
+    }
+}
+
+TEST(GltfIvMeshoptDecoder, DecodeIndexSequence)
+{
+    std::vector<uint32_t> indices(index_sequence.size());
+    ASSERT_TRUE(GltfIvMeshoptDecoder::decodeIndexSequence(bytes(indices), indices.size(), sizeof(uint32_t), index_sequence_data));
+    EXPECT_EQ(indices, index_sequence);
+
+    std::vector<uint16_t> shortIndices(index_sequence.size());
+    ASSERT_TRUE(GltfIvMeshoptDecoder::decodeIndexSequence(bytes(shortIndices), shortIndices.size(), sizeof(uint16_t), index_sequence_data));
+    for (size_t i = 0; i < index_sequence.size(); ++i) {
+        EXPECT_EQ(shortIndices[i], index_sequence[i]);
+    }
+}
+
+TEST(GltfIvMeshoptDecoder, DecodeOctahedralFilter)
+{
+    std::vector<int8_t> normals8{ 0, 1, 127, 0, 0, -69, 127, 1, -1, 1, 127, 0, 14, -126, 127, 1 };
+    const std::vector<int8_t> expected8{ 0, 1, 127, 0, 0, -97, 82, 1, -1, 1, 127, 0, 1, -126, -15, 1 };
+    ASSERT_TRUE(GltfIvMeshoptDecoder::decodeOctahedralFilter(bytes(normals8), 4, 4));
+    EXPECT_EQ(normals8, expected8);
+
+    std::vector<uint16_t> normals16{ 0, 1, 2047, 0, 0, 1870, 2047, 1, 2017, 1, 2047, 0, 14, 1300, 2047, 1 };
+    const std::vector<uint16_t> expected16{ 0, 16, 32767, 0, 0, 32621, 3088, 1, 32764, 16, 471, 0, 307, 28541, 16093, 1 };
+    ASSERT_TRUE(GltfIvMeshoptDecoder::decodeOctahedralFilter(bytes(normals16), 4, 8));
+    EXPECT_EQ(normals16, expected16);
+}
+
+TEST(GltfIvMeshoptDecoder, DecodeQuaternionFilter)
+{
+    std::vector<uint16_t> quaternions{ 0, 1, 0, 0x7fc, 0, 1870, 0, 0x7fd, 2017, 1, 0, 0x7fe, 14, 1300, 0, 0x7ff };
+    const std::vector<uint16_t> expected{ 32767, 0, 11, 0, 0, 25013, 0, 21166, 11, 0, 23504, 22830, 158, 14715, 0, 29277 };
+    ASSERT_TRUE(GltfIvMeshoptDecoder::decodeQuaternionFilter(bytes(quaternions), 4, 8));
+    EXPECT_EQ(quaternions, expected);
+}
+
+TEST(GltfIvMeshoptDecoder, DecodeExponentialFilter)
+{
+    std::vector<uint32_t> values{ 0, 0xff000003, 0x02fffff7, 0xfe7fffff };
+    const std::vector<uint32_t> expected{ 0, 0x3fc00000, 0xc2100000, 0x49fffffe };
+    ASSERT_TRUE(GltfIvMeshoptDecoder::decodeExponentialFilter(bytes(values), 4, 4));
+    EXPECT_EQ(values, expected);
+}
+
+TEST(GltfIvMeshoptDecoder, RejectMalformedData)
+{
+    std::vector<packed_vertex_t> decoded(vertices.size());
+    std::vector<unsigned char> vertexData{ encodedVertices() };
+    const size_t vertexSize{ sizeof(packed_vertex_t) };
+    EXPECT_FALSE(GltfIvMeshoptDecoder::decodeVertexBuffer(bytes(decoded), decoded.size(), vertexSize, std::span{ vertexData }.first(vertexData.size() - 1U)));
+    EXPECT_FALSE(GltfIvMeshoptDecoder::decodeVertexBuffer(bytes(decoded), decoded.size(), vertexSize, std::span{ vertexData }.first(20U)));
+    EXPECT_FALSE(GltfIvMeshoptDecoder::decodeVertexBuffer(bytes(decoded), decoded.size() + 1U, vertexSize, vertexData));
+    EXPECT_FALSE(GltfIvMeshoptDecoder::decodeVertexBuffer(bytes(decoded), 2U, 6U, vertexData));
+    vertexData.push_back(0x00);
+    EXPECT_FALSE(GltfIvMeshoptDecoder::decodeVertexBuffer(bytes(decoded), decoded.size(), vertexSize, vertexData));
+    vertexData.pop_back();
+    vertexData[0] = 0xb0;
+    EXPECT_FALSE(GltfIvMeshoptDecoder::decodeVertexBuffer(bytes(decoded), decoded.size(), vertexSize, vertexData));
+
+    std::vector<uint32_t> indices(indices_v0.size());
+    EXPECT_FALSE(GltfIvMeshoptDecoder::decodeIndexBuffer(bytes(indices), indices.size(), sizeof(uint32_t), std::span{ index_data_v0 }.first(index_data_v0.size() - 1U)));
+    EXPECT_FALSE(GltfIvMeshoptDecoder::decodeIndexBuffer(bytes(indices), indices.size() - 1U, sizeof(uint32_t), index_data_v0));
+    EXPECT_FALSE(GltfIvMeshoptDecoder::decodeIndexBuffer(bytes(indices), indices.size(), 3U, index_data_v0));
+    std::vector<unsigned char> indexData{ index_data_v0 };
+    indexData[0] = 0xe2;
+    EXPECT_FALSE(GltfIvMeshoptDecoder::decodeIndexBuffer(bytes(indices), indices.size(), sizeof(uint32_t), indexData));
+    std::vector<uint32_t> tooFew(indices_v0.size() - 3U);
+    EXPECT_FALSE(GltfIvMeshoptDecoder::decodeIndexBuffer(bytes(tooFew), indices_v0.size(), sizeof(uint32_t), index_data_v0));
+
+    std::vector<uint32_t> sequence(index_sequence.size());
+    EXPECT_FALSE(GltfIvMeshoptDecoder::decodeIndexSequence(bytes(sequence), sequence.size(), sizeof(uint32_t), std::span{ index_sequence_data }.first(index_sequence_data.size() - 1U)));
+    std::vector<unsigned char> sequenceData{ index_sequence_data };
+    sequenceData[0] = 0xe0;
+    EXPECT_FALSE(GltfIvMeshoptDecoder::decodeIndexSequence(bytes(sequence), sequence.size(), sizeof(uint32_t), sequenceData));
+
+    std::vector<uint16_t> filtered(16);
+    EXPECT_FALSE(GltfIvMeshoptDecoder::decodeOctahedralFilter(bytes(filtered), 4, 6));
+    EXPECT_FALSE(GltfIvMeshoptDecoder::decodeOctahedralFilter(bytes(filtered), 5, 8));
+    EXPECT_FALSE(GltfIvMeshoptDecoder::decodeQuaternionFilter(bytes(filtered), 4, 4));
+    EXPECT_FALSE(GltfIvMeshoptDecoder::decodeExponentialFilter(bytes(filtered), 4, 6));
+    EXPECT_FALSE(GltfIvMeshoptDecoder::decodeExponentialFilter(bytes(filtered), 9, 4));
+}
+
+int main(int ac, char* av[])
+{
+    testing::InitGoogleTest(&ac, av);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include "GltfIvStripifier.h"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace {
+
+    using triangle_t = std::array<GltfIvStripifier::index_t, 3>;
+
+    // the same triangle starts with its smallest vertex whatever corner it was given from, the
+    // rotation keeps the winding
+    triangle_t normalized(triangle_t triangle)
+    {
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        return triangle;
+    }
+
+    std::vector<triangle_t> sortedTriangles(const GltfIvStripifier::indices_t & vertices)
+    {
+        std::vector<triangle_t> triangles;
+        for (size_t i = 0; i + 2U < vertices.size(); i += 3U) {
+            triangles.push_back(normalized({ vertices[i], vertices[i + 1U], vertices[i + 2U] }));
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+
+    // triangle k of a strip is (v[k], v[k+1], v[k+2]) for even and (v[k+1], v[k], v[k+2]) for odd k
+    std::vector<triangle_t> stripTriangles(const GltfIvStripifier::indices_t & strips)
+    {
+        std::vector<triangle_t> triangles;
+        size_t begin{ 0U };
+        for (size_t end = 0; end < strips.size(); ++end) {
+            if (strips[end] != -1) {
+                continue;
+            }
+            for (size_t k = 0; begin + k + 2U < end; ++k) {
+                const size_t i{ begin + k };
+                triangles.push_back(normalized(k % 2U == 0U ? triangle_t{ strips[i], strips[i + 1U], strips[i + 2U] } : triangle_t{ strips[i + 1U], strips[i], strips[i + 2U] }));
+            }
+            begin = end + 1U;
+        }
+        EXPECT_EQ(begin, strips.size()) << "the last strip is not terminated";
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+
+}
+
+TEST(GltfIvStripifier, QuadGrid)
+{
+    // 4x4 quads of 5x5 vertices, two counterclockwise triangles each
+    constexpr int size{ 4 };
+    GltfIvStripifier::indices_t vertices;
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            const int a{ y * (size + 1) + x };
+            const int b{ a + 1 };
+            const int c{ a + size + 1 };
+            const int d{ c + 1 };
+            vertices.insert(vertices.end(), { a, b, d, a, d, c });
+        }
+    }
+
+    const GltfIvStripifier::indices_t strips{ GltfIvStripifier::stripify(vertices) };
+    EXPECT_EQ(stripTriangles(strips), sortedTriangles(vertices));
+    // a strip of n triangles takes n + 3 indices with its terminator, a list 4 per triangle
+    EXPECT_LT(strips.size(), vertices.size() / 3U * 4U);
+}
+
+TEST(GltfIvStripifier, KeepDegenerateTriangles)
+{
+    const GltfIvStripifier::indices_t vertices{ 0, 1, 2, 2, 2, 3, 2, 1, 3, 4, 5, 4 };
+    const GltfIvStripifier::indices_t strips{ GltfIvStripifier::stripify(vertices) };
+    EXPECT_EQ(stripTriangles(strips), sortedTriangles(vertices));
+}
+
+int main(int ac, char* av[])
+{
+    testing::InitGoogleTest(&ac, av);
+    return RUN_ALL_TESTS();
+}
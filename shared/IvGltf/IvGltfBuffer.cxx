@@ -0,0 +1,67 @@
+#include "IvGltfBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+static constexpr size_t chunk_alignment = 4;
+
+size_t IvGltfBufferBuilder::append(IvGltfBufferChunk chunk)
+{
+    const size_t offset = (m_size + chunk_alignment - 1) / chunk_alignment * chunk_alignment;
+    const size_t size = chunk.size();
+    if (size == 0) {
+        return offset;
+    }
+    m_entries.push_back({ offset, std::move(chunk) });
+    m_size = offset + size;
+
+    m_stagedBytes += size;
+    ++m_statistics.chunks;
+    m_statistics.peakStagedBytes = std::max(m_statistics.peakStagedBytes, m_stagedBytes);
+    m_statistics.peakBytes = std::max(m_statistics.peakBytes, m_stagedBytes);
+    return offset;
+}
+
+unsigned char * IvGltfBufferBuilder::data(size_t offset)
+{
+    auto it = std::upper_bound(m_entries.begin(), m_entries.end(), offset, [](size_t value, const Entry & entry) {
+        return value < entry.offset;
+    });
+    if (it == m_entries.begin() || offset >= std::prev(it)->offset + std::prev(it)->chunk.size()) {
+        throw std::out_of_range("offset is not inside a buffer chunk");
+    }
+    --it;
+    return it->chunk.data() + (offset - it->offset);
+}
+
+void IvGltfBufferBuilder::assemble(std::vector<unsigned char> & out)
+{
+    out.clear();
+    out.reserve(m_size);
+    stream([this, &out](const unsigned char * bytes, size_t size) {
+        out.insert(out.end(), bytes, bytes + size);
+        m_statistics.peakBytes = std::max(m_statistics.peakBytes, m_stagedBytes + out.size());
+    });
+}
+
+void IvGltfBufferBuilder::stream(const std::function<void(const unsigned char *, size_t)> & write)
+{
+    static const unsigned char padding[chunk_alignment] = {};
+    size_t written = 0;
+    for (Entry & entry : m_entries) {
+        if (entry.offset > written) {
+            write(padding, entry.offset - written);
+        }
+        const size_t size = entry.chunk.size();
+        write(entry.chunk.data(), size);
+        written = entry.offset + size;
+        ++m_statistics.copies;
+        m_statistics.bytesCopied += size;
+
+        m_stagedBytes -= size;
+        entry.chunk = IvGltfBufferChunk(std::vector<unsigned char>());
+    }
+    m_entries.clear();
+    m_size = 0;
+}
@@ -0,0 +1,103 @@
+#pragma once 
+#include "IvGltf.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+// a move-only block of bytes that owns the vector it was created from, so typed vertex data
+// and encoded images become part of the output buffer without being copied
+class IVGLTF_EXPORT IvGltfBufferChunk {
+public:
+    template <typename T> explicit IvGltfBufferChunk(std::vector<T> && values)
+        : m_storage(std::make_unique<Storage<T>>(std::move(values)))
+    {
+    }
+    IvGltfBufferChunk(IvGltfBufferChunk &&) = default;
+    IvGltfBufferChunk & operator=(IvGltfBufferChunk &&) = default;
+    IvGltfBufferChunk(const IvGltfBufferChunk &) = delete;
+    IvGltfBufferChunk & operator=(const IvGltfBufferChunk &) = delete;
+
+    unsigned char * data()
+    {
+        return m_storage->data();
+    }
+    size_t size() const
+    {
+        return m_storage->size();
+    }
+
+private:
+    struct StorageBase {
+        virtual ~StorageBase() = default;
+        virtual unsigned char * data() = 0;
+        virtual size_t size() const = 0;
+    };
+    template <typename T> struct Storage : StorageBase {
+        explicit Storage(std::vector<T> && values) : values(std::move(values))
+        {
+        }
+        unsigned char * data() override
+        {
+            return reinterpret_cast<unsigned char *>(values.data());
+        }
+        size_t size() const override
+        {
+            return values.size() * sizeof(T);
+        }
+        std::vector<T> values;
+    };
+    std::unique_ptr<StorageBase> m_storage;
+};
+
+struct IvGltfBufferStatistics {
+    size_t chunks = 0;          // blocks handed over without copying
+    size_t copies = 0;          // memcpy calls into the output storage
+    size_t bytesCopied = 0;
+    size_t peakStagedBytes = 0; // largest amount of chunk data held before assembly
+    size_t peakBytes = 0;       // largest amount of chunk and assembled data held at the same time
+};
+
+// collects the chunks of the single glTF buffer. every chunk starts 4 byte aligned, which
+// satisfies the alignment of all accessor component types.
+class IVGLTF_EXPORT IvGltfBufferBuilder {
+public:
+    // returns the byte offset of the chunk in the buffer, empty chunks are not stored
+    size_t append(IvGltfBufferChunk chunk);
+    template <typename T> size_t append(std::vector<T> && values)
+    {
+        return append(IvGltfBufferChunk(std::move(values)));
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+    // pointer to the byte at offset, valid until the chunks are assembled
+    unsigned char * data(size_t offset);
+
+    // copies every chunk once into out and releases it right after, so the staged data and
+    // the output are not both held in full
+    void assemble(std::vector<unsigned char> & out);
+    // hands the chunks and the zero padding between them to write in buffer order, releasing
+    // every chunk once it is written
+    void stream(const std::function<void(const unsigned char *, size_t)> & write);
+
+    const IvGltfBufferStatistics & statistics() const
+    {
+        return m_statistics;
+    }
+
+private:
+    struct Entry {
+        size_t offset;
+        IvGltfBufferChunk chunk;
+    };
+    std::vector<Entry> m_entries;
+    size_t m_size = 0;
+    size_t m_stagedBytes = 0;
+    IvGltfBufferStatistics m_statistics;
+};
@@ -0,0 +1,281 @@
+#include "IvGltfImage.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <streambuf>
+#include <unordered_set>
+#ifdef _WIN32
+#define strerror_r(errno,buf,len) strerror_s(buf,len,errno)
+#endif 
+#include <png++/png.hpp>
+#include "stb_image_write.h"
+
+IvGltfImage::IvGltfImage(int width, int height, int components)
+    : width(width), height(height), components(components), pixels(static_cast<size_t>(width) * height * components)
+{
+}
+
+IvGltfImage::IvGltfImage(const unsigned char * pixels, int width, int height, int components)
+    : width(width), height(height), components(components), pixels(pixels, pixels + static_cast<size_t>(width) * height * components)
+{
+}
+
+void IvGltfImage::setPixel(int x, int y, const unsigned char * source, int sourceComponents)
+{
+    unsigned char * target = pixel(x, y);
+    if (sourceComponents == components) {
+        std::memcpy(target, source, components);
+        return;
+    }
+    const bool sourceIsColor = sourceComponents >= 3;
+    const bool targetIsColor = components >= 3;
+    const unsigned char alpha = (sourceComponents == 2 || sourceComponents == 4) ? source[sourceComponents - 1] : 255;
+    if (targetIsColor) {
+        target[0] = source[0];
+        target[1] = sourceIsColor ? source[1] : source[0];
+        target[2] = sourceIsColor ? source[2] : source[0];
+    }
+    else {
+        target[0] = sourceIsColor ? static_cast<unsigned char>((source[0] * 77 + source[1] * 150 + source[2] * 29) >> 8) : source[0];
+    }
+    if (hasAlpha()) {
+        target[components - 1] = alpha;
+    }
+}
+
+namespace {
+
+constexpr float pi = 3.14159265358979f;
+
+float filterWeight(float x, IvGltfResampleFilter filter)
+{
+    x = std::abs(x);
+    if (filter == IvGltfResampleFilter::BOX) {
+        return x <= 0.5f ? 1.0f : 0.0f;
+    }
+    if (x < 1e-6f) {
+        return 1.0f;
+    }
+    if (x >= 3.0f) {
+        return 0.0f;
+    }
+    return 3.0f * std::sin(pi * x) * std::sin(pi * x / 3.0f) / (pi * pi * x * x);
+}
+
+struct Contribution {
+    int first;
+    std::vector<float> weights;
+};
+
+// weights of the source pixels contributing to each target pixel along one axis
+std::vector<Contribution> contributions(int sourceSize, int targetSize, IvGltfResampleFilter filter)
+{
+    const float scale = static_cast<float>(sourceSize) / targetSize;
+    const float filterScale = std::max(scale, 1.0f);
+    const float support = (filter == IvGltfResampleFilter::LANCZOS ? 3.0f : 0.5f) * filterScale;
+
+    std::vector<Contribution> result(targetSize);
+    for (int i = 0; i < targetSize; ++i) {
+        const float center = (i + 0.5f) * scale;
+        const int first = std::max(0, static_cast<int>(std::floor(center - support)));
+        const int last = std::min(sourceSize - 1, static_cast<int>(std::ceil(center + support)));
+        Contribution & contribution = result[i];
+        contribution.first = first;
+        float total = 0;
+        for (int j = first; j <= last; ++j) {
+            const float weight = filterWeight((j + 0.5f - center) / filterScale, filter);
+            contribution.weights.push_back(weight);
+            total += weight;
+        }
+        if (total > 0) {
+            for (float & weight : contribution.weights) {
+                weight /= total;
+            }
+        }
+        else {
+            contribution.first = std::clamp(static_cast<int>(center), 0, sourceSize - 1);
+            contribution.weights = { 1.0f };
+        }
+    }
+    return result;
+}
+
+}
+
+IvGltfImage IvGltfImage::resized(int targetWidth, int targetHeight, IvGltfResampleFilter filter) const
+{
+    if (targetWidth == width && targetHeight == height) {
+        return *this;
+    }
+
+    const std::vector<Contribution> columns = contributions(width, targetWidth, filter);
+    const std::vector<Contribution> rows = contributions(height, targetHeight, filter);
+
+    // horizontal pass into a float image of the target width
+    std::vector<float> horizontal(static_cast<size_t>(targetWidth) * height * components);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < targetWidth; ++x) {
+            float * target = &horizontal[(static_cast<size_t>(y) * targetWidth + x) * components];
+            const Contribution & contribution = columns[x];
+            for (size_t i = 0; i < contribution.weights.size(); ++i) {
+                const unsigned char * source = pixel(contribution.first + static_cast<int>(i), y);
+                for (int c = 0; c < components; ++c) {
+                    target[c] += contribution.weights[i] * source[c];
+                }
+            }
+        }
+    }
+
+    IvGltfImage result(targetWidth, targetHeight, components);
+    std::vector<float> sum(components);
+    for (int y = 0; y < targetHeight; ++y) {
+        const Contribution & contribution = rows[y];
+        for (int x = 0; x < targetWidth; ++x) {
+            std::fill(sum.begin(), sum.end(), 0.0f);
+            for (size_t i = 0; i < contribution.weights.size(); ++i) {
+                const float * source = &horizontal[((contribution.first + i) * targetWidth + x) * components];
+                for (int c = 0; c < components; ++c) {
+                    sum[c] += contribution.weights[i] * source[c];
+                }
+            }
+            unsigned char * target = result.pixel(x, y);
+            for (int c = 0; c < components; ++c) {
+                target[c] = static_cast<unsigned char>(std::clamp(std::lround(sum[c]), 0L, 255L));
+            }
+        }
+    }
+    return result;
+}
+
+// lets png++ write straight into the vector that becomes part of the output buffer
+class ByteVectorStreamBuf : public std::streambuf {
+public:
+    explicit ByteVectorStreamBuf(std::vector<unsigned char> & out) : m_out(out)
+    {
+    }
+
+protected:
+    int_type overflow(int_type c) override
+    {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            m_out.push_back(static_cast<unsigned char>(c));
+        }
+        return traits_type::not_eof(c);
+    }
+    std::streamsize xsputn(const char * s, std::streamsize n) override
+    {
+        m_out.insert(m_out.end(), s, s + n);
+        return n;
+    }
+
+private:
+    std::vector<unsigned char> & m_out;
+};
+
+std::vector<unsigned char> IvGltfImage::encodePng() const
+{
+    std::vector<unsigned char> out;
+    ByteVectorStreamBuf buffer(out);
+    std::ostream sout(&buffer);
+    if (hasAlpha()) {
+        png::image< png::rgba_pixel > image(width, height);
+        for (png::uint_32 y = 0; y < image.get_height(); ++y)
+        {
+            for (png::uint_32 x = 0; x < image.get_width(); ++x)
+            {
+                const unsigned char* d = pixel(x, y);
+                image.set_pixel(x, y, components == 4 ? png::rgba_pixel(d[0], d[1], d[2], d[3]) : png::rgba_pixel(d[0], d[0], d[0], d[1]));
+            }
+        }
+        image.write_stream(sout);
+    }
+    else {
+        png::image< png::rgb_pixel > image(width, height);
+        for (png::uint_32 y = 0; y < image.get_height(); ++y)
+        {
+            for (png::uint_32 x = 0; x < image.get_width(); ++x)
+            {
+                const unsigned char* d = pixel(x, y);
+                image.set_pixel(x, y, components == 3 ? png::rgb_pixel(d[0], d[1], d[2]) : png::rgb_pixel(d[0], d[0], d[0]));
+            }
+        }
+        image.write_stream(sout);
+    }
+    return out;
+}
+
+bool IvGltfImage::isPhotographic() const
+{
+    if (hasAlpha() || empty()) {
+        return false;
+    }
+
+    // a sample of about 64k pixels is enough for the histogram
+    const size_t pixelCount = static_cast<size_t>(width) * height;
+    const size_t step = std::max<size_t>(1, pixelCount / 65536);
+    std::vector<size_t> histogram(256, 0);
+    std::unordered_set<uint32_t> colors;
+    size_t samples = 0;
+    for (size_t i = 0; i < pixelCount; i += step) {
+        const unsigned char * d = &pixels[i * components];
+        uint32_t color = d[0];
+        int luminance = d[0];
+        if (components == 3) {
+            color = (d[0] << 16) | (d[1] << 8) | d[2];
+            luminance = (d[0] * 77 + d[1] * 150 + d[2] * 29) >> 8;
+        }
+        ++histogram[luminance];
+        if (colors.size() <= 256) {
+            colors.insert(color);
+        }
+        ++samples;
+    }
+    if (colors.size() <= 256) {
+        return false;
+    }
+
+    double entropy = 0.0;
+    for (size_t count : histogram) {
+        if (count > 0) {
+            const double p = static_cast<double>(count) / samples;
+            entropy -= p * std::log2(p);
+        }
+    }
+    return entropy > 5.0;
+}
+
+static void appendBytes(void * context, void * data, int size)
+{
+    auto * out = static_cast<std::vector<unsigned char>*>(context);
+    const unsigned char * bytes = static_cast<const unsigned char*>(data);
+    out->insert(out->end(), bytes, bytes + size);
+}
+
+std::vector<unsigned char> IvGltfImage::encodeJpeg(int quality) const
+{
+    std::vector<unsigned char> out;
+    if (hasAlpha()) {
+        IvGltfImage opaque(width, height, components - 1);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                opaque.setPixel(x, y, pixel(x, y), components);
+            }
+        }
+        stbi_write_jpg_to_func(appendBytes, &out, width, height, opaque.components, opaque.pixels.data(), quality);
+    }
+    else {
+        stbi_write_jpg_to_func(appendBytes, &out, width, height, components, pixels.data(), quality);
+    }
+    return out;
+}
+
+IvGltfEncodedImage IvGltfImage::encode(IvGltfImageEncoding encoding, int jpegQuality) const
+{
+    if (encoding == IvGltfImageEncoding::JPEG || (encoding == IvGltfImageEncoding::AUTO && isPhotographic())) {
+        return { encodeJpeg(jpegQuality), "image/jpeg" };
+    }
+    return { encodePng(), "image/png" };
+}
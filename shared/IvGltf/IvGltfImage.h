@@ -0,0 +1,57 @@
+#pragma once 
+#include "IvGltf.h"
+#include <string>
+#include <vector>
+
+enum class IvGltfResampleFilter { BOX, LANCZOS };
+// AUTO writes textures with alpha or few distinct tones as png and photographic ones as jpeg
+enum class IvGltfImageEncoding { PNG, JPEG, AUTO };
+
+struct IvGltfEncodedImage {
+    std::vector<unsigned char> data;
+    std::string mimeType;
+};
+
+// an uncompressed 8 bit image. rows are stored in the order of SoSFImage, which is also the
+// order the texture coordinates are written in, so the first row belongs to v = 0.
+struct IVGLTF_EXPORT IvGltfImage {
+    IvGltfImage() = default;
+    IvGltfImage(int width, int height, int components);
+    IvGltfImage(const unsigned char * pixels, int width, int height, int components);
+
+    bool empty() const
+    {
+        return pixels.empty();
+    }
+    bool hasAlpha() const
+    {
+        return components == 2 || components == 4;
+    }
+    const unsigned char * pixel(int x, int y) const
+    {
+        return &pixels[(static_cast<size_t>(y) * width + x) * components];
+    }
+    unsigned char * pixel(int x, int y)
+    {
+        return &pixels[(static_cast<size_t>(y) * width + x) * components];
+    }
+    // copies a pixel of another image, converting between luminance, rgb and the alpha variants
+    void setPixel(int x, int y, const unsigned char * source, int sourceComponents);
+
+    // separable resampling, the filter is widened when shrinking so every source pixel contributes
+    IvGltfImage resized(int targetWidth, int targetHeight, IvGltfResampleFilter filter) const;
+
+    // true for opaque images with a luminance entropy high enough that jpeg artifacts do not
+    // show, flat or palette images compress better and lossless as png
+    bool isPhotographic() const;
+
+    std::vector<unsigned char> encodePng() const;
+    // the alpha channel is dropped, quality is 1 to 100
+    std::vector<unsigned char> encodeJpeg(int quality) const;
+    IvGltfEncodedImage encode(IvGltfImageEncoding encoding, int jpegQuality) const;
+
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    std::vector<unsigned char> pixels;
+};
@@ -0,0 +1,693 @@
+#include "IvGltfStreamWriter.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <string_view>
+#include <type_traits>
+
+namespace {
+
+// appends json tokens to a block that is flushed to the stream when it fills up. separators
+// and indentation are inserted from the nesting state.
+class JsonStream {
+public:
+    JsonStream(std::ostream & out, bool pretty) : m_out(out), m_pretty(pretty)
+    {
+        m_block.reserve(block_size + 64);
+    }
+    ~JsonStream()
+    {
+        flush();
+    }
+
+    void beginObject()
+    {
+        separator();
+        m_block += '{';
+        m_first.push_back(true);
+    }
+    void endObject()
+    {
+        close('}');
+    }
+    void beginArray()
+    {
+        separator();
+        m_block += '[';
+        m_first.push_back(true);
+    }
+    void endArray()
+    {
+        close(']');
+    }
+    void key(std::string_view name)
+    {
+        separator();
+        quoted(name);
+        m_block += m_pretty ? ": " : ":";
+        m_afterKey = true;
+    }
+
+    void string(std::string_view value)
+    {
+        separator();
+        quoted(value);
+        check();
+    }
+    void boolean(bool value)
+    {
+        separator();
+        m_block += value ? "true" : "false";
+    }
+    void null()
+    {
+        separator();
+        m_block += "null";
+    }
+    void integer(int64_t value)
+    {
+        separator();
+        char text[24];
+        const auto result = std::to_chars(text, text + sizeof(text), value);
+        m_block.append(text, result.ptr);
+    }
+    void number(double value)
+    {
+        if (!std::isfinite(value)) {
+            null();
+            return;
+        }
+        separator();
+        char text[32];
+        const auto result = std::to_chars(text, text + sizeof(text), value);
+        m_block.append(text, result.ptr);
+    }
+    // a value whose text is produced in pieces by raw
+    void beginRaw()
+    {
+        separator();
+    }
+    void raw(std::string_view text)
+    {
+        m_block += text;
+        check();
+    }
+
+    void flush()
+    {
+        m_out.write(m_block.data(), m_block.size());
+        m_block.clear();
+    }
+
+private:
+    static constexpr size_t block_size = 1 << 16;
+
+    void check()
+    {
+        if (m_block.size() >= block_size) {
+            flush();
+        }
+    }
+    void separator()
+    {
+        if (m_afterKey) {
+            m_afterKey = false;
+            return;
+        }
+        if (m_first.empty()) {
+            return;
+        }
+        if (!m_first.back()) {
+            m_block += ',';
+        }
+        m_first.back() = false;
+        newline();
+        check();
+    }
+    void close(char bracket)
+    {
+        const bool empty = m_first.back();
+        m_first.pop_back();
+        if (!empty) {
+            newline();
+        }
+        m_block += bracket;
+    }
+    void newline()
+    {
+        if (m_pretty) {
+            m_block += '\n';
+            m_block.append(m_first.size() * 2, ' ');
+        }
+    }
+    void quoted(std::string_view text)
+    {
+        static const char hex[] = "0123456789abcdef";
+        m_block += '"';
+        for (char c : text) {
+            switch (c) {
+            case '"': m_block += "\\\""; break;
+            case '\\': m_block += "\\\\"; break;
+            case '\n': m_block += "\\n"; break;
+            case '\r': m_block += "\\r"; break;
+            case '\t': m_block += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    m_block += "\\u00";
+                    m_block += hex[(c >> 4) & 0xf];
+                    m_block += hex[c & 0xf];
+                }
+                else {
+                    m_block += c;
+                }
+            }
+        }
+        m_block += '"';
+    }
+
+    std::ostream & m_out;
+    bool m_pretty;
+    bool m_afterKey = false;
+    std::vector<bool> m_first; // one entry per open object or array
+    std::string m_block;
+};
+
+// base64 over a sequence of blocks, up to two bytes are carried to the next block
+class Base64Stream {
+public:
+    explicit Base64Stream(JsonStream & json) : m_json(json)
+    {
+    }
+    void write(const unsigned char * bytes, size_t size)
+    {
+        size_t i = 0;
+        while (m_carried > 0 && m_carried < 3 && i < size) {
+            m_carry[m_carried++] = bytes[i++];
+        }
+        if (m_carried == 3) {
+            encode(m_carry, 3);
+            m_carried = 0;
+        }
+        for (; i + 3 <= size; i += 3) {
+            encode(bytes + i, 3);
+        }
+        while (i < size) {
+            m_carry[m_carried++] = bytes[i++];
+        }
+    }
+    void finish()
+    {
+        if (m_carried > 0) {
+            encode(m_carry, m_carried);
+            m_carried = 0;
+        }
+    }
+
+private:
+    void encode(const unsigned char * bytes, int count)
+    {
+        static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        const uint32_t group = (bytes[0] << 16) | ((count > 1 ? bytes[1] : 0) << 8) | (count > 2 ? bytes[2] : 0);
+        char text[4] = {
+            alphabet[(group >> 18) & 0x3f],
+            alphabet[(group >> 12) & 0x3f],
+            count > 1 ? alphabet[(group >> 6) & 0x3f] : '=',
+            count > 2 ? alphabet[group & 0x3f] : '='
+        };
+        m_json.raw(std::string_view(text, 4));
+    }
+
+    JsonStream & m_json;
+    unsigned char m_carry[3] = {};
+    int m_carried = 0;
+};
+
+void writeValue(JsonStream & json, const tinygltf::Value & value)
+{
+    if (value.IsBool()) {
+        json.boolean(value.Get<bool>());
+    }
+    else if (value.IsInt()) {
+        json.integer(value.Get<int>());
+    }
+    else if (value.IsNumber()) {
+        json.number(value.GetNumberAsDouble());
+    }
+    else if (value.IsString()) {
+        json.string(value.Get<std::string>());
+    }
+    else if (value.IsArray()) {
+        json.beginArray();
+        for (size_t i = 0; i < value.ArrayLen(); ++i) {
+            writeValue(json, value.Get(static_cast<int>(i)));
+        }
+        json.endArray();
+    }
+    else if (value.IsObject()) {
+        json.beginObject();
+        for (const std::string & key : value.Keys()) {
+            json.key(key);
+            writeValue(json, value.Get(key));
+        }
+        json.endObject();
+    }
+    else {
+        json.null();
+    }
+}
+
+void writeExtrasAndExtensions(JsonStream & json, const tinygltf::Value & extras, const tinygltf::ExtensionMap & extensions)
+{
+    if (!extensions.empty()) {
+        json.key("extensions");
+        json.beginObject();
+        for (const auto & [name, extension] : extensions) {
+            json.key(name);
+            writeValue(json, extension);
+        }
+        json.endObject();
+    }
+    if (extras.Type() != tinygltf::NULL_TYPE) {
+        json.key("extras");
+        writeValue(json, extras);
+    }
+}
+
+void writeName(JsonStream & json, const std::string & name)
+{
+    if (!name.empty()) {
+        json.key("name");
+        json.string(name);
+    }
+}
+
+void writeIndex(JsonStream & json, std::string_view key, int index)
+{
+    if (index >= 0) {
+        json.key(key);
+        json.integer(index);
+    }
+}
+
+template <typename T> void writeNumbers(JsonStream & json, std::string_view key, const std::vector<T> & values)
+{
+    if (values.empty()) {
+        return;
+    }
+    json.key(key);
+    json.beginArray();
+    for (T value : values) {
+        if constexpr (std::is_integral_v<T>) {
+            json.integer(value);
+        }
+        else {
+            json.number(value);
+        }
+    }
+    json.endArray();
+}
+
+template <typename T, typename Write> void writeArray(JsonStream & json, std::string_view key, const std::vector<T> & items, Write write)
+{
+    if (items.empty()) {
+        return;
+    }
+    json.key(key);
+    json.beginArray();
+    for (const T & item : items) {
+        json.beginObject();
+        write(item);
+        json.endObject();
+    }
+    json.endArray();
+}
+
+// scaleKey is the scale of normal textures or the strength of occlusion textures
+void writeTextureInfo(JsonStream & json, std::string_view key, int index, int texCoord, std::string_view scaleKey = {}, double scale = 1.0)
+{
+    if (index < 0) {
+        return;
+    }
+    json.key(key);
+    json.beginObject();
+    json.key("index");
+    json.integer(index);
+    if (texCoord != 0) {
+        json.key("texCoord");
+        json.integer(texCoord);
+    }
+    if (!scaleKey.empty() && scale != 1.0) {
+        json.key(scaleKey);
+        json.number(scale);
+    }
+    json.endObject();
+}
+
+const char * accessorType(int type)
+{
+    switch (type) {
+    case TINYGLTF_TYPE_SCALAR: return "SCALAR";
+    case TINYGLTF_TYPE_VEC2: return "VEC2";
+    case TINYGLTF_TYPE_VEC3: return "VEC3";
+    case TINYGLTF_TYPE_VEC4: return "VEC4";
+    case TINYGLTF_TYPE_MAT2: return "MAT2";
+    case TINYGLTF_TYPE_MAT3: return "MAT3";
+    case TINYGLTF_TYPE_MAT4: return "MAT4";
+    default: return "";
+    }
+}
+
+void writeUint32(std::ostream & out, uint32_t value)
+{
+    const unsigned char bytes[4] = {
+        static_cast<unsigned char>(value), static_cast<unsigned char>(value >> 8),
+        static_cast<unsigned char>(value >> 16), static_cast<unsigned char>(value >> 24)
+    };
+    out.write(reinterpret_cast<const char *>(bytes), 4);
+}
+
+} // namespace
+
+IvGltfStreamWriter::IvGltfStreamWriter(const tinygltf::Model & model, IvGltfBufferBuilder & buffer)
+    : m_model(model), m_buffer(buffer)
+{
+}
+
+size_t IvGltfStreamWriter::bufferLength(size_t buffer) const
+{
+    return (buffer == 0 && !m_buffer.empty()) ? m_buffer.size() : m_model.buffers[buffer].data.size();
+}
+
+void IvGltfStreamWriter::writeJson(std::ostream & out, bool embedBuffer)
+{
+    JsonStream json(out, m_prettyPrint);
+    const tinygltf::Model & model = m_model;
+    json.beginObject();
+
+    json.key("asset");
+    json.beginObject();
+    json.key("version");
+    json.string(model.asset.version);
+    if (!model.asset.generator.empty()) {
+        json.key("generator");
+        json.string(model.asset.generator);
+    }
+    if (!model.asset.minVersion.empty()) {
+        json.key("minVersion");
+        json.string(model.asset.minVersion);
+    }
+    if (!model.asset.copyright.empty()) {
+        json.key("copyright");
+        json.string(model.asset.copyright);
+    }
+    writeExtrasAndExtensions(json, model.asset.extras, model.asset.extensions);
+    json.endObject();
+
+    for (const auto & [key, names] : { std::pair{ "extensionsUsed", &model.extensionsUsed }, std::pair{ "extensionsRequired", &model.extensionsRequired } }) {
+        if (!names->empty()) {
+            json.key(key);
+            json.beginArray();
+            for (const std::string & name : *names) {
+                json.string(name);
+            }
+            json.endArray();
+        }
+    }
+
+    if (model.defaultScene >= 0) {
+        writeIndex(json, "scene", model.defaultScene);
+    }
+    else if (!model.scenes.empty()) {
+        writeIndex(json, "scene", 0);
+    }
+    writeArray(json, "scenes", model.scenes, [&](const tinygltf::Scene & scene) {
+        writeName(json, scene.name);
+        writeNumbers(json, "nodes", scene.nodes);
+        writeExtrasAndExtensions(json, scene.extras, scene.extensions);
+    });
+
+    writeArray(json, "nodes", model.nodes, [&](const tinygltf::Node & node) {
+        writeName(json, node.name);
+        writeIndex(json, "mesh", node.mesh);
+        writeIndex(json, "camera", node.camera);
+        writeIndex(json, "skin", node.skin);
+        writeNumbers(json, "children", node.children);
+        writeNumbers(json, "matrix", node.matrix);
+        writeNumbers(json, "translation", node.translation);
+        writeNumbers(json, "rotation", node.rotation);
+        writeNumbers(json, "scale", node.scale);
+        writeNumbers(json, "weights", node.weights);
+        writeExtrasAndExtensions(json, node.extras, node.extensions);
+    });
+
+    writeArray(json, "meshes", model.meshes, [&](const tinygltf::Mesh & mesh) {
+        writeName(json, mesh.name);
+        writeArray(json, "primitives", mesh.primitives, [&](const tinygltf::Primitive & primitive) {
+            json.key("attributes");
+            json.beginObject();
+            for (const auto & [name, accessor] : primitive.attributes) {
+                json.key(name);
+                json.integer(accessor);
+            }
+            json.endObject();
+            writeIndex(json, "indices", primitive.indices);
+            writeIndex(json, "material", primitive.material);
+            writeIndex(json, "mode", primitive.mode);
+            if (!primitive.targets.empty()) {
+                json.key("targets");
+                json.beginArray();
+                for (const auto & target : primitive.targets) {
+                    json.beginObject();
+                    for (const auto & [name, accessor] : target) {
+                        json.key(name);
+                        json.integer(accessor);
+                    }
+                    json.endObject();
+                }
+                json.endArray();
+            }
+            writeExtrasAndExtensions(json, primitive.extras, primitive.extensions);
+        });
+        writeNumbers(json, "weights", mesh.weights);
+        writeExtrasAndExtensions(json, mesh.extras, mesh.extensions);
+    });
+
+    writeArray(json, "materials", model.materials, [&](const tinygltf::Material & material) {
+        writeName(json, material.name);
+        const tinygltf::PbrMetallicRoughness & pbr = material.pbrMetallicRoughness;
+        json.key("pbrMetallicRoughness");
+        json.beginObject();
+        if (pbr.baseColorFactor != std::vector<double>{ 1.0, 1.0, 1.0, 1.0 }) {
+            writeNumbers(json, "baseColorFactor", pbr.baseColorFactor);
+        }
+        writeTextureInfo(json, "baseColorTexture", pbr.baseColorTexture.index, pbr.baseColorTexture.texCoord);
+        if (pbr.metallicFactor != 1.0) {
+            json.key("metallicFactor");
+            json.number(pbr.metallicFactor);
+        }
+        if (pbr.roughnessFactor != 1.0) {
+            json.key("roughnessFactor");
+            json.number(pbr.roughnessFactor);
+        }
+        writeTextureInfo(json, "metallicRoughnessTexture", pbr.metallicRoughnessTexture.index, pbr.metallicRoughnessTexture.texCoord);
+        json.endObject();
+        writeTextureInfo(json, "normalTexture", material.normalTexture.index, material.normalTexture.texCoord, "scale", material.normalTexture.scale);
+        writeTextureInfo(json, "occlusionTexture", material.occlusionTexture.index, material.occlusionTexture.texCoord, "strength", material.occlusionTexture.strength);
+        writeTextureInfo(json, "emissiveTexture", material.emissiveTexture.index, material.emissiveTexture.texCoord);
+        if (material.emissiveFactor != std::vector<double>{ 0.0, 0.0, 0.0 }) {
+            writeNumbers(json, "emissiveFactor", material.emissiveFactor);
+        }
+        if (!material.alphaMode.empty() && material.alphaMode != "OPAQUE") {
+            json.key("alphaMode");
+            json.string(material.alphaMode);
+            if (material.alphaMode == "MASK") {
+                json.key("alphaCutoff");
+                json.number(material.alphaCutoff);
+            }
+        }
+        if (material.doubleSided) {
+            json.key("doubleSided");
+            json.boolean(true);
+        }
+        writeExtrasAndExtensions(json, material.extras, material.extensions);
+    });
+
+    writeArray(json, "textures", model.textures, [&](const tinygltf::Texture & texture) {
+        writeName(json, texture.name);
+        writeIndex(json, "source", texture.source);
+        writeIndex(json, "sampler", texture.sampler);
+        writeExtrasAndExtensions(json, texture.extras, texture.extensions);
+    });
+
+    writeArray(json, "images", model.images, [&](const tinygltf::Image & image) {
+        writeName(json, image.name);
+        if (image.bufferView >= 0) {
+            writeIndex(json, "bufferView", image.bufferView);
+        }
+        else if (!image.uri.empty()) {
+            json.key("uri");
+            json.string(image.uri);
+        }
+        if (!image.mimeType.empty()) {
+            json.key("mimeType");
+            json.string(image.mimeType);
+        }
+        writeExtrasAndExtensions(json, image.extras, image.extensions);
+    });
+
+    writeArray(json, "samplers", model.samplers, [&](const tinygltf::Sampler & sampler) {
+        writeName(json, sampler.name);
+        writeIndex(json, "magFilter", sampler.magFilter);
+        writeIndex(json, "minFilter", sampler.minFilter);
+        writeIndex(json, "wrapS", sampler.wrapS);
+        writeIndex(json, "wrapT", sampler.wrapT);
+        if (sampler.extras.Type() != tinygltf::NULL_TYPE) {
+            json.key("extras");
+            writeValue(json, sampler.extras);
+        }
+    });
+
+    writeArray(json, "accessors", model.accessors, [&](const tinygltf::Accessor & accessor) {
+        writeName(json, accessor.name);
+        writeIndex(json, "bufferView", accessor.bufferView);
+        if (accessor.byteOffset != 0) {
+            json.key("byteOffset");
+            json.integer(accessor.byteOffset);
+        }
+        json.key("componentType");
+        json.integer(accessor.componentType);
+        if (accessor.normalized) {
+            json.key("normalized");
+            json.boolean(true);
+        }
+        json.key("count");
+        json.integer(accessor.count);
+        json.key("type");
+        json.string(accessorType(accessor.type));
+        writeNumbers(json, "min", accessor.minValues);
+        writeNumbers(json, "max", accessor.maxValues);
+        writeExtrasAndExtensions(json, accessor.extras, accessor.extensions);
+    });
+
+    writeArray(json, "bufferViews", model.bufferViews, [&](const tinygltf::BufferView & bufferView) {
+        writeName(json, bufferView.name);
+        json.key("buffer");
+        json.integer(bufferView.buffer);
+        if (bufferView.byteOffset != 0) {
+            json.key("byteOffset");
+            json.integer(bufferView.byteOffset);
+        }
+        json.key("byteLength");
+        json.integer(bufferView.byteLength);
+        if (bufferView.byteStride != 0) {
+            json.key("byteStride");
+            json.integer(bufferView.byteStride);
+        }
+        if (bufferView.target != 0) {
+            json.key("target");
+            json.integer(bufferView.target);
+        }
+        writeExtrasAndExtensions(json, bufferView.extras, bufferView.extensions);
+    });
+
+    if (!model.buffers.empty()) {
+        json.key("buffers");
+        json.beginArray();
+        for (size_t i = 0; i < model.buffers.size(); ++i) {
+            const tinygltf::Buffer & buffer = model.buffers[i];
+            json.beginObject();
+            writeName(json, buffer.name);
+            json.key("byteLength");
+            json.integer(bufferLength(i));
+            if (!buffer.uri.empty()) {
+                json.key("uri");
+                json.string(buffer.uri);
+            }
+            else if (i > 0 || embedBuffer) {
+                // .gltf files and additional buffers of .glb files get a data uri
+                json.key("uri");
+                json.beginRaw();
+                json.raw("\"data:application/octet-stream;base64,");
+                Base64Stream base64(json);
+                if (i == 0 && !m_buffer.empty()) {
+                    m_buffer.stream([&base64](const unsigned char * bytes, size_t size) {
+                        base64.write(bytes, size);
+                    });
+                }
+                else {
+                    base64.write(buffer.data.data(), buffer.data.size());
+                }
+                base64.finish();
+                json.raw("\"");
+            }
+            writeExtrasAndExtensions(json, buffer.extras, buffer.extensions);
+            json.endObject();
+        }
+        json.endArray();
+    }
+
+    writeExtrasAndExtensions(json, model.extras, model.extensions);
+    json.endObject();
+    if (m_prettyPrint) {
+        json.raw("\n");
+    }
+}
+
+bool IvGltfStreamWriter::write(const std::string & filename, bool binary)
+{
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) {
+        return false;
+    }
+    if (!binary) {
+        writeJson(out, true);
+        return static_cast<bool>(out);
+    }
+
+    // the header and the chunk lengths are patched when the sizes are known
+    constexpr uint32_t glb_magic = 0x46546C67;
+    constexpr uint32_t json_chunk = 0x4E4F534A;
+    constexpr uint32_t bin_chunk = 0x004E4942;
+    writeUint32(out, glb_magic);
+    writeUint32(out, 2);
+    writeUint32(out, 0);
+    writeUint32(out, 0);
+    writeUint32(out, json_chunk);
+
+    const std::streamoff jsonStart = out.tellp();
+    writeJson(out, false);
+    std::streamoff jsonLength = out.tellp() - jsonStart;
+    for (; jsonLength % 4 != 0; ++jsonLength) {
+        out.put(' ');
+    }
+
+    std::streamoff binLength = 0;
+    const bool hasBinChunk = !m_model.buffers.empty() && m_model.buffers[0].uri.empty();
+    if (hasBinChunk) {
+        binLength = (bufferLength(0) + 3) / 4 * 4;
+        writeUint32(out, static_cast<uint32_t>(binLength));
+        writeUint32(out, bin_chunk);
+        size_t written = 0;
+        auto writeBytes = [&out, &written](const unsigned char * bytes, size_t size) {
+            out.write(reinterpret_cast<const char *>(bytes), size);
+            written += size;
+        };
+        if (!m_buffer.empty()) {
+            m_buffer.stream(writeBytes);
+        }
+        else {
+            writeBytes(m_model.buffers[0].data.data(), m_model.buffers[0].data.size());
+        }
+        for (; written % 4 != 0; ++written) {
+            out.put('\0');
+        }
+    }
+
+    const std::streamoff totalLength = 12 + 8 + jsonLength + (hasBinChunk ? 8 + binLength : 0);
+    out.seekp(8);
+    writeUint32(out, static_cast<uint32_t>(totalLength));
+    writeUint32(out, static_cast<uint32_t>(jsonLength));
+    return static_cast<bool>(out);
+}
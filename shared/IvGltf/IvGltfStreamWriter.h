@@ -0,0 +1,31 @@
+#pragma once 
+#include "IvGltf.h"
+#include "IvGltfBuffer.h"
+#include "tiny_gltf.h"
+#include <ostream>
+#include <string>
+
+// writes a model as .gltf or .glb without building a json document first. the json is
+// formatted straight into the file and the data of buffer 0 is taken from the buffer builder,
+// embedded as a data uri in .gltf files and as the binary chunk in .glb files.
+class IVGLTF_EXPORT IvGltfStreamWriter {
+public:
+    IvGltfStreamWriter(const tinygltf::Model & model, IvGltfBufferBuilder & buffer);
+
+    // compact output is the default
+    void setPrettyPrint(bool prettyPrint)
+    {
+        m_prettyPrint = prettyPrint;
+    }
+
+    // releases the chunks of the buffer builder, so a model can be written only once
+    bool write(const std::string & filename, bool binary);
+    void writeJson(std::ostream & out, bool embedBuffer);
+
+private:
+    size_t bufferLength(size_t buffer) const;
+
+    const tinygltf::Model & m_model;
+    IvGltfBufferBuilder & m_buffer;
+    bool m_prettyPrint = false;
+};
@@ -0,0 +1,101 @@
+#include "IvGltfTextureAtlas.h"
+
+#include <algorithm>
+#include <numeric>
+
+IvGltfTextureAtlas::IvGltfTextureAtlas(int pageSize, int padding)
+    : m_pageSize(pageSize), m_padding(padding)
+{
+}
+
+bool IvGltfTextureAtlas::pack(const std::vector<const IvGltfImage *> & images)
+{
+    m_images = images;
+    m_placements.assign(images.size(), Placement());
+    m_pages.clear();
+
+    std::vector<size_t> order(images.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&images](size_t a, size_t b) {
+        return images[a]->height > images[b]->height;
+    });
+
+    for (size_t imageIndex : order) {
+        const int width = images[imageIndex]->width + 2 * m_padding;
+        const int height = images[imageIndex]->height + 2 * m_padding;
+        if (width > m_pageSize || height > m_pageSize) {
+            m_pages.clear();
+            return false;
+        }
+        if (!place(imageIndex, width, height)) {
+            m_pages.push_back(Page());
+            place(imageIndex, width, height);
+        }
+    }
+    return true;
+}
+
+// first fit into the shelves of all pages, opening a new shelf on the first page with room
+bool IvGltfTextureAtlas::place(size_t imageIndex, int width, int height)
+{
+    for (size_t pageIndex = 0; pageIndex < m_pages.size(); ++pageIndex) {
+        Page & page = m_pages[pageIndex];
+        Shelf * target = nullptr;
+        for (Shelf & shelf : page.shelves) {
+            if (shelf.height >= height && shelf.used + width <= m_pageSize) {
+                target = &shelf;
+                break;
+            }
+        }
+        if (!target && page.height + height <= m_pageSize) {
+            page.shelves.push_back({ page.height, height, 0 });
+            page.height += height;
+            target = &page.shelves.back();
+        }
+        if (target) {
+            m_placements[imageIndex] = { pageIndex, target->used + m_padding, target->y + m_padding };
+            target->used += width;
+            page.width = std::max(page.width, target->used);
+            return true;
+        }
+    }
+    return false;
+}
+
+IvGltfImage IvGltfTextureAtlas::composePage(size_t page) const
+{
+    bool hasColor = false;
+    bool hasAlpha = false;
+    for (size_t imageIndex = 0; imageIndex < m_images.size(); ++imageIndex) {
+        if (m_placements[imageIndex].page == page) {
+            hasColor |= m_images[imageIndex]->components >= 3;
+            hasAlpha |= m_images[imageIndex]->hasAlpha();
+        }
+    }
+
+    IvGltfImage result(m_pages.at(page).width, m_pages.at(page).height, (hasColor ? 3 : 1) + (hasAlpha ? 1 : 0));
+    for (size_t imageIndex = 0; imageIndex < m_images.size(); ++imageIndex) {
+        const Placement & placement = m_placements[imageIndex];
+        if (placement.page != page) {
+            continue;
+        }
+        const IvGltfImage & image = *m_images[imageIndex];
+        for (int y = -m_padding; y < image.height + m_padding; ++y) {
+            const int sourceY = std::clamp(y, 0, image.height - 1);
+            for (int x = -m_padding; x < image.width + m_padding; ++x) {
+                const int sourceX = std::clamp(x, 0, image.width - 1);
+                result.setPixel(placement.x + x, placement.y + y, image.pixel(sourceX, sourceY), image.components);
+            }
+        }
+    }
+    return result;
+}
+
+void IvGltfTextureAtlas::mapTexCoord(size_t imageIndex, float & u, float & v) const
+{
+    const Placement & placement = m_placements.at(imageIndex);
+    const IvGltfImage & image = *m_images[imageIndex];
+    const Page & page = m_pages[placement.page];
+    u = (placement.x + u * image.width) / page.width;
+    v = (placement.y + v * image.height) / page.height;
+}
@@ -0,0 +1,52 @@
+#pragma once 
+#include "IvGltf.h"
+#include "IvGltfImage.h"
+#include <vector>
+
+// packs small images into a few large atlas pages with a shelf packer. every image gets a
+// border of replicated edge pixels so filtering does not bleed into its neighbours.
+class IVGLTF_EXPORT IvGltfTextureAtlas {
+public:
+    struct Placement {
+        size_t page = 0;
+        int x = 0;
+        int y = 0;
+    };
+
+    IvGltfTextureAtlas(int pageSize, int padding);
+
+    // packs the images tallest first. returns false if an image does not fit on a page,
+    // in which case nothing is packed. the images must outlive the atlas.
+    bool pack(const std::vector<const IvGltfImage *> & images);
+
+    size_t pageCount() const
+    {
+        return m_pages.size();
+    }
+    const Placement & placement(size_t imageIndex) const
+    {
+        return m_placements.at(imageIndex);
+    }
+    IvGltfImage composePage(size_t page) const;
+    // maps a texture coordinate in [0, 1] of the given image to the coordinate in its page
+    void mapTexCoord(size_t imageIndex, float & u, float & v) const;
+
+private:
+    struct Shelf {
+        int y;
+        int height;
+        int used;
+    };
+    struct Page {
+        std::vector<Shelf> shelves;
+        int width = 0;
+        int height = 0;
+    };
+    bool place(size_t imageIndex, int width, int height);
+
+    int m_pageSize;
+    int m_padding;
+    std::vector<const IvGltfImage *> m_images;
+    std::vector<Placement> m_placements;
+    std::vector<Page> m_pages;
+};
@@ -1,17 +1,38 @@
 
 #include "IvGltfWriter.h"
 
+#include "IvGltfStreamWriter.h"
+#include "IvGltfTextureAtlas.h"
 #include "tiny_gltf.h"
 #include <sstream>
 #include <iostream>
 
 #include <Inventor/nodes/SoSeparator.h>
 #include <Inventor/nodes/SoShape.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/nodes/SoCylinder.h>
+#include <Inventor/nodes/SoCone.h>
+#include <Inventor/nodes/SoText3.h>
+#include <Inventor/nodes/SoNurbsSurface.h>
+#include <Inventor/nodes/SoIndexedNurbsSurface.h>
+#include <Inventor/nodes/SoNurbsCurve.h>
+#include <Inventor/nodes/SoIndexedNurbsCurve.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoDrawStyle.h>
+#include <Inventor/nodes/SoVertexShape.h>
+#include <Inventor/nodes/SoTexture2.h>
+#include <Inventor/nodes/SoFile.h>
+#include <Inventor/nodes/SoWWWInline.h>
+#include <Inventor/misc/SoChildList.h>
+#include <Inventor/elements/SoComplexityElement.h>
+#include <Inventor/elements/SoComplexityTypeElement.h>
 #include <Inventor/SoPrimitiveVertex.h>
-#ifdef _WIN32
-#define strerror_r(errno,buf,len) strerror_s(buf,len,errno)
-#endif 
-#include <png++/png.hpp>
+#include <Inventor/SbBox3f.h>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <limits>
+#include <thread>
 
 IvGltfWriter::IvGltfWriter(SoSeparator * root): m_root(root)
 {
@@ -22,6 +43,8 @@ IvGltfWriter::IvGltfWriter(SoSeparator * root): m_root(root)
     m_action->addPostCallback(SoShape::getClassTypeId(), postShapeCB, this);    
     m_action->addTriangleCallback(SoShape::getClassTypeId(), triangle_cb, this);    
     m_action->addLineSegmentCallback(SoShape::getClassTypeId(), line_cb, this);
+    m_action->addPreCallback(SoFile::getClassTypeId(), preFileCB, this);
+    m_action->addPreCallback(SoWWWInline::getClassTypeId(), preFileCB, this);
 }
 
 IvGltfWriter::~IvGltfWriter()
@@ -29,33 +52,47 @@ IvGltfWriter::~IvGltfWriter()
     if (m_root) {
         m_root->unref();
     }
+    releaseExternalFiles();
     delete (m_action);
 }
 
 
 
-template <typename T> uint32_t serialize(std::vector<T> const & from, std::vector<uint8_t> & to, std::size_t offset)
-{
-    if (from.empty()) {
-        return 0;
-    }
-    uint32_t bytesToSerialize = sizeof(T) * static_cast<uint32_t>(from.size());
-
-    to.resize(to.size() + bytesToSerialize);
-    std::memcpy(&to[offset], &from[0], bytesToSerialize);
-
-    return bytesToSerialize;
-}
-
 bool IvGltfWriter::write(std::string outputFilename)
 {
     if (!m_root) {
         return false; 
     } 
 
-    
+    convert();
+    if (!writeExternalFiles(outputFilename)) {
+        return false;
+    }
+    return save(outputFilename);
+}
+
+void IvGltfWriter::convert()
+{
+    // every conversion starts from an empty model, the buffer chunks are released while writing
+    m_model = tinygltf::Model();
+    m_scene = tinygltf::Scene();
+    m_buffer = IvGltfBufferBuilder();
+    m_materialIndexByMatInfo.clear();
+    m_materialIndexByImage.clear();
+    m_localBoxes.clear();
+    releaseExternalFiles();
+    computeComplexityBudget();
+    m_budgetShapeIndex = 0;
 
     m_action->apply(m_root);
+    buildTextureAtlases();
+    finishTextures();
+    if (!m_buffer.empty()) {
+        // the data is streamed from m_buffer by the stream writer
+        tinygltf::Buffer buffer;
+        buffer.name = "buffer";
+        m_model.buffers.push_back(buffer);
+    }
 
     // asset info
     tinygltf::Asset asset;
@@ -66,23 +103,177 @@ bool IvGltfWriter::write(std::string outputFilename)
     
     // add scene 
     m_model.scenes.push_back(m_scene);
-    
-    // Save it to a file
-    tinygltf::TinyGLTF gltf;
-    return gltf.WriteGltfSceneToFile(
-            &m_model,
-            outputFilename,
-            true,   // embedImages
-            true,   // embedBuffers
-            true,   // pretty print
-            m_writeBinary); // write binary
+}
+
+bool IvGltfWriter::save(const std::string & outputFilename)
+{
+    IvGltfStreamWriter writer(m_model, m_buffer);
+    writer.setPrettyPrint(m_prettyPrint);
+    return writer.write(outputFilename, m_writeBinary);
+}
+
+void IvGltfWriter::copySettings(const IvGltfWriter & other)
+{
+    m_prettyPrint = other.m_prettyPrint;
+    m_complexityOverrides = other.m_complexityOverrides;
+    m_maxComplexities = other.m_maxComplexities;
+    m_triangleBudget = other.m_triangleBudget;
+    m_cullInvisible = other.m_cullInvisible;
+    m_minimumShapeSize = other.m_minimumShapeSize;
+    m_atlasMaxTextureSize = other.m_atlasMaxTextureSize;
+    m_atlasPageSize = other.m_atlasPageSize;
+    m_maxTextureSize = other.m_maxTextureSize;
+    m_maxMipLevels = other.m_maxMipLevels;
+    m_powerOfTwoTextures = other.m_powerOfTwoTextures;
+    m_textureFilter = other.m_textureFilter;
+    m_imageEncoding = other.m_imageEncoding;
+    m_jpegQuality = other.m_jpegQuality;
+}
+
+// coin is not thread safe, so the files are tessellated one after the other. writing a file
+// runs in the background while the next one is tessellated, the texture encoding of all files
+// runs in parallel anyway.
+bool IvGltfWriter::writeExternalFiles(const std::string & outputFilename)
+{
+    if (m_externalFiles.empty()) {
+        return true;
+    }
+
+    const std::filesystem::path directory = std::filesystem::path(outputFilename).parent_path();
+    std::vector<std::unique_ptr<IvGltfWriter>> writers;
+    std::vector<std::future<bool>> saved;
+    for (const ExternalFile & external : m_externalFiles) {
+        const std::filesystem::path path = directory / external.uri;
+        if (path.has_parent_path()) {
+            std::error_code error;
+            std::filesystem::create_directories(path.parent_path(), error);
+        }
+
+        // files referenced from the external file are inlined there
+        auto writer = std::make_unique<IvGltfWriter>(external.root);
+        writer->copySettings(*this);
+        writer->setWriteBinary(true);
+        writer->convert();
+        IvGltfWriter * w = writer.get();
+        saved.push_back(std::async(std::launch::async, [w, path]() {
+            return w->save(path.string());
+        }));
+        writers.push_back(std::move(writer));
+    }
+
+    bool success = true;
+    for (auto & result : saved) {
+        success = result.get() && success;
+    }
+    return success;
+}
+
+void IvGltfWriter::releaseExternalFiles()
+{
+    for (const ExternalFile & external : m_externalFiles) {
+        external.root->unref();
+    }
+    m_externalFiles.clear();
+    m_externalIndexByName.clear();
+}
+
+std::string IvGltfWriter::externalUri(const std::string & name) const
+{
+    std::string stem = std::filesystem::path(name).stem().string();
+    if (stem.empty()) {
+        stem = "file";
+    }
+    const std::filesystem::path directory(m_externalDirectory);
+    std::string uri = (directory / (stem + ".glb")).generic_string();
+    for (int suffix = 1; std::any_of(m_externalFiles.begin(), m_externalFiles.end(), [&uri](const ExternalFile & external) { return external.uri == uri; }); ++suffix) {
+        uri = (directory / (stem + "_" + std::to_string(suffix) + ".glb")).generic_string();
+    }
+    return uri;
+}
+
+SoCallbackAction::Response IvGltfWriter::preFileCB(void * userdata, SoCallbackAction * action, const SoNode * node)
+{
+    IvGltfWriter * that = (IvGltfWriter *)userdata;
+    return that->onPreFile(action, node);
+}
 
+SoCallbackAction::Response IvGltfWriter::pruneFileCB(void * userdata, SoCallbackAction *, const SoNode *)
+{
+    IvGltfWriter * that = (IvGltfWriter *)userdata;
+    return that->m_exportExternalFiles ? SoCallbackAction::PRUNE : SoCallbackAction::CONTINUE;
+}
+
+// every distinct file is converted once, each reference becomes a node with the reference's
+// transformation and the uri of the converted file in its extras
+SoCallbackAction::Response IvGltfWriter::onPreFile(SoCallbackAction * action, const SoNode * node)
+{
+    if (!m_exportExternalFiles) {
+        return SoCallbackAction::CONTINUE;
+    }
+
+    std::string name;
+    const SoFile * file = nullptr;
+    SoNode * inlineData = nullptr;
+    if (node->isOfType(SoFile::getClassTypeId())) {
+        file = static_cast<const SoFile *>(node);
+        name = file->name.getValue().getString();
+    }
+    else {
+        const SoWWWInline * inlineNode = static_cast<const SoWWWInline *>(node);
+        name = inlineNode->name.getValue().getString();
+        inlineData = inlineNode->getChildData();
+        if (!inlineData) {
+            return SoCallbackAction::CONTINUE;
+        }
+    }
+    if (name.empty()) {
+        return SoCallbackAction::CONTINUE;
+    }
+
+    auto it = m_externalIndexByName.find(name);
+    if (it == m_externalIndexByName.end()) {
+        SoSeparator * root = new SoSeparator;
+        root->ref();
+        if (file) {
+            const SoChildList * children = file->getChildren();
+            for (int i = 0; children && i < children->getLength(); ++i) {
+                root->addChild((*children)[i]);
+            }
+        }
+        else {
+            root->addChild(inlineData);
+        }
+        m_externalFiles.push_back({ externalUri(name), root });
+        it = m_externalIndexByName.emplace(name, m_externalFiles.size() - 1).first;
+    }
+
+    tinygltf::Node gltfNode;
+    gltfNode.name = name;
+    const SbMatrix & matrix = action->getModelMatrix();
+    if (!(matrix == SbMatrix::identity())) {
+        // SbMatrix rows are the columns of the gltf matrix
+        for (int row = 0; row < 4; ++row) {
+            for (int column = 0; column < 4; ++column) {
+                gltfNode.matrix.push_back(matrix[row][column]);
+            }
+        }
+    }
+    tinygltf::Value::Object extras;
+    extras["uri"] = tinygltf::Value(m_externalFiles[it->second].uri);
+    gltfNode.extras = tinygltf::Value(extras);
+    m_model.nodes.push_back(gltfNode);
+    m_scene.nodes.push_back(m_model.nodes.size() - 1);
+    return SoCallbackAction::PRUNE;
 }
 
 
 SoCallbackAction::Response IvGltfWriter::onPreShape(SoCallbackAction * action, const SoNode * node)
 {
-    m_buffer.data.clear();
+    m_shapeCulled = isCulled(action, node);
+    if (m_shapeCulled) {
+        return SoCallbackAction::PRUNE;
+    }
+
     m_indices.clear();
     m_positions.clear();
     m_normals.clear();
@@ -93,6 +284,7 @@ SoCallbackAction::Response IvGltfWriter::onPreShape(SoCallbackAction * action, c
     m_uvMax = { fmin, fmin };
     m_posMin = { fmax, fmax, fmax };
     m_posMax = { fmin, fmin, fmin };
+    applyComplexity(action, node);
     return SoCallbackAction::CONTINUE;
 }
 
@@ -103,14 +295,22 @@ std::string materialHash(SbColor ambient, SbColor diffuse, SbColor specular, SbC
 }
 SoCallbackAction::Response IvGltfWriter::onPostShape(SoCallbackAction * action, const SoNode * ivNode)
 {
-    // write buffers vbo 
-    uint32_t currentOffset = 0;// m_buffer.data.size();
-    uint32_t indexSize = serialize(m_indices, m_buffer.data, currentOffset+0);
-    uint32_t positionSize = serialize(m_positions, m_buffer.data, currentOffset + indexSize);
-    uint32_t normalSize = serialize(m_normals, m_buffer.data, currentOffset + indexSize + positionSize);
-    uint32_t uvSize = serialize(m_texCoords, m_buffer.data, currentOffset + indexSize + positionSize + normalSize);    
-    m_model.buffers.push_back(m_buffer);
-    int currBufIdx = m_model.buffers.size() - 1;
+    if (m_shapeCulled) {
+        m_shapeCulled = false;
+        return SoCallbackAction::CONTINUE;
+    }
+    restoreComplexity(action);
+
+    // write buffers vbo, the vectors are moved into the buffer
+    const size_t indexCount = m_indices.size();
+    const size_t positionCount = m_positions.size();
+    const size_t normalCount = m_normals.size();
+    const size_t uvCount = m_texCoords.size();
+    const size_t indexOffset = m_buffer.append(std::move(m_indices));
+    const size_t positionOffset = m_buffer.append(std::move(m_positions));
+    const size_t normalOffset = m_buffer.append(std::move(m_normals));
+    const size_t uvOffset = m_buffer.append(std::move(m_texCoords));
+    const int currBufIdx = 0;
 
     // write texure image buffer 
     int imgSize = 0;
@@ -126,58 +326,12 @@ SoCallbackAction::Response IvGltfWriter::onPostShape(SoCallbackAction * action,
     uint32_t materialIdx = -1;
 
 
+    bool useAtlas = false;
     if (imgSize > 0) {
-        png::image< png::rgb_pixel > image(size[0], size[1]);
-        for (png::uint_32 y = 0; y < image.get_height(); ++y)
-        {
-            for (png::uint_32 x = 0; x < image.get_width(); ++x)
-            {
-                const unsigned char* d = ivImg + (y * size[0] + x) * nc;
-                image.set_pixel(x, y, png::rgb_pixel(d[0], d[1], d[2]));
-            }
+        useAtlas = fitsTextureAtlas(size, uvCount);
+        if (!useAtlas) {
+            materialIdx = texturedMaterial(ivImg, size, nc, action->getTextureWrapS(), action->getTextureWrapT());
         }
-        
-        std::ostringstream sout; 
-        image.write_stream(sout);
-        //image.write(std::string("testout.png"));
-        tinygltf::Buffer imgBuffer;
-        std::string s = sout.str();
-        std::vector<unsigned char> data(s.begin(), s.end());
-        
-        imgBuffer.data = data;
-        imgBuffer.name = "imageBuffer";
-        m_model.buffers.push_back(imgBuffer);
-
-        tinygltf::BufferView bufferView;
-        bufferView.buffer = m_model.buffers.size() - 1;
-        bufferView.name = "imageBufferView";
-        bufferView.byteLength = imgBuffer.data.size();
-        m_model.bufferViews.push_back(bufferView);
-
-
-        tinygltf::Image img;
-        img.name = "image";
-        img.mimeType = "image/png";
-        img.bufferView = m_model.bufferViews.size() - 1; 
-        // img.uri = "test.png";
-        m_model.images.push_back(img);
-
-        tinygltf::Sampler sampler;
-        sampler.wrapS = action->getTextureWrapS();
-        sampler.wrapT = action->getTextureWrapT();
-        m_model.samplers.push_back(sampler);
-
-        tinygltf::Texture texture;
-        texture.source = 0;
-        texture.sampler = 0;
-        m_model.textures.push_back(texture);
-
-        tinygltf::Material texmat;
-        texmat.pbrMetallicRoughness.baseColorTexture.index = 0;
-        texmat.pbrMetallicRoughness.metallicFactor = 0.0;
-        texmat.name = "Texture";
-        m_model.materials.push_back(texmat);
-        materialIdx = m_model.materials.size() - 1;
     }
     else {
         std::string matHash = materialHash(ambient, diffuse, specular, emission, shininess, transparency);
@@ -209,8 +363,8 @@ SoCallbackAction::Response IvGltfWriter::onPostShape(SoCallbackAction * action,
         // Build the "views" into the "buffer"
         tinygltf::BufferView indexBufferView{};
         indexBufferView.buffer = currBufIdx;
-        indexBufferView.byteLength = indexSize;
-        indexBufferView.byteOffset = currentOffset + 0;
+        indexBufferView.byteLength = indexCount * sizeof(uint32_t);
+        indexBufferView.byteOffset = indexOffset;
         indexBufferView.target = TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER;
 
         m_model.bufferViews.push_back(indexBufferView);
@@ -218,10 +372,10 @@ SoCallbackAction::Response IvGltfWriter::onPostShape(SoCallbackAction * action,
         tinygltf::Accessor indexAccessor{};
         indexAccessor.bufferView = bufIdx++;
         indexAccessor.componentType = TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT;
-        indexAccessor.count = static_cast<uint32_t>(m_indices.size());
+        indexAccessor.count = static_cast<uint32_t>(indexCount);
         indexAccessor.type = TINYGLTF_TYPE_SCALAR;
         indexAccessor.minValues = { 0 };
-        indexAccessor.maxValues = { (float)m_positions.size() - 1 };
+        indexAccessor.maxValues = { (float)positionCount - 1 };
         m_model.accessors.push_back(indexAccessor);
         triMeshPrim.indices = accessorIdx++;                    // accessor 0
 
@@ -230,8 +384,8 @@ SoCallbackAction::Response IvGltfWriter::onPostShape(SoCallbackAction * action,
 
         tinygltf::BufferView positionBufferView{};
         positionBufferView.buffer = currBufIdx;
-        positionBufferView.byteLength = positionSize;
-        positionBufferView.byteOffset = currentOffset + indexSize;
+        positionBufferView.byteLength = positionCount * sizeof(vec3);
+        positionBufferView.byteOffset = positionOffset;
         positionBufferView.target = TINYGLTF_TARGET_ARRAY_BUFFER;
 
         m_model.bufferViews.push_back(positionBufferView);
@@ -239,7 +393,7 @@ SoCallbackAction::Response IvGltfWriter::onPostShape(SoCallbackAction * action,
         tinygltf::Accessor positionAccessor{};
         positionAccessor.bufferView = bufIdx++;
         positionAccessor.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
-        positionAccessor.count = static_cast<uint32_t>(m_positions.size());
+        positionAccessor.count = static_cast<uint32_t>(positionCount);
         positionAccessor.type = TINYGLTF_TYPE_VEC3;
         positionAccessor.minValues = { m_posMin.x, m_posMin.y, m_posMin.z };
         positionAccessor.maxValues = { m_posMax.x, m_posMax.y, m_posMax.z };
@@ -247,11 +401,11 @@ SoCallbackAction::Response IvGltfWriter::onPostShape(SoCallbackAction * action,
         triMeshPrim.attributes["POSITION"] = accessorIdx++;   // accessor 1
 
     }
-    if (!m_normals.empty()) {
+    if (normalCount > 0) {
         tinygltf::BufferView normalBufferView{};
         normalBufferView.buffer = currBufIdx;
-        normalBufferView.byteLength = normalSize;
-        normalBufferView.byteOffset = currentOffset + indexSize + positionSize;
+        normalBufferView.byteLength = normalCount * sizeof(vec3);
+        normalBufferView.byteOffset = normalOffset;
         normalBufferView.target = TINYGLTF_TARGET_ARRAY_BUFFER;
 
         m_model.bufferViews.push_back(normalBufferView);
@@ -259,7 +413,7 @@ SoCallbackAction::Response IvGltfWriter::onPostShape(SoCallbackAction * action,
         tinygltf::Accessor normalAccessor{};
         normalAccessor.bufferView = bufIdx++;
         normalAccessor.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
-        normalAccessor.count = static_cast<uint32_t>(m_normals.size());
+        normalAccessor.count = static_cast<uint32_t>(normalCount);
         normalAccessor.type = TINYGLTF_TYPE_VEC3;
         normalAccessor.minValues = { -1, -1, -1 };
         normalAccessor.maxValues = { 1, 1, 1 };
@@ -268,23 +422,26 @@ SoCallbackAction::Response IvGltfWriter::onPostShape(SoCallbackAction * action,
 
 
     }
-    if (!m_texCoords.empty()) {
+    if (uvCount > 0) {
         tinygltf::BufferView uvBufferView{};
         uvBufferView.buffer = currBufIdx;
-        uvBufferView.byteLength = uvSize;
-        uvBufferView.byteOffset = currentOffset + indexSize + positionSize + normalSize;
+        uvBufferView.byteLength = uvCount * sizeof(uv);
+        uvBufferView.byteOffset = uvOffset;
         uvBufferView.target = TINYGLTF_TARGET_ARRAY_BUFFER;
         m_model.bufferViews.push_back(uvBufferView);
 
         tinygltf::Accessor uvAccessor{};
         uvAccessor.bufferView = bufIdx++;
         uvAccessor.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
-        uvAccessor.count = static_cast<uint32_t>(m_texCoords.size());
+        uvAccessor.count = static_cast<uint32_t>(uvCount);
         uvAccessor.type = TINYGLTF_TYPE_VEC2;
         uvAccessor.minValues = { m_uvMin.u, m_uvMin.v };
         uvAccessor.maxValues = { m_uvMax.u, m_uvMax.v };
         m_model.accessors.push_back(uvAccessor);
 
+        if (useAtlas) {
+            m_atlasShapes.push_back({ atlasImage(ivImg, size, nc), accessorIdx, m_model.meshes.size() });
+        }
         triMeshPrim.attributes["TEXCOORD_0"] = accessorIdx++; // accessor 3
 
     }
@@ -337,6 +494,474 @@ SoCallbackAction::Response IvGltfWriter::postShapeCB(void * userdata, SoCallback
     return that->onPostShape(action, node);    
 }
 
+static int nearestPowerOfTwo(int size)
+{
+    int power = 1;
+    while (power * 2 <= size) {
+        power *= 2;
+    }
+    return (size - power < power * 2 - size) ? power : power * 2;
+}
+
+// scales the image down to the maximum texture size keeping its aspect ratio and optionally
+// rounds both dimensions to the nearest power of two that does not exceed the maximum
+void IvGltfWriter::textureSize(int width, int height, int & targetWidth, int & targetHeight) const
+{
+    // a full mip chain of n levels starts at 2^(n - 1) pixels
+    int maxSize = m_maxTextureSize;
+    if (m_maxMipLevels > 0) {
+        const int mipSize = 1 << std::min(m_maxMipLevels - 1, 30);
+        maxSize = maxSize > 0 ? std::min(maxSize, mipSize) : mipSize;
+    }
+
+    const int largest = std::max(width, height);
+    const float scale = (maxSize > 0 && largest > maxSize) ? static_cast<float>(maxSize) / largest : 1.0f;
+    targetWidth = std::max(1, static_cast<int>(std::lround(width * scale)));
+    targetHeight = std::max(1, static_cast<int>(std::lround(height * scale)));
+    if (m_powerOfTwoTextures) {
+        targetWidth = nearestPowerOfTwo(targetWidth);
+        targetHeight = nearestPowerOfTwo(targetHeight);
+        while (maxSize > 0 && targetWidth > maxSize) {
+            targetWidth /= 2;
+        }
+        while (maxSize > 0 && targetHeight > maxSize) {
+            targetHeight /= 2;
+        }
+    }
+}
+
+// the image is resampled and encoded on a worker thread while the traversal goes on, the
+// encoded bytes are collected in finishTextures. the number of textures in flight is limited
+// to the number of cores so the uncompressed images do not pile up.
+int IvGltfWriter::addTexture(IvGltfImage image, int wrapS, int wrapT)
+{
+    const size_t maxPending = std::max(1u, std::thread::hardware_concurrency());
+    while (m_pendingTextures.size() - m_finishedTextures >= maxPending) {
+        finishTexture(m_pendingTextures[m_finishedTextures++]);
+    }
+
+    int targetWidth, targetHeight;
+    textureSize(image.width, image.height, targetWidth, targetHeight);
+    const IvGltfResampleFilter filter = m_textureFilter;
+
+    // offset and length are known once the image is encoded
+    tinygltf::BufferView bufferView;
+    bufferView.buffer = 0;
+    bufferView.name = "imageBufferView";
+    m_model.bufferViews.push_back(bufferView);
+
+    tinygltf::Image img;
+    img.name = "image";
+    img.bufferView = m_model.bufferViews.size() - 1; 
+    m_model.images.push_back(img);
+
+    const IvGltfImageEncoding encoding = m_imageEncoding;
+    const int jpegQuality = m_jpegQuality;
+    m_pendingTextures.push_back({
+        m_model.bufferViews.size() - 1,
+        m_model.images.size() - 1,
+        std::async(std::launch::async, [image = std::move(image), targetWidth, targetHeight, filter, encoding, jpegQuality]() {
+            return image.resized(targetWidth, targetHeight, filter).encode(encoding, jpegQuality);
+        })
+    });
+
+    tinygltf::Sampler sampler;
+    sampler.wrapS = wrapS == SoTexture2::CLAMP ? TINYGLTF_TEXTURE_WRAP_CLAMP_TO_EDGE : TINYGLTF_TEXTURE_WRAP_REPEAT;
+    sampler.wrapT = wrapT == SoTexture2::CLAMP ? TINYGLTF_TEXTURE_WRAP_CLAMP_TO_EDGE : TINYGLTF_TEXTURE_WRAP_REPEAT;
+    m_model.samplers.push_back(sampler);
+
+    tinygltf::Texture texture;
+    texture.source = m_model.images.size() - 1;
+    texture.sampler = m_model.samplers.size() - 1;
+    m_model.textures.push_back(texture);
+    return m_model.textures.size() - 1;
+}
+
+void IvGltfWriter::finishTexture(PendingTexture & texture)
+{
+    IvGltfEncodedImage encoded = texture.encoded.get();
+    tinygltf::BufferView & bufferView = m_model.bufferViews[texture.bufferView];
+    bufferView.byteLength = encoded.data.size();
+    bufferView.byteOffset = m_buffer.append(std::move(encoded.data));
+    m_model.images[texture.image].mimeType = encoded.mimeType;
+}
+
+void IvGltfWriter::finishTextures()
+{
+    while (m_finishedTextures < m_pendingTextures.size()) {
+        finishTexture(m_pendingTextures[m_finishedTextures++]);
+    }
+    m_pendingTextures.clear();
+    m_finishedTextures = 0;
+}
+
+int IvGltfWriter::addTexturedMaterial(int textureIdx)
+{
+    tinygltf::Material texmat;
+    texmat.pbrMetallicRoughness.baseColorTexture.index = textureIdx;
+    texmat.pbrMetallicRoughness.metallicFactor = 0.0;
+    texmat.name = "Texture";
+    m_model.materials.push_back(texmat);
+    return m_model.materials.size() - 1;
+}
+
+// the image pointer identifies the SoTexture2 it comes from, so shapes sharing a texture
+// share its image, texture and material
+int IvGltfWriter::texturedMaterial(const unsigned char * pixels, SbVec2s size, int nc, int wrapS, int wrapT)
+{
+    auto cached = m_materialIndexByImage.find(pixels);
+    if (cached != m_materialIndexByImage.end()) {
+        return cached->second;
+    }
+    const int materialIdx = addTexturedMaterial(addTexture(IvGltfImage(pixels, size[0], size[1], nc), wrapS, wrapT));
+    m_materialIndexByImage[pixels] = materialIdx;
+    return materialIdx;
+}
+
+void IvGltfWriter::setTextureAtlas(int maxTextureSize, int pageSize)
+{
+    m_atlasMaxTextureSize = maxTextureSize;
+    m_atlasPageSize = pageSize;
+}
+
+// only textures whose coordinates stay within [0, 1] can move into an atlas, wrapping
+// coordinates would sample the neighbouring images. the texture coordinates have already
+// been moved into the buffer, so their count is passed in.
+bool IvGltfWriter::fitsTextureAtlas(SbVec2s size, size_t uvCount) const
+{
+    return m_atlasMaxTextureSize > 0
+        && size[0] <= m_atlasMaxTextureSize && size[1] <= m_atlasMaxTextureSize
+        && uvCount > 0
+        && m_uvMin.u >= 0.0f && m_uvMin.v >= 0.0f && m_uvMax.u <= 1.0f && m_uvMax.v <= 1.0f;
+}
+
+size_t IvGltfWriter::atlasImage(const unsigned char * pixels, SbVec2s size, int nc)
+{
+    auto cached = m_atlasImageIndexByImage.find(pixels);
+    if (cached != m_atlasImageIndexByImage.end()) {
+        return cached->second;
+    }
+    m_atlasImages.emplace_back(pixels, size[0], size[1], nc);
+    m_atlasImageIndexByImage[pixels] = m_atlasImages.size() - 1;
+    return m_atlasImages.size() - 1;
+}
+
+// packs the collected textures, adds one texture and material per atlas page and moves the
+// texture coordinates of the shapes into their image's rectangle. if the images cannot be
+// packed, each of them is written as a texture of its own.
+void IvGltfWriter::buildTextureAtlases()
+{
+    if (m_atlasImages.empty()) {
+        return;
+    }
+
+    std::vector<const IvGltfImage *> images;
+    for (const IvGltfImage & image : m_atlasImages) {
+        images.push_back(&image);
+    }
+    IvGltfTextureAtlas atlas(m_atlasPageSize, atlas_padding);
+    if (!atlas.pack(images)) {
+        // the shapes keep their texture coordinates and get one texture per image instead
+        std::cerr << "warning: the textures do not fit into atlas pages of " << m_atlasPageSize << " pixels, they are written separately\n";
+        std::vector<int> imageMaterials;
+        for (IvGltfImage & image : m_atlasImages) {
+            imageMaterials.push_back(addTexturedMaterial(addTexture(std::move(image), SoTexture2::CLAMP, SoTexture2::CLAMP)));
+        }
+        for (const AtlasShape & shape : m_atlasShapes) {
+            for (tinygltf::Primitive & primitive : m_model.meshes[shape.mesh].primitives) {
+                primitive.material = imageMaterials[shape.image];
+            }
+        }
+    }
+    else {
+        std::vector<int> pageMaterials;
+        for (size_t page = 0; page < atlas.pageCount(); ++page) {
+            pageMaterials.push_back(addTexturedMaterial(addTexture(atlas.composePage(page), SoTexture2::CLAMP, SoTexture2::CLAMP)));
+        }
+
+        for (const AtlasShape & shape : m_atlasShapes) {
+            tinygltf::Accessor & uvAccessor = m_model.accessors[shape.uvAccessor];
+            const tinygltf::BufferView & uvBufferView = m_model.bufferViews[uvAccessor.bufferView];
+            uv * texCoords = reinterpret_cast<uv *>(m_buffer.data(uvBufferView.byteOffset + uvAccessor.byteOffset));
+
+            uv uvMin = { 1.0f, 1.0f };
+            uv uvMax = { 0.0f, 0.0f };
+            for (size_t i = 0; i < uvAccessor.count; ++i) {
+                atlas.mapTexCoord(shape.image, texCoords[i].u, texCoords[i].v);
+                uvMin = { std::min(uvMin.u, texCoords[i].u), std::min(uvMin.v, texCoords[i].v) };
+                uvMax = { std::max(uvMax.u, texCoords[i].u), std::max(uvMax.v, texCoords[i].v) };
+            }
+            uvAccessor.minValues = { uvMin.u, uvMin.v };
+            uvAccessor.maxValues = { uvMax.u, uvMax.v };
+
+            for (tinygltf::Primitive & primitive : m_model.meshes[shape.mesh].primitives) {
+                primitive.material = pageMaterials[atlas.placement(shape.image).page];
+            }
+        }
+    }
+    m_atlasImages.clear();
+    m_atlasImageIndexByImage.clear();
+    m_atlasShapes.clear();
+}
+
+void IvGltfWriter::setComplexityOverride(SoType shapeType, float complexity)
+{
+    setComplexityRule(m_complexityOverrides, shapeType, complexity);
+}
+
+void IvGltfWriter::setMaxComplexity(SoType shapeType, float complexity)
+{
+    setComplexityRule(m_maxComplexities, shapeType, complexity);
+}
+
+void IvGltfWriter::setComplexityRule(std::vector<ComplexityRule> & rules, SoType shapeType, float complexity)
+{
+    complexity = std::clamp(complexity, 0.0f, 1.0f);
+    for (ComplexityRule & rule : rules) {
+        if (rule.shapeType == shapeType) {
+            rule.complexity = complexity;
+            return;
+        }
+    }
+    rules.push_back({ shapeType, complexity });
+}
+
+// the most specific rule wins, e.g. a rule for SoSphere beats one for SoShape
+const IvGltfWriter::ComplexityRule * IvGltfWriter::findComplexityRule(const std::vector<ComplexityRule> & rules, SoType shapeType)
+{
+    const ComplexityRule * match = nullptr;
+    for (const ComplexityRule & rule : rules) {
+        if (shapeType.isDerivedFrom(rule.shapeType) && (!match || rule.shapeType.isDerivedFrom(match->shapeType))) {
+            match = &rule;
+        }
+    }
+    return match;
+}
+
+bool IvGltfWriter::isComplexityDependent(SoType shapeType)
+{
+    return shapeType.isDerivedFrom(SoSphere::getClassTypeId())
+        || shapeType.isDerivedFrom(SoCylinder::getClassTypeId())
+        || shapeType.isDerivedFrom(SoCone::getClassTypeId())
+        || shapeType.isDerivedFrom(SoText3::getClassTypeId())
+        || shapeType.isDerivedFrom(SoNurbsSurface::getClassTypeId())
+        || shapeType.isDerivedFrom(SoIndexedNurbsSurface::getClassTypeId())
+        || shapeType.isDerivedFrom(SoNurbsCurve::getClassTypeId())
+        || shapeType.isDerivedFrom(SoIndexedNurbsCurve::getClassTypeId());
+}
+
+float IvGltfWriter::constrainedComplexity(SoType shapeType, float complexity) const
+{
+    if (const ComplexityRule * rule = findComplexityRule(m_complexityOverrides, shapeType)) {
+        complexity = rule->complexity;
+    }
+    if (const ComplexityRule * rule = findComplexityRule(m_maxComplexities, shapeType)) {
+        complexity = std::min(complexity, rule->complexity);
+    }
+    return complexity;
+}
+
+// surfaces are subdivided in two directions, so their triangle count grows with the square
+// of the complexity, the others grow linearly
+static float tessellationExponent(SoType shapeType)
+{
+    if (shapeType.isDerivedFrom(SoSphere::getClassTypeId())
+        || shapeType.isDerivedFrom(SoNurbsSurface::getClassTypeId())
+        || shapeType.isDerivedFrom(SoIndexedNurbsSurface::getClassTypeId())) {
+        return 2.0f;
+    }
+    return 1.0f;
+}
+
+// the local box of shapes that carry their own geometry is the same wherever they are used,
+// so it is cached. shapes using coordinates from the traversal state are measured each time.
+SbBox3f IvGltfWriter::worldBoundingBox(SoCallbackAction * action, const SoNode * node)
+{
+    SoShape * shape = const_cast<SoShape *>(static_cast<const SoShape *>(node));
+    const SoType shapeType = node->getTypeId();
+    const bool cacheable = shapeType.isDerivedFrom(SoCube::getClassTypeId())
+        || shapeType.isDerivedFrom(SoSphere::getClassTypeId())
+        || shapeType.isDerivedFrom(SoCylinder::getClassTypeId())
+        || shapeType.isDerivedFrom(SoCone::getClassTypeId())
+        || (shapeType.isDerivedFrom(SoVertexShape::getClassTypeId()) && static_cast<SoVertexShape *>(shape)->vertexProperty.getValue() != nullptr);
+
+    SbBox3f box;
+    auto cached = m_localBoxes.find(node);
+    if (cached != m_localBoxes.end()) {
+        box = cached->second;
+    }
+    else {
+        SbVec3f center;
+        shape->computeBBox(action, box, center);
+        if (cacheable) {
+            m_localBoxes[node] = box;
+        }
+    }
+    if (!box.isEmpty()) {
+        box.transform(action->getModelMatrix());
+    }
+    return box;
+}
+
+bool IvGltfWriter::isCulled(SoCallbackAction * action, const SoNode * node)
+{
+    if (m_cullInvisible && action->getDrawStyle() == SoDrawStyle::INVISIBLE) {
+        return true;
+    }
+    if (m_minimumShapeSize <= 0 && m_cropBox.isEmpty()) {
+        return false;
+    }
+
+    const SbBox3f box = worldBoundingBox(action, node);
+    if (box.isEmpty()) {
+        return false;
+    }
+    if (m_minimumShapeSize > 0) {
+        float dx, dy, dz;
+        box.getSize(dx, dy, dz);
+        if (dx * dx + dy * dy + dz * dz < m_minimumShapeSize * m_minimumShapeSize) {
+            return true;
+        }
+    }
+    return !m_cropBox.isEmpty() && !m_cropBox.intersect(box);
+}
+
+// collects the complexity dependent shapes with their world space size and tessellates them
+// to count the triangles coin really generates, then lowers the complexity of the shapes over
+// their share and counts again until the triangles fit into the budget. the budget is
+// distributed in proportion to the squared diagonal of each shape's bounding box, i.e. its
+// screen area under a camera that frames the whole scene. shapes keep a minimum tessellation
+// at the lowest complexity, so a budget below that cannot be met.
+void IvGltfWriter::computeComplexityBudget()
+{
+    m_budgetShapes.clear();
+    if (m_triangleBudget == 0) {
+        return;
+    }
+
+    SoCallbackAction countAction;
+    countAction.addPreCallback(SoShape::getClassTypeId(), budgetShapeCB, this);
+    countAction.addPostCallback(SoShape::getClassTypeId(), budgetPostShapeCB, this);
+    countAction.addTriangleCallback(SoShape::getClassTypeId(), budgetTriangleCB, this);
+    countAction.addPreCallback(SoFile::getClassTypeId(), pruneFileCB, this);
+    countAction.addPreCallback(SoWWWInline::getClassTypeId(), pruneFileCB, this);
+
+    uint64_t totalTriangles = 0;
+    bool reducible = false;
+    for (int pass = 0; pass < max_budget_passes; ++pass) {
+        m_budgetShapeIndex = 0;
+        countAction.apply(m_root);
+
+        float totalWeight = 0;
+        totalTriangles = 0;
+        for (const BudgetShape & shape : m_budgetShapes) {
+            totalWeight += shape.weight;
+            totalTriangles += shape.triangles;
+        }
+        if (totalTriangles <= m_triangleBudget) {
+            return;
+        }
+
+        std::vector<float> shares;
+        reducible = false;
+        for (const BudgetShape & shape : m_budgetShapes) {
+            shares.push_back(totalWeight > 0 ? m_triangleBudget * shape.weight / totalWeight : static_cast<float>(m_triangleBudget) / m_budgetShapes.size());
+            reducible = reducible || (shape.triangles > shares.back() && shape.complexity > 0);
+        }
+        // the last pass only counts, its reduction would not be checked anymore
+        if (!reducible || pass + 1 == max_budget_passes) {
+            break;
+        }
+        for (size_t i = 0; i < m_budgetShapes.size(); ++i) {
+            BudgetShape & shape = m_budgetShapes[i];
+            if (shape.triangles > shares[i] && shape.complexity > 0) {
+                shape.complexity *= std::pow(shares[i] / shape.triangles, 1.0f / tessellationExponent(shape.shapeType));
+            }
+        }
+    }
+
+    if (reducible) {
+        std::cerr << "warning: the triangle budget of " << m_triangleBudget << " was not reached in " << max_budget_passes
+            << " passes, the procedural shapes still need " << totalTriangles << " triangles\n";
+    }
+    else {
+        std::cerr << "warning: the triangle budget of " << m_triangleBudget << " cannot be met, the procedural shapes need "
+            << totalTriangles << " triangles at their lowest complexity\n";
+    }
+}
+
+// the first pass records the shapes, later passes find them again in the same traversal order
+SoCallbackAction::Response IvGltfWriter::budgetShapeCB(void * userdata, SoCallbackAction * action, const SoNode * node)
+{
+    IvGltfWriter * that = (IvGltfWriter *)userdata;
+    const SoType shapeType = node->getTypeId();
+    if (!isComplexityDependent(shapeType) || that->isCulled(action, node)) {
+        return SoCallbackAction::PRUNE;
+    }
+    if (that->m_budgetShapeIndex == that->m_budgetShapes.size()) {
+        const SbBox3f box = that->worldBoundingBox(action, node);
+        float weight = 0;
+        if (!box.isEmpty()) {
+            float dx, dy, dz;
+            box.getSize(dx, dy, dz);
+            weight = dx * dx + dy * dy + dz * dz;
+        }
+        that->m_budgetShapes.push_back({ shapeType, that->constrainedComplexity(shapeType, action->getComplexity()), weight });
+    }
+    that->m_budgetShapes[that->m_budgetShapeIndex].triangles = 0;
+    that->applyComplexity(action, node);
+    return SoCallbackAction::CONTINUE;
+}
+
+SoCallbackAction::Response IvGltfWriter::budgetPostShapeCB(void * userdata, SoCallbackAction * action, const SoNode *)
+{
+    IvGltfWriter * that = (IvGltfWriter *)userdata;
+    that->restoreComplexity(action);
+    return SoCallbackAction::CONTINUE;
+}
+
+void IvGltfWriter::budgetTriangleCB(void * userdata, SoCallbackAction *, const SoPrimitiveVertex *, const SoPrimitiveVertex *, const SoPrimitiveVertex *)
+{
+    IvGltfWriter * that = (IvGltfWriter *)userdata;
+    ++that->m_budgetShapes[that->m_budgetShapeIndex - 1].triangles;
+}
+
+// the complexity is changed in the traversal state right before the shape tessellates itself
+// and restored in the post callback, so siblings still see the scene's own value
+void IvGltfWriter::applyComplexity(SoCallbackAction * action, const SoNode * node)
+{
+    const SoType shapeType = node->getTypeId();
+    if (!isComplexityDependent(shapeType)) {
+        return;
+    }
+
+    const float sceneComplexity = action->getComplexity();
+    float complexity = constrainedComplexity(shapeType, sceneComplexity);
+    if (m_budgetShapeIndex < m_budgetShapes.size()) {
+        complexity = m_budgetShapes[m_budgetShapeIndex].complexity;
+    }
+    ++m_budgetShapeIndex;
+
+    if (complexity != sceneComplexity) {
+        SoState * state = action->getState();
+        m_sceneComplexity = sceneComplexity;
+        m_sceneComplexityType = action->getComplexityType();
+        SoComplexityTypeElement::set(state, SoComplexityTypeElement::OBJECT_SPACE);
+        SoComplexityElement::set(state, complexity);
+        m_complexityChanged = true;
+    }
+}
+
+void IvGltfWriter::restoreComplexity(SoCallbackAction * action)
+{
+    if (m_complexityChanged) {
+        SoState * state = action->getState();
+        SoComplexityTypeElement::set(state, static_cast<SoComplexityTypeElement::Type>(m_sceneComplexityType));
+        SoComplexityElement::set(state, m_sceneComplexity);
+        m_complexityChanged = false;
+    }
+}
+
 uint32_t toPackedColor(SoCallbackAction * action, const SoPrimitiveVertex * v)
 {
     uint32_t result = 0;
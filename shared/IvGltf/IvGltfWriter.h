@@ -1,6 +1,13 @@
 #pragma once 
 #include "IvGltf.h"
+#include "IvGltfBuffer.h"
+#include "IvGltfImage.h"
 #include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/SoType.h>
+#include <Inventor/SbBox3f.h>
+#include <Inventor/SbVec2s.h>
+#include <future>
+#include <map>
 #include <string>
 #include <vector>
 #include "tiny_gltf.h"
@@ -38,10 +45,133 @@ public:
     {
         m_writeBinary = isBinary;
     }
+    // the json is written compact unless pretty printing is enabled
+    void setPrettyPrint(bool prettyPrint)
+    {
+        m_prettyPrint = prettyPrint;
+    }
+
+    // tessellation complexity of shapes whose triangle count depends on SoComplexity
+    // (SoSphere, SoCylinder, SoCone, SoText3 and the nurbs shapes). rules apply to the
+    // given type and all types derived from it, the most specific rule wins.
+    void setComplexityOverride(SoType shapeType, float complexity);
+    void setMaxComplexity(SoType shapeType, float complexity);
+    // upper limit for the triangles of all complexity dependent shapes, 0 disables it.
+    // the budget is shared in proportion to the size of each shape's bounding box. a budget
+    // below what the shapes need at their lowest complexity is exceeded with a warning.
+    void setTriangleBudget(uint32_t triangles)
+    {
+        m_triangleBudget = triangles;
+    }
+    static bool isComplexityDependent(SoType shapeType);
+
+    // textures up to maxTextureSize in both dimensions whose texture coordinates stay within
+    // [0, 1] are packed into atlas pages of at most pageSize, 0 disables the atlas. if a
+    // texture and its padding do not fit on a page, all textures are written separately.
+    void setTextureAtlas(int maxTextureSize, int pageSize = 2048);
+
+    // largest texture dimension in the output, larger textures are scaled down. 0 keeps the size.
+    void setMaxTextureSize(int size)
+    {
+        m_maxTextureSize = size;
+    }
+    // gltf stores no mip chain, the viewer builds it from the texture. a cap on its levels
+    // scales textures down to at most 2^(levels - 1) pixels. 0 keeps the size.
+    void setMaxMipLevels(int levels)
+    {
+        m_maxMipLevels = levels;
+    }
+    void setPowerOfTwoTextures(bool powerOfTwo)
+    {
+        m_powerOfTwoTextures = powerOfTwo;
+    }
+    void setTextureFilter(IvGltfResampleFilter filter)
+    {
+        m_textureFilter = filter;
+    }
+
+    // PNG keeps textures lossless, JPEG drops alpha. AUTO decides per texture.
+    void setImageEncoding(IvGltfImageEncoding encoding, int jpegQuality = 90)
+    {
+        m_imageEncoding = encoding;
+        m_jpegQuality = jpegQuality;
+    }
+
+    // culling rules, checked before a shape is tessellated. culled shapes are not exported.
+    void setCullInvisible(bool cullInvisible)
+    {
+        m_cullInvisible = cullInvisible;
+    }
+    // shapes whose world space bounding box diagonal is shorter than the given size, 0 disables it
+    void setMinimumShapeSize(float size)
+    {
+        m_minimumShapeSize = size;
+    }
+    // shapes whose world space bounding box does not intersect the crop box, an empty box disables it
+    void setCropBox(const SbBox3f & cropBox)
+    {
+        m_cropBox = cropBox;
+    }
+
+    // every distinct file referenced by SoFile or a loaded SoWWWInline is written once to its
+    // own .glb in directory, relative to the output file. the references become nodes with
+    // the reference's transformation and the uri of the .glb in their extras. the files are
+    // converted without the state inherited from the referencing scene.
+    void setExternalFiles(bool exportExternalFiles, const std::string & directory = "")
+    {
+        m_exportExternalFiles = exportExternalFiles;
+        m_externalDirectory = directory;
+    }
+
+    // copies and memory held while assembling the output buffer, valid after write
+    const IvGltfBufferStatistics & bufferStatistics() const
+    {
+        return m_buffer.statistics();
+    }
 
 protected:
     SoCallbackAction::Response onPostShape(SoCallbackAction * action, const SoNode * node);
     SoCallbackAction::Response onPreShape(SoCallbackAction * action, const SoNode * node);
+    static SoCallbackAction::Response preFileCB(void * userdata, SoCallbackAction * action, const SoNode * node);
+    static SoCallbackAction::Response pruneFileCB(void * userdata, SoCallbackAction * action, const SoNode * node);
+    SoCallbackAction::Response onPreFile(SoCallbackAction * action, const SoNode * node);
+
+    void convert();
+    bool save(const std::string & outputFilename);
+    void copySettings(const IvGltfWriter & other);
+    bool writeExternalFiles(const std::string & outputFilename);
+    void releaseExternalFiles();
+    std::string externalUri(const std::string & name) const;
+
+    struct ComplexityRule {
+        SoType shapeType;
+        float complexity;
+    };
+    static void setComplexityRule(std::vector<ComplexityRule> & rules, SoType shapeType, float complexity);
+    static const ComplexityRule * findComplexityRule(const std::vector<ComplexityRule> & rules, SoType shapeType);
+    float constrainedComplexity(SoType shapeType, float complexity) const;
+    void computeComplexityBudget();
+    static SoCallbackAction::Response budgetShapeCB(void * userdata, SoCallbackAction * action, const SoNode * node);
+    static SoCallbackAction::Response budgetPostShapeCB(void * userdata, SoCallbackAction * action, const SoNode * node);
+    static void budgetTriangleCB(void * userdata, SoCallbackAction * action, const SoPrimitiveVertex * v1, const SoPrimitiveVertex * v2, const SoPrimitiveVertex * v3);
+    void applyComplexity(SoCallbackAction * action, const SoNode * node);
+    void restoreComplexity(SoCallbackAction * action);
+    bool isCulled(SoCallbackAction * action, const SoNode * node);
+    struct PendingTexture {
+        size_t bufferView;
+        size_t image;
+        std::future<IvGltfEncodedImage> encoded;
+    };
+    void textureSize(int width, int height, int & targetWidth, int & targetHeight) const;
+    int addTexture(IvGltfImage image, int wrapS, int wrapT);
+    void finishTexture(PendingTexture & texture);
+    void finishTextures();
+    int addTexturedMaterial(int textureIdx);
+    int texturedMaterial(const unsigned char * pixels, SbVec2s size, int nc, int wrapS, int wrapT);
+    bool fitsTextureAtlas(SbVec2s size, size_t uvCount) const;
+    size_t atlasImage(const unsigned char * pixels, SbVec2s size, int nc);
+    void buildTextureAtlases();
+    SbBox3f worldBoundingBox(SoCallbackAction * action, const SoNode * node);
     struct vec3 {
         float x;
         float y;
@@ -62,11 +192,65 @@ protected:
 
 
     std::map<std::string, int> m_materialIndexByMatInfo; 
+    std::map<const unsigned char *, int> m_materialIndexByImage;
     std::vector<uint32_t> m_indices;
-    tinygltf::Buffer m_buffer;
+    IvGltfBufferBuilder m_buffer; // all geometry and images end up in the one buffer of the model
     tinygltf::Model m_model;
     tinygltf::Scene m_scene;
     SoSeparator * m_root=nullptr;
     bool m_writeBinary = false; 
+    bool m_prettyPrint = false;
     GltfWritingMode m_drawingMode{ GltfWritingMode::UNKNOWN };
+
+    std::vector<ComplexityRule> m_complexityOverrides;
+    std::vector<ComplexityRule> m_maxComplexities;
+    uint32_t m_triangleBudget = 0;
+    static constexpr int max_budget_passes = 8;
+    struct BudgetShape {
+        SoType shapeType;
+        float complexity;
+        float weight;
+        uint32_t triangles = 0; // tessellated at the complexity
+    };
+    std::vector<BudgetShape> m_budgetShapes; // complexity dependent shapes in traversal order
+    size_t m_budgetShapeIndex = 0;
+    bool m_complexityChanged = false;
+    float m_sceneComplexity = 0;
+    int m_sceneComplexityType = 0;
+
+    bool m_cullInvisible = false;
+    float m_minimumShapeSize = 0;
+    SbBox3f m_cropBox;
+    bool m_shapeCulled = false;
+    std::map<const SoNode *, SbBox3f> m_localBoxes; // boxes of shapes that do not depend on the traversal state
+
+    static constexpr int atlas_padding = 2;
+    int m_atlasMaxTextureSize = 0;
+    int m_atlasPageSize = 2048;
+    struct AtlasShape {
+        size_t image;
+        size_t uvAccessor;
+        size_t mesh;
+    };
+    std::vector<IvGltfImage> m_atlasImages;
+    std::map<const unsigned char *, size_t> m_atlasImageIndexByImage;
+    std::vector<AtlasShape> m_atlasShapes;
+
+    bool m_exportExternalFiles = false;
+    std::string m_externalDirectory;
+    struct ExternalFile {
+        std::string uri;
+        SoSeparator * root; // the children of the file, referenced
+    };
+    std::vector<ExternalFile> m_externalFiles;
+    std::map<std::string, size_t> m_externalIndexByName;
+
+    int m_maxTextureSize = 0;
+    int m_maxMipLevels = 0;
+    bool m_powerOfTwoTextures = false;
+    IvGltfResampleFilter m_textureFilter = IvGltfResampleFilter::BOX;
+    IvGltfImageEncoding m_imageEncoding = IvGltfImageEncoding::PNG;
+    int m_jpegQuality = 90;
+    std::vector<PendingTexture> m_pendingTextures;
+    size_t m_finishedTextures = 0;
 };
\ No newline at end of file
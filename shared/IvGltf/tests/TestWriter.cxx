@@ -4,14 +4,59 @@
 #include <Inventor/nodes/SoMaterial.h>
 #include <Inventor/nodes/SoTexture2.h>
 #include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/nodes/SoCone.h>
+#include <Inventor/nodes/SoDrawStyle.h>
 #include <Inventor/nodes/SoTransform.h>
 #include <Inventor/nodes/SoLineSet.h>
+#include <Inventor/nodes/SoFile.h>
+#include <Inventor/nodes/SoTranslation.h>
 #include "IvGltfWriter.h"
+#include "IvGltfTextureAtlas.h"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <cstring>
 #ifdef _WIN32
 #define strerror_r(errno,buf,len) strerror_s(buf,len,errno)
 #endif 
 #include <png++/png.hpp>
 
+// reads a written file back, so that tests can check what was exported
+static tinygltf::Model loadModel(const std::string& filename)
+{
+    tinygltf::TinyGLTF loader;
+    tinygltf::Model model;
+    std::string err, warn;
+    EXPECT_TRUE(loader.LoadASCIIFromFile(&model, &err, &warn, filename)) << err;
+    return model;
+}
+
+// the values of an accessor holding tightly packed floats
+static std::vector<float> accessorFloats(const tinygltf::Model& model, int accessorIdx)
+{
+    const tinygltf::Accessor& accessor = model.accessors[accessorIdx];
+    const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+    const unsigned char* data = model.buffers[bufferView.buffer].data.data() + bufferView.byteOffset + accessor.byteOffset;
+    std::vector<float> values(accessor.count * tinygltf::GetNumComponentsInType(accessor.type));
+    std::memcpy(values.data(), data, values.size() * sizeof(float));
+    return values;
+}
+
+static size_t triangleCount(const tinygltf::Model& model)
+{
+    size_t count = 0;
+    for (const tinygltf::Mesh& mesh : model.meshes) {
+        for (const tinygltf::Primitive& primitive : mesh.primitives) {
+            if (primitive.mode == TINYGLTF_MODE_TRIANGLES && primitive.indices >= 0) {
+                count += model.accessors[primitive.indices].count / 3;
+            }
+        }
+    }
+    return count;
+}
+
 TEST(IvGltfWriter, WriteSimpleCube)
 {
     SoSeparator* s = new SoSeparator;
@@ -93,6 +138,198 @@ TEST(IvGltfWriter, WriteTexture)
     
 }
 
+TEST(IvGltfWriter, WriteScaledTexture)
+{
+    SoSeparator* s = new SoSeparator;
+    std::vector<unsigned char> data(300 * 200 * 3);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<unsigned char>(i % 251);
+    }
+    SoTexture2* t = new SoTexture2;
+    t->image.setValue(SbVec2s(300, 200), 3, data.data());
+    s->addChild(t);
+    s->addChild(new SoCube);
+
+    IvGltfWriter gltf(s);
+    gltf.setMaxTextureSize(128);
+    gltf.setPowerOfTwoTextures(true);
+    gltf.setTextureFilter(IvGltfResampleFilter::LANCZOS);
+    EXPECT_TRUE(gltf.write("testwriter_scaledtexture.gltf"));
+
+    // 128x85 after scaling, the height rounds to the nearest power of two
+    const tinygltf::Model model = loadModel("testwriter_scaledtexture.gltf");
+    ASSERT_EQ(model.images.size(), 1u);
+    EXPECT_EQ(model.images[0].width, 128);
+    EXPECT_EQ(model.images[0].height, 64);
+
+    IvGltfImage image(data.data(), 300, 200, 3);
+    IvGltfImage scaled = image.resized(128, 64, IvGltfResampleFilter::BOX);
+    EXPECT_EQ(scaled.width, 128);
+    EXPECT_EQ(scaled.height, 64);
+    EXPECT_EQ(scaled.pixels.size(), 128u * 64u * 3u);
+}
+
+TEST(IvGltfWriter, WriteMipLevelCap)
+{
+    SoSeparator* s = new SoSeparator;
+    std::vector<unsigned char> data(300 * 200 * 3, 128);
+    SoTexture2* t = new SoTexture2;
+    t->image.setValue(SbVec2s(300, 200), 3, data.data());
+    s->addChild(t);
+    s->addChild(new SoCube);
+
+    // 7 levels start at 64 pixels
+    IvGltfWriter gltf(s);
+    gltf.setMaxTextureSize(128);
+    gltf.setMaxMipLevels(7);
+    EXPECT_TRUE(gltf.write("testwriter_miplevelcap.gltf"));
+
+    const tinygltf::Model model = loadModel("testwriter_miplevelcap.gltf");
+    ASSERT_EQ(model.images.size(), 1u);
+    EXPECT_EQ(model.images[0].width, 64);
+    EXPECT_EQ(model.images[0].height, 43);
+}
+
+TEST(IvGltfWriter, WriteJpegTexture)
+{
+    std::vector<unsigned char> noise(256 * 256 * 3);
+    uint32_t seed = 1;
+    for (auto& value : noise) {
+        seed = seed * 1664525u + 1013904223u;
+        value = static_cast<unsigned char>(seed >> 24);
+    }
+    std::vector<unsigned char> flat(256 * 256 * 3, 128);
+    EXPECT_TRUE(IvGltfImage(noise.data(), 256, 256, 3).isPhotographic());
+    EXPECT_FALSE(IvGltfImage(flat.data(), 256, 256, 3).isPhotographic());
+    EXPECT_EQ(IvGltfImage(noise.data(), 256, 256, 3).encode(IvGltfImageEncoding::AUTO, 80).mimeType, "image/jpeg");
+    EXPECT_EQ(IvGltfImage(flat.data(), 256, 256, 3).encode(IvGltfImageEncoding::AUTO, 80).mimeType, "image/png");
+
+    SoSeparator* s = new SoSeparator;
+    SoTexture2* t = new SoTexture2;
+    t->image.setValue(SbVec2s(256, 256), 3, noise.data());
+    s->addChild(t);
+    s->addChild(new SoCube);
+
+    IvGltfWriter gltf(s);
+    gltf.setImageEncoding(IvGltfImageEncoding::AUTO, 80);
+    EXPECT_TRUE(gltf.write("testwriter_jpegtexture.gltf"));
+}
+
+TEST(IvGltfBufferBuilder, AssembleOnce)
+{
+    IvGltfBufferBuilder builder;
+    EXPECT_EQ(builder.append(std::vector<unsigned char>{ 1, 2, 3 }), 0u);
+    EXPECT_EQ(builder.append(std::vector<float>{ 1.0f, 2.0f }), 4u);
+    EXPECT_EQ(builder.append(std::vector<uint32_t>()), 12u);
+    EXPECT_EQ(builder.append(std::vector<uint16_t>{ 7 }), 12u);
+    EXPECT_EQ(*reinterpret_cast<float*>(builder.data(8)), 2.0f);
+
+    std::vector<unsigned char> out;
+    builder.assemble(out);
+    ASSERT_EQ(out.size(), 14u);
+    EXPECT_EQ(out[2], 3);
+    EXPECT_EQ(out[3], 0);
+    EXPECT_EQ(builder.statistics().chunks, 3u);
+    EXPECT_EQ(builder.statistics().copies, 3u);
+    EXPECT_EQ(builder.statistics().bytesCopied, 13u);
+    EXPECT_EQ(builder.statistics().peakStagedBytes, 13u);
+}
+
+TEST(IvGltfWriter, WriteStreamed)
+{
+    SoSeparator* s = new SoSeparator;
+    s->addChild(new SoCube);
+
+    IvGltfWriter gltf(s);
+    EXPECT_TRUE(gltf.write("testwriter_streamed.gltf"));
+    gltf.setWriteBinary(true);
+    EXPECT_TRUE(gltf.write("testwriter_streamed.glb"));
+
+    std::ifstream json("testwriter_streamed.gltf", std::ios::binary);
+    std::string text((std::istreambuf_iterator<char>(json)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(text.find('\n'), std::string::npos);
+    EXPECT_NE(text.find("\"uri\":\"data:application/octet-stream;base64,"), std::string::npos);
+    EXPECT_NE(text.find("\"type\":\"VEC3\""), std::string::npos);
+
+    std::ifstream glb("testwriter_streamed.glb", std::ios::binary);
+    std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(glb)), std::istreambuf_iterator<char>());
+    ASSERT_GE(bytes.size(), 28u);
+    auto readUint32 = [&bytes](size_t offset) {
+        return bytes[offset] | (bytes[offset + 1] << 8) | (bytes[offset + 2] << 16) | (uint32_t(bytes[offset + 3]) << 24);
+    };
+    EXPECT_EQ(readUint32(0), 0x46546C67u);
+    EXPECT_EQ(readUint32(8), bytes.size());
+    const uint32_t jsonLength = readUint32(12);
+    EXPECT_EQ(jsonLength % 4, 0u);
+    ASSERT_LE(20 + jsonLength + 8, bytes.size());
+    EXPECT_EQ(readUint32(20 + jsonLength + 4), 0x004E4942u);
+    EXPECT_EQ(20 + jsonLength + 8 + readUint32(20 + jsonLength), bytes.size());
+}
+
+TEST(IvGltfWriter, WriteExternalFiles)
+{
+    SoSeparator* part = new SoSeparator;
+    part->ref();
+    part->addChild(new SoCube);
+    ASSERT_TRUE(IvGltf::writeFile("testwriter_part.iv", part, false));
+    part->unref();
+
+    SoSeparator* s = new SoSeparator;
+    for (int i = 0; i < 3; ++i) {
+        SoTranslation* t = new SoTranslation;
+        t->translation = SbVec3f(3, 0, 0);
+        SoFile* f = new SoFile;
+        f->name.setValue("testwriter_part.iv");
+        s->addChild(t);
+        s->addChild(f);
+    }
+
+    IvGltfWriter gltf(s);
+    gltf.setExternalFiles(true, "testwriter_parts");
+    EXPECT_TRUE(gltf.write("testwriter_external.gltf"));
+    EXPECT_TRUE(std::filesystem::exists("testwriter_parts/testwriter_part.glb"));
+
+    std::ifstream json("testwriter_external.gltf", std::ios::binary);
+    std::string text((std::istreambuf_iterator<char>(json)), std::istreambuf_iterator<char>());
+    size_t references = 0;
+    for (size_t pos = text.find("testwriter_parts/testwriter_part.glb"); pos != std::string::npos; pos = text.find("testwriter_parts/testwriter_part.glb", pos + 1)) {
+        ++references;
+    }
+    EXPECT_EQ(references, 3u);
+}
+
+TEST(IvGltfWriter, WriteExternalFilesMipLevelCap)
+{
+    SoSeparator* part = new SoSeparator;
+    part->ref();
+    std::vector<unsigned char> data(300 * 200 * 3, 128);
+    SoTexture2* t = new SoTexture2;
+    t->image.setValue(SbVec2s(300, 200), 3, data.data());
+    part->addChild(t);
+    part->addChild(new SoCube);
+    ASSERT_TRUE(IvGltf::writeFile("testwriter_texturedpart.iv", part, false));
+    part->unref();
+
+    SoSeparator* s = new SoSeparator;
+    SoFile* f = new SoFile;
+    f->name.setValue("testwriter_texturedpart.iv");
+    s->addChild(f);
+
+    // the external file is written with the settings of the main file
+    IvGltfWriter gltf(s);
+    gltf.setExternalFiles(true, "testwriter_mipparts");
+    gltf.setMaxMipLevels(7);
+    EXPECT_TRUE(gltf.write("testwriter_externalmip.gltf"));
+
+    tinygltf::TinyGLTF loader;
+    tinygltf::Model model;
+    std::string err, warn;
+    ASSERT_TRUE(loader.LoadBinaryFromFile(&model, &err, &warn, "testwriter_mipparts/testwriter_texturedpart.glb")) << err;
+    ASSERT_EQ(model.images.size(), 1u);
+    EXPECT_EQ(model.images[0].width, 64);
+    EXPECT_EQ(model.images[0].height, 43);
+}
+
 TEST(IvGltfWriter, WriteSimpleLineset)
 {
     SoSeparator* s = new SoSeparator;
@@ -118,6 +355,199 @@ TEST(IvGltfWriter, WriteSimpleLineset)
     IvGltf::writeFile("testwriter_lineset.iv", s, true);
 }
 
+TEST(IvGltfWriter, WriteComplexityBudget)
+{
+    SoSeparator* s = new SoSeparator;
+    SoSphere* big = new SoSphere;
+    big->radius = 10;
+    SoSphere* small = new SoSphere;
+    small->radius = 0.1f;
+    SoTransform* t = new SoTransform;
+    t->translation = SbVec3f(20, 0, 0);
+    s->addChild(big);
+    s->addChild(t);
+    s->addChild(small);
+    s->addChild(new SoCone);
+
+    EXPECT_TRUE(IvGltfWriter::isComplexityDependent(SoSphere::getClassTypeId()));
+    EXPECT_FALSE(IvGltfWriter::isComplexityDependent(SoCube::getClassTypeId()));
+
+    IvGltfWriter unbudgeted(s);
+    unbudgeted.setMaxComplexity(SoCone::getClassTypeId(), 0.1f);
+    EXPECT_TRUE(unbudgeted.write("testwriter_complexitynobudget.gltf"));
+
+    IvGltfWriter gltf(s);
+    gltf.setMaxComplexity(SoCone::getClassTypeId(), 0.1f);
+    gltf.setTriangleBudget(500);
+    EXPECT_TRUE(gltf.write("testwriter_complexitybudget.gltf"));
+
+    const size_t unbudgetedTriangles = triangleCount(loadModel("testwriter_complexitynobudget.gltf"));
+    const size_t budgetedTriangles = triangleCount(loadModel("testwriter_complexitybudget.gltf"));
+    EXPECT_LE(budgetedTriangles, 500u);
+    EXPECT_LT(budgetedTriangles, unbudgetedTriangles);
+}
+
+TEST(IvGltfWriter, WriteCulled)
+{
+    SoSeparator* s = new SoSeparator;
+    SoSeparator* hidden = new SoSeparator;
+    SoDrawStyle* ds = new SoDrawStyle;
+    ds->style = SoDrawStyle::INVISIBLE;
+    hidden->addChild(ds);
+    hidden->addChild(new SoCube);
+    SoTransform* t = new SoTransform;
+    t->translation = SbVec3f(100, 0, 0);
+    SoSphere* tiny = new SoSphere;
+    tiny->radius = 0.001f;
+    s->addChild(hidden);
+    s->addChild(new SoCube);
+    s->addChild(tiny);
+    s->addChild(t);
+    s->addChild(new SoCube);
+
+    IvGltfWriter gltf(s);
+    gltf.setCullInvisible(true);
+    gltf.setMinimumShapeSize(0.01f);
+    gltf.setCropBox(SbBox3f(-10, -10, -10, 10, 10, 10));
+    EXPECT_TRUE(gltf.write("testwriter_culled.gltf"));
+
+    // only the visible cube at the origin is left
+    const tinygltf::Model model = loadModel("testwriter_culled.gltf");
+    ASSERT_EQ(model.meshes.size(), 1u);
+    ASSERT_EQ(model.meshes[0].primitives.size(), 1u);
+    const tinygltf::Accessor& positions = model.accessors[model.meshes[0].primitives[0].attributes.at("POSITION")];
+    ASSERT_EQ(positions.minValues.size(), 3u);
+    ASSERT_EQ(positions.maxValues.size(), 3u);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_FLOAT_EQ(positions.minValues[i], -1.0);
+        EXPECT_FLOAT_EQ(positions.maxValues[i], 1.0);
+    }
+}
+
+TEST(IvGltfTextureAtlas, PackImages)
+{
+    std::vector<IvGltfImage> images;
+    for (int i = 0; i < 20; ++i) {
+        images.emplace_back(8 + i, 30 - i, 3);
+    }
+    std::vector<const IvGltfImage*> pointers;
+    for (const IvGltfImage& image : images) {
+        pointers.push_back(&image);
+    }
+    IvGltfTextureAtlas atlas(64, 2);
+    ASSERT_TRUE(atlas.pack(pointers));
+    EXPECT_GT(atlas.pageCount(), 1u);
+    for (size_t i = 0; i < images.size(); ++i) {
+        for (size_t j = i + 1; j < images.size(); ++j) {
+            const IvGltfTextureAtlas::Placement& a = atlas.placement(i);
+            const IvGltfTextureAtlas::Placement& b = atlas.placement(j);
+            if (a.page == b.page) {
+                const bool separated = a.x + images[i].width <= b.x || b.x + images[j].width <= a.x
+                    || a.y + images[i].height <= b.y || b.y + images[j].height <= a.y;
+                EXPECT_TRUE(separated) << "images " << i << " and " << j << " overlap";
+            }
+        }
+    }
+
+    IvGltfImage tooLarge(63, 10, 3);
+    EXPECT_FALSE(atlas.pack({ &tooLarge }));
+}
+
+// four cubes with a 16x16 texture each
+static SoSeparator* atlasScene(std::vector<std::vector<unsigned char>>& textures)
+{
+    SoSeparator* s = new SoSeparator;
+    for (int i = 0; i < 4; ++i) {
+        textures.emplace_back(16 * 16 * 3, static_cast<unsigned char>(60 * i));
+        SoTexture2* t = new SoTexture2;
+        t->image.setValue(SbVec2s(16, 16), 3, textures.back().data());
+        SoTransform* tr = new SoTransform;
+        tr->translation = SbVec3f(3, 0, 0);
+        s->addChild(t);
+        s->addChild(tr);
+        s->addChild(new SoCube);
+    }
+    return s;
+}
+
+TEST(IvGltfWriter, WriteTextureAtlas)
+{
+    std::vector<std::vector<unsigned char>> textures;
+    SoSeparator* s = atlasScene(textures);
+
+    IvGltfWriter gltf(s);
+    gltf.setTextureAtlas(64, 256);
+    EXPECT_TRUE(gltf.write("testwriter_atlas.gltf"));
+
+    // the same packing as the writer's
+    std::vector<IvGltfImage> images;
+    for (const std::vector<unsigned char>& texture : textures) {
+        images.emplace_back(texture.data(), 16, 16, 3);
+    }
+    std::vector<const IvGltfImage*> pointers;
+    for (const IvGltfImage& image : images) {
+        pointers.push_back(&image);
+    }
+    IvGltfTextureAtlas atlas(256, 2);
+    ASSERT_TRUE(atlas.pack(pointers));
+    ASSERT_EQ(atlas.pageCount(), 1u);
+    const IvGltfImage page = atlas.composePage(0);
+
+    const tinygltf::Model model = loadModel("testwriter_atlas.gltf");
+    ASSERT_EQ(model.images.size(), 1u);
+    ASSERT_EQ(model.textures.size(), 1u);
+    EXPECT_EQ(model.images[0].width, page.width);
+    EXPECT_EQ(model.images[0].height, page.height);
+
+    ASSERT_EQ(model.meshes.size(), 4u);
+    for (size_t i = 0; i < model.meshes.size(); ++i) {
+        for (const tinygltf::Primitive& primitive : model.meshes[i].primitives) {
+            ASSERT_GE(primitive.material, 0);
+            EXPECT_EQ(model.materials[primitive.material].pbrMetallicRoughness.baseColorTexture.index, 0);
+
+            float uMin = 0, vMin = 0, uMax = 1, vMax = 1;
+            atlas.mapTexCoord(i, uMin, vMin);
+            atlas.mapTexCoord(i, uMax, vMax);
+            const std::vector<float> texCoords = accessorFloats(model, primitive.attributes.at("TEXCOORD_0"));
+            for (size_t j = 0; j < texCoords.size(); j += 2) {
+                EXPECT_GE(texCoords[j], uMin - 1e-6f);
+                EXPECT_LE(texCoords[j], uMax + 1e-6f);
+                EXPECT_GE(texCoords[j + 1], vMin - 1e-6f);
+                EXPECT_LE(texCoords[j + 1], vMax + 1e-6f);
+            }
+        }
+    }
+}
+
+TEST(IvGltfWriter, WriteTextureAtlasFallback)
+{
+    std::vector<std::vector<unsigned char>> textures;
+    SoSeparator* s = atlasScene(textures);
+
+    // the padding does not fit on the page, so every texture is written on its own
+    IvGltfWriter gltf(s);
+    gltf.setTextureAtlas(64, 16);
+    EXPECT_TRUE(gltf.write("testwriter_atlasfallback.gltf"));
+
+    const tinygltf::Model model = loadModel("testwriter_atlasfallback.gltf");
+    ASSERT_EQ(model.images.size(), 4u);
+    ASSERT_EQ(model.meshes.size(), 4u);
+    std::set<int> usedTextures;
+    for (const tinygltf::Mesh& mesh : model.meshes) {
+        for (const tinygltf::Primitive& primitive : mesh.primitives) {
+            ASSERT_GE(primitive.material, 0);
+            usedTextures.insert(model.materials[primitive.material].pbrMetallicRoughness.baseColorTexture.index);
+
+            const tinygltf::Accessor& texCoords = model.accessors[primitive.attributes.at("TEXCOORD_0")];
+            EXPECT_FLOAT_EQ(texCoords.minValues[0], 0.0);
+            EXPECT_FLOAT_EQ(texCoords.minValues[1], 0.0);
+            EXPECT_FLOAT_EQ(texCoords.maxValues[0], 1.0);
+            EXPECT_FLOAT_EQ(texCoords.maxValues[1], 1.0);
+        }
+    }
+    EXPECT_EQ(usedTextures.size(), 4u);
+}
+
 int main(int ac, char* av[])
 {
 	testing::InitGoogleTest(&ac, av);